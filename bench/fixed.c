@@ -0,0 +1,159 @@
+#include "gfixed.h"
+
+/*! \file fixed.c
+  \brief Benchmark of the fixed point path against the float path.
+  Loads and transforms a grid of 2000 by 2000 units seen from 3000 units, once through the float path and once through the
+  fixed point path, and reports the time of each with the largest screen difference between them.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/25
+  \copyright GNU Public License.
+*/
+
+
+#include "parser.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define GRID_SIDE 1000                            //!< Default vertices per side of the grid.
+#define GRID_SIZE 2000.0f                         //!< Size of the grid in units.
+#define SCREEN_WIDTH 640                          //!< Width of the screen in pixels.
+#define SCREEN_HEIGHT 480                         //!< Height of the screen in pixels.
+#define REPEATS 5                                 //!< Runs per measurement, the fastest counts.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Current time.
+  \return Seconds of the monotonic clock.
+*/
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/*! \brief Writes a grid as wavefront.
+  \param side Vertices per side.
+  \param path Buffer to receive the path, at least 32 characters.
+  \return 1 on success, else 0.
+*/
+static int8_t writeGrid(uint32_t side, char * path) {
+  snprintf(path, 32, "/tmp/fixedXXXXXX");
+  int fd = mkstemp(path);
+  FILE * file = fd < 0 ? NULL : fdopen(fd, "w");
+  if (!file) {
+    return 0;
+  }
+  uint32_t x, y;
+  for (y = 0; y < side; ++y) {
+    for (x = 0; x < side; ++x) {
+      fprintf(file, "v %.4f %.4f 0\n", x * GRID_SIZE / (side - 1), y * GRID_SIZE / (side - 1));
+    }
+  }
+  for (y = 0; y + 1 < side; ++y) {
+    for (x = 0; x + 1 < side; ++x) {
+      fprintf(file, "f %u %u %u %u\n", y * side + x + 1, y * side + x + 2, (y + 1) * side + x + 2, (y + 1) * side + x + 1);
+    }
+  }
+  return fclose(file) == 0;
+}
+
+/*! \brief Times a float transformation.
+  \param kernel Kernel to transform with.
+  \param matrix Pointer to transformation to screen coordinates.
+  \param in Pointer to vertex buffer.
+  \param out Pointer to vertex buffer receiving the result.
+  \return Seconds of the fastest run.
+*/
+static double timeFloat(enum Kernel kernel, Matrix4 const * matrix, VertexBuffer const * in, VertexBuffer * out) {
+  double best = INFINITY;
+  uint32_t i;
+  selectKernel(kernel);
+  for (i = 0; i < REPEATS; ++i) {
+    double start = now();
+    transformVertexBuffer(matrix, in, out);
+    best = fmin(best, now() - start);
+  }
+  selectKernel(KAuto);
+  return best;
+}
+
+
+// ----------------- Benchmark ---------------------------------------------------------------------
+
+int main(int argc, char ** argv) {
+  uint32_t side = argc > 1 ? (uint32_t)atoi(argv[1]) : GRID_SIDE;
+  char path[32];
+  if (side < 2 || !writeGrid(side, path)) {
+    printf("fixed: can not write the grid\n");
+    return 1;
+  }
+
+  Mesh mesh;
+  MeshFixed meshFixed;
+  double start = now();
+  enum codes loaded = loadWavefront(path, LFNone, &mesh);
+  double loadFloat = now() - start;
+  start = now();
+  enum codes loadedFixed = loadWavefrontFixed(path, LFNone, &meshFixed);
+  double loadFixed = now() - start;
+  unlink(path);
+  if (loaded != Success || loadedFixed != Success) {
+    printf("fixed: load failed\n");
+    return 1;
+  }
+  uint32_t count = mesh.vertices.size;
+  double millions = count * 1e-6;
+
+  // grid seen from 3000 units, the scene the tolerance of 'transformVertexBufferFixed' is documented for
+  Matrix4 projection, view, viewport, clip, screen;
+  Vector eye = {GRID_SIZE / 2, GRID_SIZE / 2, 3000.0f};
+  Vector target = {GRID_SIZE / 2, GRID_SIZE / 2, 0.0f};
+  Vector up = {0.0f, 1.0f, 0.0f};
+  perspectiveMatrix(1.0f, (float)SCREEN_WIDTH / SCREEN_HEIGHT, 0.5f, 10000.0f, &projection);
+  lookAtMatrix(eye, target, up, &view);
+  viewportMatrix(SCREEN_WIDTH, SCREEN_HEIGHT, &viewport);
+  multiplyMatrix(&projection, &view, &clip);
+  multiplyMatrix(&viewport, &clip, &screen);
+  Matrix4Fixed clipFixed;
+  toFixedMatrix(&clip, &clipFixed);
+
+  VertexBuffer out;
+  VertexBufferFixed outFixed;
+  if (initVertexBuffer(count, &out) != Success || initVertexBufferFixed(count, &outFixed) != Success) {
+    printf("fixed: out of memory\n");
+    return 1;
+  }
+  double scalar = timeFloat(KScalar, &screen, &mesh.vertices, &out);
+  double vector = timeFloat(KAuto, &screen, &mesh.vertices, &out);
+  double fixed = INFINITY;
+  uint32_t i;
+  for (i = 0; i < REPEATS; ++i) {
+    start = now();
+    transformVertexBufferFixed(&clipFixed, SCREEN_WIDTH, SCREEN_HEIGHT, &meshFixed.vertices, &outFixed);
+    fixed = fmin(fixed, now() - start);
+  }
+
+  double error = 0.0;
+  for (i = 0; i < count; ++i) {
+    error = fmax(error, fabs(FROM_FIXED(outFixed.vertices[i].coord.x) - out.vertices[i].coord.x));
+    error = fmax(error, fabs(FROM_FIXED(outFixed.vertices[i].coord.y) - out.vertices[i].coord.y));
+  }
+
+  printf("%u vertices\n", count);
+  printf("load       float %8.3f s   fixed %8.3f s\n", loadFloat, loadFixed);
+  printf("transform  float %8.1f Mvertices/s (scalar) %8.1f Mvertices/s (kernel %d)   fixed %8.1f Mvertices/s\n",
+	 millions / scalar, millions / vector, getKernel(), millions / fixed);
+  printf("largest screen difference %g pixel\n", error);
+
+  free(out.vertices);
+  free(outFixed.vertices);
+  destroyWavefront(&mesh);
+  destroyWavefrontFixed(&meshFixed);
+  return 0;
+}
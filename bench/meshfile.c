@@ -0,0 +1,159 @@
+#include "meshfile.h"
+
+/*! \file meshfile.c
+  \brief Benchmark of the text load against the binary mesh load.
+  Writes a synthetic wavefront, 100 MB unless another size in MB is given, loads it with 'loadWavefront' and writes it
+  as binary mesh, then loads the binary mesh with 'loadMeshFile' and through the cache of 'loadWavefrontCached'.
+  A mapped load reads nothing until the mesh is used, so the time to read every vertex and index once is reported as well.
+  \author cxnf
+  \version 0.1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include "parser.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define DEFAULT_MEGABYTES 100                     //!< Default size of the wavefront in MB.
+#define REPEATS 5                                 //!< Runs per binary measurement, the fastest counts.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Current time.
+  \return Seconds of the monotonic clock.
+*/
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/*! \brief Writes a synthetic wavefront.
+  Rows of vertices, each followed by the quads to the row before it.
+  \param megabytes Size of the wavefront in MB.
+  \param path Buffer to receive the path, at least 32 characters.
+  \return Size in bytes, 0 on failure.
+*/
+static size_t writeWavefront(uint32_t megabytes, char * path) {
+  snprintf(path, 32, "/tmp/meshfileXXXXXX");
+  int fd = mkstemp(path);
+  FILE * file = fd < 0 ? NULL : fdopen(fd, "w");
+  if (!file) {
+    return 0;
+  }
+  const uint32_t columns = 1000;
+  size_t size = 0, target = (size_t)megabytes * 1000000;
+  uint32_t row, column;
+  for (row = 0; size < target; ++row) {
+    int written = 0;
+    for (column = 0; column < columns && written >= 0; ++column) {
+      written = fprintf(file, "v %.4f %.4f %.4f\n", column * 0.01, row * 0.01, (column ^ row) % 97 * 0.001);
+      size += written > 0 ? (size_t)written : 0;
+    }
+    for (column = 0; row && column + 1 < columns && written >= 0; ++column) {
+      uint32_t a = (row - 1) * columns + column + 1;
+      written = fprintf(file, "f %u %u %u %u\n", a, a + 1, a + columns + 1, a + columns);
+      size += written > 0 ? (size_t)written : 0;
+    }
+    if (written < 0) {
+      fclose(file);
+      unlink(path);
+      return 0;
+    }
+  }
+  return fclose(file) == 0 ? size : 0;
+}
+
+/*! \brief Reads every vertex and index of a mesh once.
+  \param mesh Pointer to mesh.
+  \return Sum of the data, so the reads are not optimized away.
+*/
+static double touchMesh(Mesh const * mesh) {
+  double sum = 0.0;
+  uint32_t i;
+  for (i = 0; i < mesh->vertices.size; ++i) {
+    sum += mesh->vertices.vertices[i].coord.x + mesh->vertices.vertices[i].coord.z;
+  }
+  for (i = 0; i < mesh->indices.size; ++i) {
+    sum += getIndex(i, &mesh->indices);
+  }
+  return sum;
+}
+
+
+// ----------------- Benchmark ---------------------------------------------------------------------
+
+int main(int argc, char ** argv) {
+  uint32_t megabytes = argc > 1 ? (uint32_t)atoi(argv[1]) : DEFAULT_MEGABYTES;
+  char path[32];
+  size_t size = writeWavefront(megabytes ? megabytes : 1, path);
+  if (!size) {
+    printf("meshfile: can not write the wavefront\n");
+    return 1;
+  }
+  char cachePath[40];
+  snprintf(cachePath, sizeof(cachePath), "%s.bin", path);
+
+  Mesh mesh;
+  double start = now();
+  enum codes result = loadWavefront(path, LFNone, &mesh);
+  double text = now() - start;
+  double write = 0.0;
+  if (result == Success) {
+    start = now();
+    result = writeMeshFile(cachePath, &mesh, NULL);
+    write = now() - start;
+  }
+  double sum = result == Success ? touchMesh(&mesh) : 0.0;
+  uint32_t vertices = mesh.vertices.size, indices = mesh.indices.size;
+  if (result == Success) {
+    destroyWavefront(&mesh);
+  }
+
+  // the binary mesh is in the page cache after writing it, as the text was after generating it
+  double mapped = INFINITY, touched = INFINITY, cached = INFINITY;
+  uint32_t i;
+  for (i = 0; i < REPEATS && result == Success; ++i) {
+    MeshFile file;
+    start = now();
+    result = loadMeshFile(cachePath, &mesh, &file, NULL);
+    double loaded = now() - start;
+    if (result == Success) {
+      mapped = fmin(mapped, loaded);
+      // the mapping must hold what was written
+      result = touchMesh(&mesh) == sum ? Success : Failed;
+      touched = fmin(touched, now() - start);
+      closeMeshFile(&file, &mesh);
+    }
+  }
+  // the first cached load writes the cache with the description of the source, the rest hit it
+  for (i = 0; i <= REPEATS && result == Success; ++i) {
+    MeshFile file;
+    start = now();
+    result = loadWavefrontCached(path, cachePath, LFNone, &mesh, &file);
+    if (result == Success) {
+      cached = i ? fmin(cached, now() - start) : cached;
+      closeMeshFile(&file, &mesh);
+    }
+  }
+  unlink(cachePath);
+  unlink(path);
+  if (result != Success) {
+    printf("meshfile: failed\n");
+    return 1;
+  }
+
+  double mb = size * 1e-6;
+  printf("%.0f MB, %u vertices, %u indices\n", mb, vertices, indices);
+  printf("text load      %8.3f s %8.1f MB/s\n", text, mb / text);
+  printf("write binary   %8.3f s\n", write);
+  printf("mapped load    %8.3f s   read once %8.3f s\n", mapped, touched);
+  printf("cached load    %8.3f s\n", cached);
+  return 0;
+}
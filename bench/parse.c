@@ -0,0 +1,167 @@
+#include "cparser.h"
+
+/*! \file parse.c
+  \brief Benchmark of the block reader against reading per character.
+  Writes a synthetic wavefront, 500 MB unless another size in MB is given, and tokenizes it with 'parseDescriptor' at
+  several block sizes and with a reference tokenizer that reads every character with 'fgetc', as the stream path did before.
+  Reports MB/s of each, the file is read from the page cache by all of them.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define DEFAULT_MEGABYTES 500                     //!< Default size of the wavefront in MB.
+#define REFERENCE_TOKEN 256                       //!< Longest token of the reference tokenizer.
+
+
+// ----------------- Local Function definitions ---------------------------
+
+/*! \brief Current time.
+  \return Seconds of the monotonic clock.
+*/
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/*! \brief Counts tokens.
+  \param type Type of the token.
+  \param token The token.
+  \param user Pointer to the token counter.
+  \return 1 to continue parsing.
+*/
+static int8_t countToken(enum TokenType type, Token token, void * user) {
+  ++*(uint64_t *)user;
+  return 1;
+}
+
+/*! \brief Writes a synthetic wavefront.
+  Vertices and quads in the proportion of a grid, with a comment now and then.
+  \param megabytes Size of the wavefront in MB.
+  \param path Buffer to receive the path, at least 32 characters.
+  \return Size in bytes, 0 on failure.
+*/
+static size_t writeWavefront(uint32_t megabytes, char * path) {
+  snprintf(path, 32, "/tmp/parseXXXXXX");
+  int fd = mkstemp(path);
+  FILE * file = fd < 0 ? NULL : fdopen(fd, "w");
+  if (!file) {
+    return 0;
+  }
+  size_t size = 0, target = (size_t)megabytes * 1000000;
+  uint32_t i = 0;
+  while (size < target) {
+    int written;
+    if (i % 1000 == 0) {
+      written = fprintf(file, "# block %u\n", i);
+    } else if (i % 2) {
+      written = fprintf(file, "v %.6f %.6f -%.6f\n", i * 0.001, i * 0.002, i * 0.0005);
+    } else {
+      written = fprintf(file, "f %u %u %u %u\n", i / 2 + 1, i / 2 + 2, i / 2 + 3, i / 2 + 4);
+    }
+    if (written < 0) {
+      fclose(file);
+      unlink(path);
+      return 0;
+    }
+    size += (size_t)written;
+    ++i;
+  }
+  return fclose(file) == 0 ? size : 0;
+}
+
+/*! \brief Reference tokenizer, one 'fgetc' per character.
+  Splits on the same rules as the tokenizer for a valid wavefront: comments, line ends, numbers and text.
+  Tokens are copied into a buffer and handed to 'fnCallback', as the stream path did before it read blocks.
+  \param path Path to text file.
+  \param fnCallback Pointer to function called when a new token is available.
+  \param user Pointer passed to every call of 'fnCallback'.
+  \return ROk on success, error code otherwise.
+*/
+static enum ParseResults parseCharacters(const char * path, parserCallback fnCallback, void * user) {
+  FILE * file = fopen(path, "r");
+  if (!file) {
+    return RErrIO;
+  }
+  char text[REFERENCE_TOKEN];
+  Token token = { text, 0 };
+  int column = 0;
+  int c = fgetc(file);
+  while (c != EOF) {
+    if (c == '#' && column == 0) {
+      // a comment line gives no tokens, its line end included
+      while (c != EOF && c != '\n') {
+	c = fgetc(file);
+      }
+      c = fgetc(file);
+    } else if (c == '\n' || c == '\r') {
+      token.length = 0;
+      fnCallback(TTEndLine, token, user);
+      column = 0;
+      c = fgetc(file);
+    } else if (c == ' ' || c == '\t') {
+      ++column;
+      c = fgetc(file);
+    } else {
+      enum TokenType type = c == '-' || (c >= '0' && c <= '9') ? TTNumber : TTText;
+      token.length = 0;
+      while (c != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r' && token.length < REFERENCE_TOKEN) {
+	text[token.length++] = (char)c;
+	c = fgetc(file);
+      }
+      fnCallback(type, token, user);
+      column += token.length;
+    }
+  }
+  fclose(file);
+  return ROk;
+}
+
+
+// ----------------- Benchmark --------------------------------------------
+
+int main(int argc, char ** argv) {
+  static const size_t blocks[] = { 4096, 64 * 1024, PARSE_BLOCK_SIZE, 4 * 1024 * 1024 };
+  uint32_t megabytes = argc > 1 ? (uint32_t)atoi(argv[1]) : DEFAULT_MEGABYTES;
+  char path[32];
+  size_t size = writeWavefront(megabytes ? megabytes : 1, path);
+  if (!size) {
+    printf("parse: can not write the wavefront\n");
+    return 1;
+  }
+  double mb = size * 1e-6;
+  printf("%.0f MB\n", mb);
+
+  uint64_t tokens = 0;
+  double start = now();
+  enum ParseResults result = parseCharacters(path, countToken, &tokens);
+  double seconds = now() - start;
+  printf("fgetc                  %8.1f MB/s  %lu tokens\n", mb / seconds, (unsigned long)tokens);
+
+  uint32_t i;
+  for (i = 0; i < sizeof(blocks) / sizeof(blocks[0]) && result == ROk; ++i) {
+    int fd = open(path, O_RDONLY);
+    tokens = 0;
+    start = now();
+    result = parseDescriptor(fd, blocks[i], countToken, &tokens);
+    seconds = now() - start;
+    close(fd);
+    printf("parseDescriptor %5lu KB %8.1f MB/s  %lu tokens\n", (unsigned long)(blocks[i] / 1024), mb / seconds, (unsigned long)tokens);
+  }
+  unlink(path);
+  if (result != ROk) {
+    printf("parse: failed\n");
+    return 1;
+  }
+  return 0;
+}
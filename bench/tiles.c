@@ -0,0 +1,135 @@
+#include "graster.h"
+
+/*! \file tiles.c
+  \brief Benchmark of the tiled rasterizer per worker count.
+  Draws a random mesh of 1 million lines, unless another amount is given, on a 1920 x 1080 screen with 'rasterizeMesh' and
+  with 'binLines' and 'rasterizeTiles' at 1, 2, 4, 8 and one worker per online processor.
+  Reports the time of binning and drawing per worker count, every frame must hash the same as the untiled one.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define DEFAULT_LINES 1000000                     //!< Default amount of lines.
+#define SCREEN_WIDTH 1920                         //!< Width of the screen in pixels.
+#define SCREEN_HEIGHT 1080                        //!< Height of the screen in pixels.
+#define REPEATS 5                                 //!< Runs per measurement, the fastest counts.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Current time.
+  \return Seconds of the monotonic clock.
+*/
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/*! \brief Random float in a range.
+  \param min Minimum.
+  \param max Maximum.
+  \return Random value in [min, max].
+*/
+static float randomRange(float min, float max) {
+  return (float)(min + ((double)max - min) * rand() / RAND_MAX);
+}
+
+/*! \brief Builds a mesh of short random lines.
+  Lines of up to 64 pixels, some reaching off screen, like the edges of a detailed mesh.
+  \param lines Amount of lines.
+  \param mesh Pointer to resulting mesh.
+  \return 1 on success, else 0.
+*/
+static int8_t buildMesh(uint32_t lines, Mesh * mesh) {
+  if (initVertexBuffer(lines * 2, &mesh->vertices) != Success) {
+    return 0;
+  }
+  if (initIndexBuffer(lines, Index32, &mesh->indices) != Success) {
+    free(mesh->vertices.vertices);
+    return 0;
+  }
+  mesh->topology = NULL;
+  uint32_t i;
+  for (i = 0; i < lines; ++i) {
+    Vertex * a = &mesh->vertices.vertices[i * 2];
+    Vertex * b = &mesh->vertices.vertices[i * 2 + 1];
+    a->coord.x = randomRange(-32.0f, SCREEN_WIDTH + 32.0f);
+    a->coord.y = randomRange(-32.0f, SCREEN_HEIGHT + 32.0f);
+    b->coord.x = a->coord.x + randomRange(-64.0f, 64.0f);
+    b->coord.y = a->coord.y + randomRange(-64.0f, 64.0f);
+    a->coord.z = b->coord.z = 0.0f;
+    a->color = b->color = (Color)rand();
+    mesh->indices.indices32[i * 2] = i * 2;
+    mesh->indices.indices32[i * 2 + 1] = i * 2 + 1;
+  }
+  return 1;
+}
+
+
+// ----------------- Benchmark ---------------------------------------------------------------------
+
+int main(int argc, char ** argv) {
+  uint32_t lines = argc > 1 ? (uint32_t)atoi(argv[1]) : DEFAULT_LINES;
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t workers[] = { 1, 2, 4, 8, online > 0 ? (uint32_t)online : 1 };
+  Mesh mesh;
+  Framebuffer fb;
+  TileBins bins;
+  srand(22);
+  if (!buildMesh(lines ? lines : 1, &mesh)) {
+    printf("tiles: out of memory\n");
+    return 1;
+  }
+  if (initFramebuffer(SCREEN_WIDTH, SCREEN_HEIGHT, &fb) != Success || initTileBins(SCREEN_WIDTH, SCREEN_HEIGHT, &bins) != Success) {
+    printf("tiles: out of memory\n");
+    return 1;
+  }
+
+  double untiled = INFINITY;
+  uint32_t i, r;
+  for (r = 0; r < REPEATS; ++r) {
+    clearFramebuffer(&fb, 0);
+    double start = now();
+    rasterizeMesh(&fb, &mesh, NULL);
+    untiled = fmin(untiled, now() - start);
+  }
+  uint64_t hash = hashFramebuffer(&fb);
+  printf("%u lines, %u x %u, %u tiles\n", mesh.indices.size / 2, SCREEN_WIDTH, SCREEN_HEIGHT, bins.tiles);
+  printf("rasterizeMesh          %8.2f ms\n", untiled * 1e3);
+
+  int failed = 0;
+  for (i = 0; i < sizeof(workers) / sizeof(workers[0]); ++i) {
+    double binned = INFINITY, drawn = INFINITY;
+    for (r = 0; r < REPEATS; ++r) {
+      clearFramebuffer(&fb, 0);
+      double start = now();
+      binLines(&mesh, workers[i], &bins);
+      double middle = now();
+      rasterizeTiles(&fb, &mesh, &bins, workers[i], NULL);
+      double end = now();
+      binned = fmin(binned, middle - start);
+      drawn = fmin(drawn, end - middle);
+    }
+    int8_t same = hashFramebuffer(&fb) == hash;
+    failed |= !same;
+    printf("%2u workers  bin %8.2f ms  draw %8.2f ms  total %8.2f ms%s\n", workers[i], binned * 1e3, drawn * 1e3,
+	   (binned + drawn) * 1e3, same ? "" : "  frame differs");
+  }
+
+  free(mesh.vertices.vertices);
+  free(mesh.indices.indices);
+  freeFramebuffer(&fb);
+  freeTileBins(&bins);
+  return failed;
+}
@@ -0,0 +1,133 @@
+#include "carray.h"
+
+/*! \file carray.c
+  \brief Growable contiguous array.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// ----------------- Local Variables --------------------------------------
+#define MIN_CAPACITY 16                           //!< Capacity of the first allocation made by a growing array.
+
+
+// ----------------- Global Function definitions --------------------------
+int8_t initArray(Array * array, uint32_t uiStride, uint32_t uiCapacity) {
+  // do not try to initialize a non-existing array or an array of empty elements
+  if (!array || !uiStride) {
+    return 0;
+  }
+  array->pData = NULL;
+  array->uiSize = 0;
+  array->uiCapacity = 0;
+  array->uiStride = uiStride;
+  return uiCapacity ? reserveArray(array, uiCapacity) : 1;
+}
+
+void freeArray(Array * array) {
+  if (!array) {
+    return;
+  }
+  free(array->pData);
+  array->pData = NULL;
+  array->uiSize = 0;
+  array->uiCapacity = 0;
+}
+
+int8_t reserveArray(Array * array, uint32_t uiCapacity) {
+  if (!array) {
+    return 0;
+  }
+  if (uiCapacity <= array->uiCapacity) {
+    return 1;
+  }
+  void * pData = realloc(array->pData, (size_t)array->uiStride * uiCapacity);
+  // keep old storage when reallocation failed
+  if (!pData) {
+    return 0;
+  }
+  array->pData = pData;
+  array->uiCapacity = uiCapacity;
+  return 1;
+}
+
+int8_t growArray(Array * array) {
+  if (!array) {
+    return 0;
+  }
+  // grow by half, this wastes less memory than doubling while still being geometric
+  uint32_t uiCapacity = array->uiCapacity + (array->uiCapacity >> 1);
+  if (uiCapacity < MIN_CAPACITY) {
+    uiCapacity = MIN_CAPACITY;
+  }
+  // saturate instead of wrapping around
+  if (uiCapacity < array->uiCapacity) {
+    if (array->uiCapacity == UINT32_MAX) {
+      return 0;
+    }
+    uiCapacity = UINT32_MAX;
+  }
+  return reserveArray(array, uiCapacity);
+}
+
+int8_t shrinkArray(Array * array) {
+  if (!array) {
+    return 0;
+  }
+  if (array->uiSize == array->uiCapacity) {
+    return 1;
+  }
+  if (!array->uiSize) {
+    freeArray(array);
+    return 1;
+  }
+  void * pData = realloc(array->pData, (size_t)array->uiStride * array->uiSize);
+  if (!pData) {
+    return 0;
+  }
+  array->pData = pData;
+  array->uiCapacity = array->uiSize;
+  return 1;
+}
+
+void * pushArray(Array * array, void const * pItem) {
+  if (!array) {
+    return NULL;
+  }
+  if (array->uiSize == array->uiCapacity && !growArray(array)) {
+    return NULL;
+  }
+  void * pElement = (char *)array->pData + (size_t)array->uiStride * array->uiSize++;
+  if (pItem) {
+    memcpy(pElement, pItem, array->uiStride);
+  }
+  return pElement;
+}
+
+int8_t popArray(Array * array) {
+  if (!array || !array->uiSize) {
+    return 0;
+  }
+  --array->uiSize;
+  return 1;
+}
+
+void * detachArray(Array * array, uint32_t * puiSize) {
+  if (!array) {
+    return NULL;
+  }
+  void * pData = array->pData;
+  if (puiSize) {
+    *puiSize = array->uiSize;
+  }
+  array->pData = NULL;
+  array->uiSize = 0;
+  array->uiCapacity = 0;
+  return pData;
+}
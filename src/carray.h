@@ -0,0 +1,104 @@
+#pragma once
+
+/*! \file carray.h
+  \brief Growable contiguous array.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+#include <stdint.h>
+
+// ----------------- Structs ----------------------------------------------
+
+/*! \struct Array
+  \brief Growable contiguous array.
+  Arrays hold elements of a fixed size in one block of memory.
+  The block grows geometrically, so pushing an element is amortized constant time.
+*/
+typedef struct Array {
+  void * pData;                                   //!< Storage, NULL when nothing was allocated yet.
+  uint32_t uiSize;                                //!< Amount of elements in use.
+  uint32_t uiCapacity;                            //!< Amount of elements that fit in storage.
+  uint32_t uiStride;                              //!< Size of one element in bytes.
+} Array;
+
+
+// ----------------- Macros -----------------------------------------------
+
+/*! \brief Get element at given location.
+  Evaluates to the element at 'uiIndex' as lvalue of 'type', bounds are not checked.
+*/
+#define ARRAY_AT(array, type, uiIndex) (((type *)(array)->pData)[uiIndex])
+
+/*! \brief Push element to end of array.
+  Appends 'value' as 'type' to the array, growing it when it is full.
+  The fast path does not call any function.
+  Evaluates to 1 on success, else 0.
+*/
+#define ARRAY_PUSH(array, type, value) \
+  (((array)->uiSize < (array)->uiCapacity || growArray(array)) ? (ARRAY_AT(array, type, (array)->uiSize++) = (value), 1) : 0)
+
+
+// ----------------- Array functions --------------------------------------
+
+/*! \brief Initializes an array.
+  Initializes an empty array for elements of 'uiStride' bytes.
+  Each array initialized by this function must be freed by 'freeArray(Array)' or detached by 'detachArray(Array, uint32_t)' to avoid memory leaks.
+  \param array Array to initialize.
+  \param uiStride Size of one element in bytes.
+  \param uiCapacity Amount of elements to reserve, 0 delays allocation until the first push.
+  \return 1 on success, else 0.
+*/
+int8_t initArray(Array * array, uint32_t uiStride, uint32_t uiCapacity);
+/*! \brief Frees an array.
+  Frees the storage of an array and resets it to an empty state.
+  Pointers to elements in the array are no longer valid.
+  \param array Array to free.
+*/
+void freeArray(Array * array);
+
+/*! \brief Reserve storage.
+  Makes sure the array can hold at least 'uiCapacity' elements without reallocating.
+  Pointers to elements in the array are no longer valid when storage was reallocated.
+  \param array Array to reserve storage for.
+  \param uiCapacity Amount of elements.
+  \return 1 on success, else 0.
+*/
+int8_t reserveArray(Array * array, uint32_t uiCapacity);
+/*! \brief Grow storage.
+  Grows storage of the array geometrically, called by 'ARRAY_PUSH' when the array is full.
+  \param array Array to grow.
+  \return 1 on success, else 0.
+*/
+int8_t growArray(Array * array);
+/*! \brief Shrink storage to fit.
+  Reallocates storage so the capacity equals the size of the array.
+  Pointers to elements in the array are no longer valid.
+  \param array Array to shrink.
+  \return 1 on success, else 0.
+*/
+int8_t shrinkArray(Array * array);
+
+/*! \brief Push element to end of array.
+  Appends an element of 'uiStride' bytes, growing the array when it is full.
+  \param array Array to push to.
+  \param pItem Pointer to data to copy into the new element, NULL leaves the element uninitialized.
+  \return Pointer to the new element or NULL on failure.
+*/
+void * pushArray(Array * array, void const * pItem);
+/*! \brief Remove last element.
+  Removes the last element of the array, storage is kept.
+  \param array Array to pop from.
+  \return 1 on success, 0 when the array was empty.
+*/
+int8_t popArray(Array * array);
+
+/*! \brief Detach storage.
+  Hands storage of the array to the caller and resets the array to an empty state.
+  The returned block must be released with 'free'.
+  \param array Array to detach storage from.
+  \param puiSize Pointer to receive amount of elements in the block, may be NULL.
+  \return Storage or NULL when the array held no storage.
+*/
+void * detachArray(Array * array, uint32_t * puiSize);
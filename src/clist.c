@@ -12,6 +12,31 @@
 #include <stdlib.h>
 
 
+// ----------------- Struct definitions -----------------------------------
+
+#define DEFAULT_CHUNK_SIZE 1024                   //!< Iterators per chunk when no chunk size is given.
+
+/*! \struct NodeChunk
+  \brief Contiguous block of iterators.
+*/
+struct NodeChunk {
+  struct NodeChunk * next;                        //!< Next chunk owned by the pool.
+  uint32_t uiUsed;                                //!< Amount of iterators handed out from this chunk.
+  Iterator nodes[];                               //!< Iterator storage.
+};
+
+/*! \struct NodePool
+  \brief Chunked iterator allocator owned by a list.
+  Iterators are handed out from the current chunk, removed iterators are kept in a free list for reuse.
+*/
+struct NodePool {
+  struct NodeChunk * first;                       //!< First chunk, NULL when nothing was allocated yet.
+  struct NodeChunk * current;                     //!< Chunk iterators are currently taken from.
+  Iterator * freed;                               //!< Recycled iterators, linked through their 'next' field.
+  uint32_t uiChunkSize;                           //!< Amount of iterators per chunk.
+};
+
+
 // ----------------- Local Variables --------------------------------------
 static Iterator _NULL_iterator_ = { NULL, NULL, NULL, NULL }; //!< NULL iterator, allows functions to return a valid pointer to an invalid iterator without creating potential memory leaks.
 
@@ -23,6 +48,24 @@ static Iterator _NULL_iterator_ = { NULL, NULL, NULL, NULL }; //!< NULL iterator
 */
 static inline Iterator * getNullIterator();
 
+/*! \brief Allocate an iterator.
+  Takes an iterator from the pool of the list, or allocates one when the list has no pool.
+  \param list List the iterator will belong to.
+  \return Uninitialized iterator or NULL on failure.
+*/
+static inline Iterator * allocIterator(List * list);
+/*! \brief Release an iterator.
+  Gives an iterator back to the pool of the list, or frees it when the list has no pool.
+  \param list List the iterator belonged to.
+  \param iterator Iterator to release.
+*/
+static inline void freeIterator(List * list, Iterator * iterator);
+/*! \brief Reset a pool.
+  Hands all chunks back to the pool at once, all iterators taken from it become invalid.
+  \param pool Pool to reset.
+*/
+static void resetPool(struct NodePool * pool);
+
 // ----------------- Global Function definitions --------------------------
 List * createList(Deallocator dealloc) {
   List * list = (List *)malloc(sizeof(struct List));
@@ -35,6 +78,25 @@ List * createList(Deallocator dealloc) {
   list->last = NULL;
   list->uiSize = 0;
   list->dealloc = dealloc;
+  list->pool = NULL;
+  return list;
+}
+
+List * createListWithPool(Deallocator dealloc, uint32_t uiChunkSize) {
+  List * list = createList(dealloc);
+  if (!list) {
+    return NULL;
+  }
+  list->pool = (struct NodePool *)malloc(sizeof(struct NodePool));
+  if (!list->pool) {
+    free(list);
+    return NULL;
+  }
+  // chunks are allocated lazily by the first 'addEntry'
+  list->pool->first = NULL;
+  list->pool->current = NULL;
+  list->pool->freed = NULL;
+  list->pool->uiChunkSize = uiChunkSize ? uiChunkSize : DEFAULT_CHUNK_SIZE;
   return list;
 }
 
@@ -45,14 +107,24 @@ void clearList(List * list) {
   }
   Iterator * current = list->first;
   Iterator * next = NULL;
-  // while list has another element, save pointer to next (may be invalid, but checked on next iteration) and free allocated memory (item and iterator)
-  while (current) {
-    next = current->next;
+  // pooled iterators are handed back per chunk, only items have to be visited (and only when there is something to free)
+  if (list->pool) {
     if (list->dealloc) {
-      (*list->dealloc)(current->pItem);
+      for (; current; current = current->next) {
+        (*list->dealloc)(current->pItem);
+      }
+    }
+    resetPool(list->pool);
+  } else {
+    // while list has another element, save pointer to next (may be invalid, but checked on next iteration) and free allocated memory (item and iterator)
+    while (current) {
+      next = current->next;
+      if (list->dealloc) {
+        (*list->dealloc)(current->pItem);
+      }
+      free(current);
+      current = next;
     }
-    free(current);
-    current = next;
   }
   // reset list to empty state
   list->first = NULL;
@@ -67,6 +139,16 @@ void destroyList(List * list) {
   }
   // clear frees all elements (item and iterator), only then list can be safely deallocated
   clearList(list);
+  if (list->pool) {
+    struct NodeChunk * chunk = list->pool->first;
+    struct NodeChunk * next = NULL;
+    while (chunk) {
+      next = chunk->next;
+      free(chunk);
+      chunk = next;
+    }
+    free(list->pool);
+  }
   free(list);
 }
 
@@ -125,7 +207,7 @@ int8_t addEntry(List * list, Iterator * iterator, void * pItem) {
   } else if (list != iterator->container) {
     return 0;
   }
-  Iterator * newEntry = (Iterator *)malloc(sizeof(struct Iterator));
+  Iterator * newEntry = allocIterator(list);
   // do not try to initialize and add entry when memory is not allocated
   if (!newEntry) {
     return 0;
@@ -177,7 +259,7 @@ int8_t removeEntry(List * list, Iterator * iterator) {
     iterator->next->prev = iterator->prev;
   }
   free(iterator->pItem);
-  free(iterator);
+  freeIterator(list, iterator);
   return 1;
 }
 
@@ -235,3 +317,51 @@ int8_t isEnd(Iterator * iterator) {
 static inline Iterator * getNullIterator() {
   return &_NULL_iterator_;
 }
+
+static inline Iterator * allocIterator(List * list) {
+  struct NodePool * pool = list->pool;
+  if (!pool) {
+    return (Iterator *)malloc(sizeof(struct Iterator));
+  }
+  // reuse removed iterators first
+  if (pool->freed) {
+    Iterator * iterator = pool->freed;
+    pool->freed = iterator->next;
+    return iterator;
+  }
+  // move on to the next chunk when current one is exhausted, chunks kept by a previous reset are reused before allocating a new one
+  if (!pool->current || pool->current->uiUsed == pool->uiChunkSize) {
+    if (pool->current && pool->current->next) {
+      pool->current = pool->current->next;
+    } else {
+      struct NodeChunk * chunk = (struct NodeChunk *)malloc(sizeof(struct NodeChunk) + sizeof(struct Iterator) * pool->uiChunkSize);
+      if (!chunk) {
+        return NULL;
+      }
+      chunk->next = NULL;
+      if (pool->current) {
+        pool->current->next = chunk;
+      } else {
+        pool->first = chunk;
+      }
+      pool->current = chunk;
+    }
+    pool->current->uiUsed = 0;
+  }
+  return &pool->current->nodes[pool->current->uiUsed++];
+}
+static inline void freeIterator(List * list, Iterator * iterator) {
+  if (!list->pool) {
+    free(iterator);
+    return;
+  }
+  iterator->next = list->pool->freed;
+  list->pool->freed = iterator;
+}
+static void resetPool(struct NodePool * pool) {
+  pool->current = pool->first;
+  pool->freed = NULL;
+  if (pool->current) {
+    pool->current->uiUsed = 0;
+  }
+}
@@ -17,6 +17,7 @@ typedef void (*Deallocator)(void *);              //!< Deallocator called each t
 // ----------------- Foreward Decl ----------------------------------------
 
 struct Iterator;
+struct NodePool;
 
 // ----------------- Structs ----------------------------------------------
 
@@ -31,6 +32,7 @@ typedef struct List {
   int32_t uiSize;                                 //!< Total amount of entries.
 
   Deallocator dealloc;                            //!< Deallocator, NULL disables auto free function.
+  struct NodePool * pool;                         //!< Pool iterators are taken from, NULL when each iterator is allocated separately.
 } List;
 
 /* \struct _iterator_
@@ -55,6 +57,15 @@ typedef struct Iterator {
   \return Created list.
 */
 List * createList(Deallocator dealloc);
+/*! \brief Creates a new list with a node pool.
+  Creates a new list whose iterators are taken from contiguous chunks owned by the list instead of being allocated one by one.
+  Removed iterators are recycled by the pool, clearing the list hands all chunks back at once without freeing them.
+  Chunks are only freed when the list is destroyed by 'destroyList(List)'.
+  \param dealloc Deallocator, pass NULL to disable auto free. Entries must than be freed manually.
+  \param uiChunkSize Amount of iterators per chunk, 0 selects a default size.
+  \return Created list.
+*/
+List * createListWithPool(Deallocator dealloc, uint32_t uiChunkSize);
 /*! \brief Clears a list.
   Clears a list, destroying all entries.
   All iterators to entries in the list are no longer valid.
@@ -0,0 +1,271 @@
+#define _GNU_SOURCE                               // strtof_l
+#include "cnumber.h"
+
+/*! \file cnumber.c
+  \brief Locale independent number conversion.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// ----------------- Struct definitions -----------------------------------
+
+#define MAX_DIGITS 19                             //!< Significant digits that always fit in a 64 bit mantissa.
+#define MAX_EXPONENT 100000                       //!< Exponents are clamped to this, far beyond the float range.
+#define SLOW_SIZE 512                             //!< Longest number the C library fallback accepts.
+
+/*! \struct Decimal
+  \brief Number split in mantissa and decimal exponent.
+  Value is mantissa * 10^exponent.
+*/
+struct Decimal {
+  uint64_t uiMantissa;                            //!< Significant digits.
+  int32_t iExponent;                              //!< Decimal exponent.
+  int8_t bNegative;                               //!< Sign.
+  int8_t bTruncated;                              //!< Set when non zero digits did not fit in the mantissa.
+};
+
+
+// ----------------- Local Variables --------------------------------------
+
+//! Powers of ten that are exact in a float.
+static const float afPow10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+//! Powers of ten that are exact in a double.
+static const double adPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+// ----------------- Local Function declarations --------------------------
+
+/*! \brief Split number.
+  Splits the text of a decimal number in mantissa and exponent.
+  \param pcText First character of the number.
+  \param uiLength Amount of characters in the number.
+  \param pDecimal Pointer to receive the split number.
+  \return 1 on success, 0 when the text is not a number.
+*/
+static int8_t splitDecimal(const char * pcText, uint32_t uiLength, struct Decimal * pDecimal);
+
+/*! \brief Convert text to float using the C library.
+  Used for numbers the exact paths can not handle, the text is converted in the "C" locale.
+  \param pcText First character of the number.
+  \param uiLength Amount of characters in the number.
+  \param pfValue Pointer to receive the value.
+  \return 1 on success, else 0.
+*/
+static int8_t readFloatSlow(const char * pcText, uint32_t uiLength, float * pfValue);
+
+
+// ----------------- Global Function definitions --------------------------
+int8_t readFloat(const char * pcText, uint32_t uiLength, float * pfValue) {
+  struct Decimal decimal;
+  if (!pcText || !pfValue || !splitDecimal(pcText, uiLength, &decimal)) {
+    return 0;
+  }
+  float fValue;
+  if (!decimal.uiMantissa) {
+    fValue = 0.0f;
+  } else if (!decimal.bTruncated && decimal.uiMantissa <= (1ull << 24) && decimal.iExponent >= -10 && decimal.iExponent <= 10) {
+    // mantissa and power are exact floats, so a single IEEE operation rounds correctly
+    fValue = (float)decimal.uiMantissa;
+    fValue = decimal.iExponent < 0 ? fValue / afPow10[-decimal.iExponent] : fValue * afPow10[decimal.iExponent];
+  } else if (!decimal.bTruncated && decimal.uiMantissa <= (1ull << 53) && decimal.iExponent >= -22 && decimal.iExponent <= 22) {
+    // same in double, rounding the correctly rounded double again is only wrong when it landed exactly halfway between two floats
+    double dValue = (double)decimal.uiMantissa;
+    dValue = decimal.iExponent < 0 ? dValue / adPow10[-decimal.iExponent] : dValue * adPow10[decimal.iExponent];
+    fValue = (float)dValue;
+    if ((double)fValue != dValue && fValue <= 3.4028235e38f) {
+      union { float f; uint32_t u; } neighbour = { fValue };
+      neighbour.u += dValue > fValue ? 1 : -1;
+      if (((double)fValue + (double)neighbour.f) * 0.5 == dValue) {
+        return readFloatSlow(pcText, uiLength, pfValue);
+      }
+    }
+  } else {
+    return readFloatSlow(pcText, uiLength, pfValue);
+  }
+  *pfValue = decimal.bNegative ? -fValue : fValue;
+  return 1;
+}
+
+int8_t readInteger(const char * pcText, uint32_t uiLength, int32_t * piValue) {
+  if (!pcText || !piValue || !uiLength) {
+    return 0;
+  }
+  const char * pcEnd = pcText + uiLength;
+  int8_t bNegative = *pcText == '-';
+  if (*pcText == '-' || *pcText == '+') {
+    ++pcText;
+  }
+  if (pcText == pcEnd) {
+    return 0;
+  }
+  // the magnitude of INT32_MIN is one larger than INT32_MAX
+  int64_t iLimit = bNegative ? 2147483648ll : 2147483647ll;
+  int64_t iValue = 0;
+  for (; pcText < pcEnd; ++pcText) {
+    unsigned uiDigit = (unsigned)(*pcText - '0');
+    if (uiDigit > 9) {
+      return 0;
+    }
+    iValue = iValue * 10 + uiDigit;
+    if (iValue > iLimit) {
+      return 0;
+    }
+  }
+  *piValue = (int32_t)(bNegative ? -iValue : iValue);
+  return 1;
+}
+
+int8_t readFixed(const char * pcText, uint32_t uiLength, int32_t * piValue) {
+  struct Decimal decimal;
+  if (!pcText || !piValue || !splitDecimal(pcText, uiLength, &decimal)) {
+    return 0;
+  }
+  // magnitude limit in Q16.16, the magnitude of INT32_MIN is one larger than INT32_MAX
+  uint64_t uiLimit = decimal.bNegative ? 0x80000000ull : 0x7FFFFFFFull;
+  uint64_t uiMantissa = decimal.uiMantissa;
+  int32_t iExponent = decimal.iExponent;
+  uint64_t uiValue;
+  if (!uiMantissa) {
+    uiValue = 0;
+  } else if (iExponent >= 0) {
+    // integer, scale up while checking the range
+    for (; iExponent > 0; --iExponent) {
+      if (uiMantissa > (uiLimit >> 16) / 10) {
+        return 0;
+      }
+      uiMantissa *= 10;
+    }
+    // a mantissa of 2^48 or more would wrap in the shift
+    if (uiMantissa > (uiLimit >> 16)) {
+      return 0;
+    }
+    uiValue = uiMantissa << 16;
+  } else {
+    // mantissa * 2^16 / 10^-exponent rounded, digits are dropped until the product fits 64 bits and the divisor fits a power table
+    while (uiMantissa >= (1ull << 47) || iExponent < -19) {
+      uiMantissa = (uiMantissa + 5) / 10;
+      ++iExponent;
+    }
+    uint64_t uiDivisor = 1;
+    for (; iExponent < 0; ++iExponent) {
+      uiDivisor *= 10;
+    }
+    uiValue = ((uiMantissa << 16) + uiDivisor / 2) / uiDivisor;
+  }
+  if (uiValue > uiLimit) {
+    return 0;
+  }
+  *piValue = decimal.bNegative ? (int32_t)(0 - uiValue) : (int32_t)uiValue;
+  return 1;
+}
+
+
+// ----------------- Local Function definitions ---------------------------
+static int8_t splitDecimal(const char * pcText, uint32_t uiLength, struct Decimal * pDecimal) {
+  const char * pcEnd = pcText + uiLength;
+  int iDigits = 0;
+  int8_t bDot = 0;
+  int8_t bAny = 0;
+
+  pDecimal->uiMantissa = 0;
+  pDecimal->iExponent = 0;
+  pDecimal->bTruncated = 0;
+  pDecimal->bNegative = pcText < pcEnd && *pcText == '-';
+  if (pcText < pcEnd && (*pcText == '-' || *pcText == '+')) {
+    ++pcText;
+  }
+
+  for (; pcText < pcEnd; ++pcText) {
+    if (*pcText == '.') {
+      if (bDot) {
+        return 0;
+      }
+      bDot = 1;
+      continue;
+    }
+    unsigned uiDigit = (unsigned)(*pcText - '0');
+    if (uiDigit > 9) {
+      break;
+    }
+    bAny = 1;
+    // leading zeros are not significant, after the dot they still shift the exponent
+    if (!iDigits && !uiDigit) {
+      pDecimal->iExponent -= bDot;
+      continue;
+    }
+    if (iDigits < MAX_DIGITS) {
+      pDecimal->uiMantissa = pDecimal->uiMantissa * 10 + uiDigit;
+      pDecimal->iExponent -= bDot;
+      ++iDigits;
+    } else {
+      // digits that do not fit only scale the value (before the dot) or are dropped (after the dot)
+      pDecimal->bTruncated |= uiDigit != 0;
+      pDecimal->iExponent += !bDot;
+    }
+  }
+  if (!bAny) {
+    return 0;
+  }
+
+  if (pcText < pcEnd) {
+    if (*pcText != 'e' && *pcText != 'E') {
+      return 0;
+    }
+    ++pcText;
+    int8_t bNegative = pcText < pcEnd && *pcText == '-';
+    if (pcText < pcEnd && (*pcText == '-' || *pcText == '+')) {
+      ++pcText;
+    }
+    if (pcText == pcEnd) {
+      return 0;
+    }
+    int32_t iExponent = 0;
+    for (; pcText < pcEnd; ++pcText) {
+      unsigned uiDigit = (unsigned)(*pcText - '0');
+      if (uiDigit > 9) {
+        return 0;
+      }
+      if (iExponent < MAX_EXPONENT) {
+        iExponent = iExponent * 10 + uiDigit;
+      }
+    }
+    pDecimal->iExponent += bNegative ? -iExponent : iExponent;
+  }
+  return 1;
+}
+
+static int8_t readFloatSlow(const char * pcText, uint32_t uiLength, float * pfValue) {
+  char acBuffer[SLOW_SIZE];
+  if (uiLength >= SLOW_SIZE) {
+    return 0;
+  }
+  memcpy(acBuffer, pcText, uiLength);
+  acBuffer[uiLength] = '\0';
+#if defined(__GLIBC__)
+  // "C" locale is created once and shared, the loser of a race frees its copy
+  static locale_t cLocale = (locale_t)0;
+  locale_t locale = __atomic_load_n(&cLocale, __ATOMIC_ACQUIRE);
+  if (!locale) {
+    locale_t created = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    if (created && !__atomic_compare_exchange_n(&cLocale, &locale, created, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      freelocale(created);
+    } else {
+      locale = created;
+    }
+  }
+  *pfValue = locale ? strtof_l(acBuffer, NULL, locale) : strtof(acBuffer, NULL);
+#else
+  *pfValue = strtof(acBuffer, NULL);
+#endif
+  return 1;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+/*! \file cnumber.h
+  \brief Locale independent number conversion.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <stdint.h>
+
+/*! \brief Convert text to float.
+  Converts a decimal number of the form [-+]digits[.digits][(e|E)[-+]digits] to the nearest float.
+  The text does not have to be zero terminated and the decimal separator is always '.', regardless of locale.
+  Numbers with up to 7 significant digits and a small exponent (everything Blender exports) are converted with a single exact float operation,
+  up to 19 digits go through an exact double operation, only the remaining cases fall back to the C library.
+  \param pcText First character of the number.
+  \param uiLength Amount of characters in the number.
+  \param pfValue Pointer to receive the value.
+  \return 1 on success, 0 when the text is not a number.
+*/
+int8_t readFloat(const char * pcText, uint32_t uiLength, float * pfValue);
+
+/*! \brief Convert text to integer.
+  Converts a decimal integer of the form [-+]digits.
+  The text does not have to be zero terminated.
+  \param pcText First character of the number.
+  \param uiLength Amount of characters in the number.
+  \param piValue Pointer to receive the value.
+  \return 1 on success, 0 when the text is not an integer or does not fit.
+*/
+int8_t readInteger(const char * pcText, uint32_t uiLength, int32_t * piValue);
+
+/*! \brief Convert text to fixed point.
+  Converts a decimal number of the same form as 'readFloat' to the nearest signed Q16.16 value (halfway cases round away from zero).
+  The conversion only uses integer arithmetic, no float is involved. Numbers with more than 14 significant digits can be off by one unit.
+  \param pcText First character of the number.
+  \param uiLength Amount of characters in the number.
+  \param piValue Pointer to receive the value, 16 integer and 16 fraction bits.
+  \return 1 on success, 0 when the text is not a number or is outside the Q16.16 range.
+*/
+int8_t readFixed(const char * pcText, uint32_t uiLength, int32_t * piValue);
@@ -1,5 +1,7 @@
 #include "cparser.h"
 
+#include "cscan.h"
+
 /*! \file cparser.c
   \brief Basic text stream tokenizer.
   \author cxnf
@@ -8,27 +10,54 @@
   \copyright GNU Public License
 */
 
-#include "clist.h"
-#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // ----------------- Struct definitions -----------------------------------
 
+#define TOKEN_SIZE 256                            //!< Maximum length of a token.
+#define MIN_BLOCK_SIZE (4 * TOKEN_SIZE)           //!< Smallest block size, a block must always fit a carried over token.
+
 /*! \struct ParseContext
   \brief Context of tokenizer.
+  The tokenizer always scans a buffer.
+  When parsing a descriptor the buffer is a block that is refilled once it is consumed.
 */
 struct ParseContext {
-  FILE * file;                                    //!< File parsed by tokenizer.
-  List * list;                                    //!< List to mimic dynamic string.
+  int fd;                                         //!< Descriptor parsed by tokenizer, -1 when parsing a buffer.
+  char * pcBlock;                                 //!< Block the descriptor is read into, NULL when parsing a buffer.
+  size_t uiBlockSize;                             //!< Size of 'pcBlock' in bytes.
+  int8_t bError;                                  //!< Set when reading the descriptor failed.
+  const char * pcCursor;                          //!< Next character of the parsed buffer.
+  const char * pcEnd;                             //!< End of the parsed buffer.
+  const char * pcToken;                           //!< Start of the current token in the parsed buffer.
+  uint32_t uiLength;                              //!< Length of the current token.
+  const Scanner * scanner;                        //!< Scan functions used to consume runs of characters.
+  int8_t bLineOpen;                               //!< Set when tokens were sent since the last line end.
   int iLine;                                      //!< Line number of tokenizer.
   int iColumn;                                    //!< Column number of tokenizer.
   parserCallback fnCallback;                      //!< Callback for external token processing.
+  void * user;                                    //!< User pointer passed to the callback.
 };
 
 
 // ----------------- Local Function declarations --------------------------
 
+/*! \brief Generate token stream.
+  Runs the tokenizer on the input set up in the context.
+  \param ppcContext Context of the tokenizer, input fields must be set.
+  \param fnCallback Pointer to function called when a new token is available.
+  \param user Pointer passed to every call of 'fnCallback'.
+  \return ROk on success, error code otherwise.
+*/
+static enum ParseResults tokenize(struct ParseContext * ppcContext, parserCallback fnCallback, void * user);
+
 /*! \brief Report error.
   Reports an error to stdin.
   \param ccaMessage Message to print.
@@ -47,12 +76,30 @@ static inline void cleanUp(struct ParseContext * ppcContext);
 */
 static inline void reportAndClean(const char * ccaMessage, struct ParseContext * ppcContext);
 
+/*! \brief Refills the block.
+  Reads the next block from the descriptor.
+  The current token is moved to the start of the block first, so it stays contiguous when it crosses a block boundary.
+  \param ppcContext Context of the tokenizer.
+  \return 1 when data was read, 0 on end of input or error.
+*/
+static int8_t refill(struct ParseContext * ppcContext);
+
 /*! \brief Reads a character.
-  Reads a character from the parsed file and consumes it.
+  Reads a character from the parsed buffer and consumes it, refilling the buffer when needed.
   \param ppcContext Context of the tokenizer.
   \return Char of EOF.
 */
-static inline int read(struct ParseContext * ppcContext);
+static inline int readChar(struct ParseContext * ppcContext);
+
+/*! \brief Consumes a run of characters.
+  Moves the cursor to the first character of the buffer ending the run, as found by 'scan'.
+  The run stops at the end of the buffer, 'readChar' refills when the next character is read.
+  \param scan Scan function finding the end of the run.
+  \param bPush Set to append the run to the current token, a token must have been started.
+  \param ppcContext Context of the tokenizer.
+  \return Success, else error code when the token grew too long.
+*/
+static inline enum ParseResults skipRun(scanFunction scan, int8_t bPush, struct ParseContext * ppcContext);
 
 /*! \brief Handles EOF.
   Checks 'character' for EOF.
@@ -64,6 +111,12 @@ static inline int read(struct ParseContext * ppcContext);
 */
 static inline enum ParseResults endOnEOF(int character, enum TokenType failure, struct ParseContext * ppcContext);
 
+/*! \brief Appends the character just read to the current token.
+  \param ppcContext Context of the tokenizer.
+  \return Success if the character fits, else error code.
+*/
+static inline enum ParseResults pushChar(struct ParseContext * ppcContext);
+
 /*! \brief Sends expression to callback.
   Sends an expression to the callback.
   \param type Type of token.
@@ -74,71 +127,161 @@ static enum ParseResults sendExpression(enum TokenType type, struct ParseContext
 
 
 // ----------------- Global Function definitions --------------------------
-enum ParseResults parseFile(const char * path, parserCallback fnCallback) {
+enum ParseResults parseFile(const char * path, parserCallback fnCallback, void * user) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return RErrIO;
+  }
+  enum ParseResults result = parseDescriptor(fd, PARSE_BLOCK_SIZE, fnCallback, user);
+  close(fd);
+  return result;
+}
+
+enum ParseResults parseDescriptor(int fd, size_t uiBlockSize, parserCallback fnCallback, void * user) {
   struct ParseContext pcContext;
-  pcContext.file = fopen(path, "r");
-  if (!pcContext.file) {
-    return 0;
+  if (fd < 0) {
+    return RErrIO;
+  }
+  if (uiBlockSize < MIN_BLOCK_SIZE) {
+    uiBlockSize = MIN_BLOCK_SIZE;
+  }
+  pcContext.pcBlock = (char *)malloc(uiBlockSize);
+  if (!pcContext.pcBlock) {
+    return RErrIO;
+  }
+  pcContext.fd = fd;
+  pcContext.uiBlockSize = uiBlockSize;
+  // start empty, the first read refills
+  pcContext.pcCursor = pcContext.pcBlock;
+  pcContext.pcEnd = pcContext.pcBlock;
+  return tokenize(&pcContext, fnCallback, user);
+}
+
+enum ParseResults parseBuffer(const char * data, size_t len, parserCallback fnCallback, void * user) {
+  struct ParseContext pcContext;
+  if (!data && len) {
+    return RErrIO;
   }
-  
-  pcContext.list = createList(NULL);
-  pcContext.iLine = 1;
-  pcContext.iColumn = 0;
-  pcContext.fnCallback = fnCallback;
+  pcContext.fd = -1;
+  pcContext.pcBlock = NULL;
+  pcContext.uiBlockSize = 0;
+  pcContext.pcCursor = data;
+  pcContext.pcEnd = data + len;
+  return tokenize(&pcContext, fnCallback, user);
+}
+
+enum ParseResults parseFileMapped(const char * path, parserCallback fnCallback, void * user) {
+  size_t len;
+  const char * data = mapFile(path, &len);
+  if (!data) {
+    return RErrIO;
+  }
+  enum ParseResults result = parseBuffer(data, len, fnCallback, user);
+  unmapFile(data, len);
+  return result;
+}
+
+const char * mapFile(const char * path, size_t * pLen) {
+  if (!path || !pLen) {
+    return NULL;
+  }
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return NULL;
+  }
+  *pLen = (size_t)st.st_size;
+  // an empty file can not be mapped, but is a valid (empty) input
+  if (st.st_size == 0) {
+    close(fd);
+    return "";
+  }
+  void * data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps the file alive, descriptor is no longer needed
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+  return (const char *)data;
+}
+
+void unmapFile(const char * data, size_t len) {
+  if (data && len) {
+    munmap((void *)data, len);
+  }
+}
+
+
+// ----------------- Local Function definitions ---------------------------
+static enum ParseResults tokenize(struct ParseContext * ppcContext, parserCallback fnCallback, void * user) {
+  ppcContext->uiLength = 0;
+  ppcContext->pcToken = NULL;
+  ppcContext->bError = 0;
+  ppcContext->bLineOpen = 0;
+  ppcContext->iLine = 1;
+  ppcContext->iColumn = 0;
+  ppcContext->fnCallback = fnCallback;
+  ppcContext->user = user;
+  ppcContext->scanner = getScanner();
   enum ParseResults result = ROk;
 
-  // cast c to void* and pass to list when adding
-  // a copy of the char is then kept by the list as pointer
-  // while the pointer IS the actual char
-  // as long as c is larger then zero, this does not matter for the list
-  int c = read(&pcContext);
+  int c = readChar(ppcContext);
   while (c != EOF) {
     int unkown = 1;
 
     // select token catagory
     // NO TOKEN
-    if (c == '#' && pcContext.iColumn == 1) {
+    if (c == '#' && ppcContext->iColumn == 1) {
       unkown = 0;
 
       do {
-	if ((c = read(&pcContext)) == EOF) {
+	skipRun(ppcContext->scanner->findNewline, 0, ppcContext);
+	if ((c = readChar(ppcContext)) == EOF) {
+	  cleanUp(ppcContext);
 	  return ROk;
 	}
       } while (c != '\n' && c != '\r');
       do {
-	if ((c = read(&pcContext)) == EOF) {
+	if ((c = readChar(ppcContext)) == EOF) {
+	  cleanUp(ppcContext);
 	  return ROk;
 	}
       } while (c == '\n' || c == '\r');
 
-      ++pcContext.iLine;
-      pcContext.iColumn = 1;
+      ++ppcContext->iLine;
+      ppcContext->iColumn = 1;
     }
 
     // END LINE
     if (c == '\n' || c == '\r') {
       unkown = 0;
 
-      c = read(&pcContext);
-      if ((result = endOnEOF(c, TTEndLine, &pcContext))) {
+      c = readChar(ppcContext);
+      if ((result = endOnEOF(c, TTEndLine, ppcContext))) {
 	return result;
       }
       if (c == '\n') {
-	c = read(&pcContext);
-	if ((result = endOnEOF(c, TTEndLine, &pcContext))) {
+	c = readChar(ppcContext);
+	if ((result = endOnEOF(c, TTEndLine, ppcContext))) {
 	  return result;
 	}
       }
-      if (!(*pcContext.fnCallback)(TTEndLine, "\0")) {
-	reportAndClean("Parsing cancelled", &pcContext);
+      if (!(*ppcContext->fnCallback)(TTEndLine, (Token){ "", 0 }, ppcContext->user)) {
+	reportAndClean("Parsing cancelled", ppcContext);
 	return RErrCanceled;
       }
+      ppcContext->bLineOpen = 0;
 
-      ++pcContext.iLine;
-      pcContext.iColumn = 1;
+      ++ppcContext->iLine;
+      ppcContext->iColumn = 1;
     }
     
-    // NUMBER (start with number or sign) (dot is only allowed after a number AND when a number follows)
+    // NUMBER (start with number or sign) (dot is only allowed after a number AND when a number follows) (exponent follows 'readFloat')
     if (c == '-' || (c >= '0' && c <= '9')) {
       // number state
       char hashead = 0;
@@ -147,9 +290,11 @@ enum ParseResults parseFile(const char * path, parserCallback fnCallback) {
       unkown = 0;
       
       if (c == '-') {
-	addEntry(pcContext.list, getEnd(pcContext.list), (void *)c);
-	c = read(&pcContext);
-	if ((result = endOnEOF(c, TTNumber, &pcContext))) {
+	if ((result = pushChar(ppcContext))) {
+	  return result;
+	}
+	c = readChar(ppcContext);
+	if ((result = endOnEOF(c, TTNumber, ppcContext))) {
 	  return result;
 	}
       }
@@ -157,7 +302,7 @@ enum ParseResults parseFile(const char * path, parserCallback fnCallback) {
       while ((c >= '0' && c <= '9') || c == '.') {
 	if (c == '.') {
 	  if (hasdot || !hashead) {
-	    reportAndClean("Invalid number", &pcContext);
+	    reportAndClean("Invalid number", ppcContext);
 	    return RErrInvalidToken;
 	  }
 	  hasdot = 1;
@@ -166,90 +311,196 @@ enum ParseResults parseFile(const char * path, parserCallback fnCallback) {
 	} else {
 	  hastail = 1;
 	}
-	addEntry(pcContext.list, getEnd(pcContext.list), (void *)c);
-	c = read(&pcContext);
-	if ((result = endOnEOF(c, TTNumber, &pcContext))) {
+	if ((result = pushChar(ppcContext))) {
+	  return result;
+	}
+	// remaining digits of the run at once, any of them is a digit following the head
+	if (c != '.') {
+	  uint32_t uiLength = ppcContext->uiLength;
+	  if ((result = skipRun(ppcContext->scanner->skipDigits, 1, ppcContext))) {
+	    return result;
+	  }
+	  hastail |= uiLength != ppcContext->uiLength;
+	}
+	c = readChar(ppcContext);
+	if ((result = endOnEOF(c, TTNumber, ppcContext))) {
 	  return result;
 	}
       }
 
       if (!hastail && hasdot) {
-	reportAndClean("Invalid number", &pcContext);
+	reportAndClean("Invalid number", ppcContext);
 	return RErrInvalidToken;
       }
+
+      // EXPONENT (e or E after the digits, optionally signed, at least one digit must follow)
+      // a sign without digits stays a number of its own and the e starts a text, as before exponents were read
+      if (hashead && (c == 'e' || c == 'E')) {
+	if ((result = pushChar(ppcContext))) {
+	  return result;
+	}
+	c = readChar(ppcContext);
+	if ((result = endOnEOF(c, TTNumber, ppcContext))) {
+	  return result;
+	}
+	if (c == '-' || c == '+') {
+	  if ((result = pushChar(ppcContext))) {
+	    return result;
+	  }
+	  c = readChar(ppcContext);
+	  if ((result = endOnEOF(c, TTNumber, ppcContext))) {
+	    return result;
+	  }
+	}
+	if (c < '0' || c > '9') {
+	  reportAndClean("Invalid number", ppcContext);
+	  return RErrInvalidToken;
+	}
+	while (c >= '0' && c <= '9') {
+	  if ((result = pushChar(ppcContext))) {
+	    return result;
+	  }
+	  c = readChar(ppcContext);
+	  if ((result = endOnEOF(c, TTNumber, ppcContext))) {
+	    return result;
+	  }
+	}
+      }
       
-      sendExpression(TTNumber, &pcContext);
-      clearList(pcContext.list);
+      sendExpression(TTNumber, ppcContext);
+      ppcContext->uiLength = 0;
     }
 
     // TEXT (starts at a-zA-Z_ stops at whitespace)
     if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
       unkown = 0;
  
-      while (!isspace(c)) {
-	addEntry(pcContext.list, getEnd(pcContext.list), (void *)c);
-	c = read(&pcContext);
-	if ((result = endOnEOF(c, TTText, &pcContext))) {
+      while (c != EOF && !(acCharClass[c] & CCSpace)) {
+	if ((result = pushChar(ppcContext))) {
+	  return result;
+	}
+	if ((result = skipRun(ppcContext->scanner->findSpace, 1, ppcContext))) {
+	  return result;
+	}
+	c = readChar(ppcContext);
+	if ((result = endOnEOF(c, TTText, ppcContext))) {
 	  return result;
 	}
       }
       
-      sendExpression(TTText, &pcContext);
-      clearList(pcContext.list);
+      sendExpression(TTText, ppcContext);
+      ppcContext->uiLength = 0;
     }
     
     if (unkown) {
-      c = read(&pcContext);
-      if ((result = endOnEOF(c, TTEndLine, &pcContext))) {
+      c = readChar(ppcContext);
+      if ((result = endOnEOF(c, TTEndLine, ppcContext))) {
 	return result;
       }
     }
   }
 
-  cleanUp(&pcContext);
-  return ROk;
+  // close the last line when the input does not end with a line end
+  if (ppcContext->bLineOpen && !(*ppcContext->fnCallback)(TTEndLine, (Token){ "", 0 }, ppcContext->user)) {
+    reportAndClean("Parsing cancelled", ppcContext);
+    return RErrCanceled;
+  }
+
+  cleanUp(ppcContext);
+  return ppcContext->bError ? RErrIO : ROk;
 }
 
 
-// ----------------- Local Function definitions ---------------------------
 static inline void reportError(const char * ccaMessage, const struct ParseContext * cppcContext) {
   printf("Errror: %s at line %d[%d]\n", ccaMessage, cppcContext->iLine, cppcContext->iColumn);
 }
 static inline void cleanUp(struct ParseContext * ppcContext) {
-  destroyList(ppcContext->list);
-  fclose(ppcContext->file);
+  free(ppcContext->pcBlock);
+  ppcContext->pcBlock = NULL;
 }
 static inline void reportAndClean(const char * ccaMessage, struct ParseContext * ppcContext) {
   reportError(ccaMessage, ppcContext);
   cleanUp(ppcContext);
 }
 
-static inline int read(struct ParseContext * ppcContext) {
+static int8_t refill(struct ParseContext * ppcContext) {
+  // plain buffers are consumed at once
+  if (!ppcContext->pcBlock) {
+    return 0;
+  }
+  // carry the part of the current token over, tokens never exceed TOKEN_SIZE so there is always room left
+  size_t uiKeep = ppcContext->uiLength;
+  if (uiKeep) {
+    memmove(ppcContext->pcBlock, ppcContext->pcToken, uiKeep);
+    ppcContext->pcToken = ppcContext->pcBlock;
+  }
+  ssize_t iRead;
+  do {
+    iRead = read(ppcContext->fd, ppcContext->pcBlock + uiKeep, ppcContext->uiBlockSize - uiKeep);
+  } while (iRead < 0 && errno == EINTR);
+  if (iRead <= 0) {
+    ppcContext->bError = iRead < 0;
+    ppcContext->pcCursor = ppcContext->pcEnd = ppcContext->pcBlock + uiKeep;
+    return 0;
+  }
+  ppcContext->pcCursor = ppcContext->pcBlock + uiKeep;
+  ppcContext->pcEnd = ppcContext->pcCursor + iRead;
+  return 1;
+}
+
+static inline int readChar(struct ParseContext * ppcContext) {
   ++ppcContext->iColumn;
-  return fgetc(ppcContext->file);
+  if (ppcContext->pcCursor == ppcContext->pcEnd && !refill(ppcContext)) {
+    return EOF;
+  }
+  return (unsigned char)*ppcContext->pcCursor++;
+}
+
+static inline enum ParseResults skipRun(scanFunction scan, int8_t bPush, struct ParseContext * ppcContext) {
+  const char * pcStop = (*scan)(ppcContext->pcCursor, ppcContext->pcEnd);
+  size_t uiRun = pcStop - ppcContext->pcCursor;
+  if (bPush) {
+    if (ppcContext->uiLength + uiRun > TOKEN_SIZE) {
+      reportAndClean("Token too long", ppcContext);
+      return RErrInvalidToken;
+    }
+    ppcContext->uiLength += uiRun;
+  }
+  ppcContext->iColumn += uiRun;
+  ppcContext->pcCursor = pcStop;
+  return ROk;
 }
 
 static inline enum ParseResults endOnEOF(int character, enum TokenType failure, struct ParseContext * ppcContext) {
   if (character == EOF) {
-    if (!(*ppcContext->fnCallback)(failure, "\0")) {
+    if (!(*ppcContext->fnCallback)(failure, (Token){ "", 0 }, ppcContext->user)) {
       reportAndClean("Parsing cancelled", ppcContext);
       return RErrCanceled;
     }
+    if (failure == TTEndLine) {
+      ppcContext->bLineOpen = 0;
+    }
+  }
+  return ROk;
+}
+
+static inline enum ParseResults pushChar(struct ParseContext * ppcContext) {
+  // tokens are views on the buffer itself, characters of a token are always consecutive
+  if (ppcContext->uiLength == TOKEN_SIZE) {
+    reportAndClean("Token too long", ppcContext);
+    return RErrInvalidToken;
+  }
+  if (!ppcContext->uiLength++) {
+    ppcContext->pcToken = ppcContext->pcCursor - 1;
   }
   return ROk;
 }
 
 static enum ParseResults sendExpression(enum TokenType type, struct ParseContext * ppcContext) {
-  int iSize;
-  if ((iSize = getSize(ppcContext->list)) > 0) {
-    char * token = (char *)malloc(sizeof(char) * (iSize + 1));
-    int i;
-    Iterator * iter;
-    for (i = 0, iter = getBegin(ppcContext->list); i < iSize && iter; ++i, moveNext(&iter)) {
-      token[i] = (char)getCurrent(iter);
-    }
-    token[i] = '\0';
-    if (!(*ppcContext->fnCallback)(type, (Token)token)) {
+  if (ppcContext->uiLength > 0) {
+    Token token = { ppcContext->pcToken, ppcContext->uiLength };
+    ppcContext->bLineOpen = 1;
+    if (!(*ppcContext->fnCallback)(type, token, ppcContext->user)) {
       return RErrCanceled;
     }
     return ROk;
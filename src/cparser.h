@@ -2,12 +2,16 @@
 
 /*! \file cparser.h
   \brief Basic text stream tokenizer.
+  Numbers are an optional '-', digits with an optional fraction and an optional exponent: 'e' or 'E', an optional sign and
+  at least one digit. An 'e' right after the digits always starts the exponent, so "1e" and "2ex" are invalid numbers.
+  A '-' without digits is a number token of its own, in "-e1" the 'e' starts a text token.
   \author cxnf
   \version 1
   \date 2013-10-21
   \copyright GNU Public License
 */
 
+#include <stddef.h>
 #include <stdint.h>
 
 /*! \enum TokenType
@@ -27,20 +31,84 @@ enum ParseResults {
   RErrCanceled,                                   //!< Parse operation canceled by callback.
   RErrInvalidToken,                               //!< Invalid or unexpected token found.
   RErrMissingToken,                               //!< Missing token.
+  RErrIO,                                         //!< Input could not be opened or read.
 
   RErrEOF,                                        //!< End of file encountered, should strictly be used internally.
 };
 
-typedef const char * Token;                       //!< Token type.
-typedef int8_t (*parserCallback)(enum TokenType, Token); //!< Type of tokenizer callback.
+/*! \struct Token
+  \brief View on a token.
+  A token points into memory owned by the tokenizer.
+  The text is not zero terminated and is only valid until the callback returns, copy it to keep it.
+*/
+typedef struct Token {
+  const char * text;                              //!< First character of the token.
+  uint32_t length;                                //!< Amount of characters in the token.
+} Token;
+
+#define PARSE_BLOCK_SIZE (256 * 1024)             //!< Default size of blocks read from a stream.
+
+typedef int8_t (*parserCallback)(enum TokenType, Token, void *); //!< Type of tokenizer callback, last argument is the user pointer given to the parse function.
 
 /*! \brief Generate token stream from file stream.
   Generates a token stream from a file stream.
-  The file is read as a text file.
-  Generated tokens are send directly to the callback.
+  The file is read as a text file, in blocks of PARSE_BLOCK_SIZE bytes.
+  Generated tokens are send directly to the callback, the last token is always a line end.
+  Tokens are views on the block buffer, no memory is allocated per token.
   When the callback returns 0, the parse operation cancels.
   \param path Relative or absolute path to a text file, file must exists.
   \param fnCallback Pointer to function called when a new token is available.
+  \param user Pointer passed to every call of 'fnCallback'.
   \return ROk on success, error code otherwise.
 */
-enum ParseResults parseFile(const char * path, parserCallback fnCallback);
+enum ParseResults parseFile(const char * path, parserCallback fnCallback, void * user);
+
+/*! \brief Generate token stream from descriptor.
+  Generates a token stream from an open descriptor, which may be a pipe or stdin.
+  The descriptor is read in blocks of 'uiBlockSize' bytes, the descriptor is not closed.
+  Tokens crossing a block boundary are moved to the start of the next block, so they are always handed out as one view.
+  When the callback returns 0, the parse operation cancels.
+  \param fd Descriptor to read from.
+  \param uiBlockSize Size of the blocks read at once in bytes, small values are raised to a minimum of a few tokens.
+  \param fnCallback Pointer to function called when a new token is available.
+  \param user Pointer passed to every call of 'fnCallback'.
+  \return ROk on success, error code otherwise.
+*/
+enum ParseResults parseDescriptor(int fd, size_t uiBlockSize, parserCallback fnCallback, void * user);
+
+/*! \brief Generate token stream from memory.
+  Generates a token stream from a text held in memory, the text does not have to be zero terminated.
+  Tokens are views directly on 'data', nothing is copied.
+  When the callback returns 0, the parse operation cancels.
+  \param data Text to parse.
+  \param len Length of 'data' in bytes.
+  \param fnCallback Pointer to function called when a new token is available.
+  \param user Pointer passed to every call of 'fnCallback'.
+  \return ROk on success, error code otherwise.
+*/
+enum ParseResults parseBuffer(const char * data, size_t len, parserCallback fnCallback, void * user);
+
+/*! \brief Generate token stream from mapped file.
+  Maps a file into memory and generates a token stream from it like 'parseBuffer'.
+  No stdio is involved, the file must be a regular file.
+  \param path Relative or absolute path to a text file, file must exists.
+  \param fnCallback Pointer to function called when a new token is available.
+  \param user Pointer passed to every call of 'fnCallback'.
+  \return ROk on success, RErrIO when the file could not be mapped, error code otherwise.
+*/
+enum ParseResults parseFileMapped(const char * path, parserCallback fnCallback, void * user);
+
+/*! \brief Map a file into memory.
+  Maps a regular file read only into memory, the mapping must be released by 'unmapFile(const char *, size_t)'.
+  \param path Relative or absolute path to a file, file must exists.
+  \param pLen Pointer to receive the length of the file in bytes.
+  \return Contents of the file or NULL when the file could not be mapped.
+*/
+const char * mapFile(const char * path, size_t * pLen);
+
+/*! \brief Unmap a file.
+  Releases a mapping created by 'mapFile(const char *, size_t *)'.
+  \param data Contents of the file.
+  \param len Length of the file in bytes.
+*/
+void unmapFile(const char * data, size_t len);
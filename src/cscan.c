@@ -0,0 +1,227 @@
+#include "cscan.h"
+
+/*! \file cscan.c
+  \brief Character class scanning.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86 1                                //!< Vector implementations are available.
+#include <immintrin.h>
+#endif
+
+
+// ----------------- Global Variables -------------------------------------
+
+#define S CCSpace
+#define N (CCSpace | CCNewline)
+#define D CCDigit
+const uint8_t acCharClass[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, S, N, S, S, N, 0, 0,  // 0x00 tab, line feed, vertical tab, form feed, carriage return
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x10
+  S, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x20 space
+  D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0,  // 0x30 digits
+};
+#undef S
+#undef N
+#undef D
+
+
+// ----------------- Local Function declarations --------------------------
+
+/*! \brief Scalar scan functions.
+  Reference implementations, also used for the tails of the vector implementations.
+  \param begin First character to scan.
+  \param end End of the characters to scan.
+  \return First character ending the run, or end.
+*/
+static const char * findSpaceScalar(const char * begin, const char * end);
+static const char * findNewlineScalar(const char * begin, const char * end);
+static const char * skipDigitsScalar(const char * begin, const char * end);
+
+#ifdef SCAN_X86
+static const char * findSpaceSSE2(const char * begin, const char * end);
+static const char * findNewlineSSE2(const char * begin, const char * end);
+static const char * skipDigitsSSE2(const char * begin, const char * end);
+static const char * findSpaceAVX2(const char * begin, const char * end);
+static const char * findNewlineAVX2(const char * begin, const char * end);
+static const char * skipDigitsAVX2(const char * begin, const char * end);
+#endif
+
+
+// ----------------- Local Variables --------------------------------------
+
+static const Scanner scalarScanner = { findSpaceScalar, findNewlineScalar, skipDigitsScalar, SMScalar };
+#ifdef SCAN_X86
+static const Scanner sse2Scanner = { findSpaceSSE2, findNewlineSSE2, skipDigitsSSE2, SMSSE2 };
+static const Scanner avx2Scanner = { findSpaceAVX2, findNewlineAVX2, skipDigitsAVX2, SMAVX2 };
+#endif
+
+static const Scanner * activeScanner = NULL;      //!< Selected scanner, NULL until first use.
+
+
+// ----------------- Global Function definitions --------------------------
+const Scanner * getScanner(void) {
+  const Scanner * scanner = __atomic_load_n(&activeScanner, __ATOMIC_ACQUIRE);
+  // every thread selects the same implementation, so racing on the first use is harmless
+  if (!scanner) {
+    selectScanner(SMAuto);
+    scanner = __atomic_load_n(&activeScanner, __ATOMIC_ACQUIRE);
+  }
+  return scanner;
+}
+
+int8_t selectScanner(enum ScanMode mode) {
+  const Scanner * scanner = NULL;
+#ifdef SCAN_X86
+  __builtin_cpu_init();
+  int8_t bSSE2 = __builtin_cpu_supports("sse2") != 0;
+  int8_t bAVX2 = __builtin_cpu_supports("avx2") != 0;
+#else
+  int8_t bSSE2 = 0;
+  int8_t bAVX2 = 0;
+#endif
+
+  switch (mode) {
+  case SMAuto:
+    scanner = &scalarScanner;
+#ifdef SCAN_X86
+    if (bAVX2) {
+      scanner = &avx2Scanner;
+    } else if (bSSE2) {
+      scanner = &sse2Scanner;
+    }
+#endif
+    break;
+
+  case SMScalar:
+    scanner = &scalarScanner;
+    break;
+
+#ifdef SCAN_X86
+  case SMSSE2:
+    scanner = bSSE2 ? &sse2Scanner : NULL;
+    break;
+
+  case SMAVX2:
+    scanner = bAVX2 ? &avx2Scanner : NULL;
+    break;
+#endif
+
+  default: break;
+  }
+
+  if (!scanner) {
+    return 0;
+  }
+  __atomic_store_n(&activeScanner, scanner, __ATOMIC_RELEASE);
+  return 1;
+}
+
+
+// ----------------- Local Function definitions ---------------------------
+static const char * findSpaceScalar(const char * begin, const char * end) {
+  while (begin < end && !(acCharClass[(uint8_t)*begin] & CCSpace)) {
+    ++begin;
+  }
+  return begin;
+}
+static const char * findNewlineScalar(const char * begin, const char * end) {
+  while (begin < end && !(acCharClass[(uint8_t)*begin] & CCNewline)) {
+    ++begin;
+  }
+  return begin;
+}
+static const char * skipDigitsScalar(const char * begin, const char * end) {
+  while (begin < end && (acCharClass[(uint8_t)*begin] & CCDigit)) {
+    ++begin;
+  }
+  return begin;
+}
+
+#ifdef SCAN_X86
+// every vector function builds a mask with a bit set for each character ending the run, the lowest set bit is the answer
+// unsigned range checks use 'min(x - low, range) == x - low', SSE2 has no unsigned byte compare
+
+__attribute__((target("sse2")))
+static inline int maskSpace16(const char * chars) {
+  __m128i v = _mm_loadu_si128((const __m128i *)chars);
+  __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+  __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8('\r' - '\t')), offset));
+  return _mm_movemask_epi8(hits);
+}
+__attribute__((target("sse2")))
+static inline int maskNewline16(const char * chars) {
+  __m128i v = _mm_loadu_si128((const __m128i *)chars);
+  return _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+}
+__attribute__((target("sse2")))
+static inline int maskNonDigit16(const char * chars) {
+  __m128i offset = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)chars), _mm_set1_epi8('0'));
+  return ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(9)), offset)) & 0xFFFF;
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t maskSpace32(const char * chars) {
+  __m256i v = _mm256_loadu_si256((const __m256i *)chars);
+  __m256i offset = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+  __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8('\r' - '\t')), offset));
+  return (uint32_t)_mm256_movemask_epi8(hits);
+}
+__attribute__((target("avx2")))
+static inline uint32_t maskNewline32(const char * chars) {
+  __m256i v = _mm256_loadu_si256((const __m256i *)chars);
+  return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+}
+__attribute__((target("avx2")))
+static inline uint32_t maskNonDigit32(const char * chars) {
+  __m256i offset = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)chars), _mm256_set1_epi8('0'));
+  return ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(9)), offset));
+}
+
+// SSE2 scans 16 characters per step, the tail is scanned by the scalar function
+#define SCAN_SSE2(name, mask16, scalar) \
+  __attribute__((target("sse2"))) \
+  static const char * name(const char * begin, const char * end) { \
+    for (; end - begin >= 16; begin += 16) { \
+      int mask = mask16(begin); \
+      if (mask) { \
+        return begin + __builtin_ctz(mask); \
+      } \
+    } \
+    return scalar(begin, end); \
+  }
+
+// AVX2 probes 16 characters first, most runs in a wavefront (numbers, commands) are shorter than that
+// longer runs continue 32 characters per step, the tail is scanned by the SSE2 function
+#define SCAN_AVX2(name, mask16, mask32, sse2) \
+  __attribute__((target("avx2"))) \
+  static const char * name(const char * begin, const char * end) { \
+    if (end - begin >= 16) { \
+      int mask = mask16(begin); \
+      if (mask) { \
+        return begin + __builtin_ctz(mask); \
+      } \
+      begin += 16; \
+    } \
+    for (; end - begin >= 32; begin += 32) { \
+      uint32_t mask = mask32(begin); \
+      if (mask) { \
+        return begin + __builtin_ctz(mask); \
+      } \
+    } \
+    return sse2(begin, end); \
+  }
+
+SCAN_SSE2(findSpaceSSE2, maskSpace16, findSpaceScalar)
+SCAN_SSE2(findNewlineSSE2, maskNewline16, findNewlineScalar)
+SCAN_SSE2(skipDigitsSSE2, maskNonDigit16, skipDigitsScalar)
+SCAN_AVX2(findSpaceAVX2, maskSpace16, maskSpace32, findSpaceSSE2)
+SCAN_AVX2(findNewlineAVX2, maskNewline16, maskNewline32, findNewlineSSE2)
+SCAN_AVX2(skipDigitsAVX2, maskNonDigit16, maskNonDigit32, skipDigitsSSE2)
+#endif
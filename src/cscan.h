@@ -0,0 +1,58 @@
+#pragma once
+
+/*! \file cscan.h
+  \brief Character class scanning.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <stdint.h>
+
+/*! \enum CharClass
+  \brief Character class bits.
+  Classes follow the "C" locale.
+*/
+enum CharClass {
+  CCSpace           = 1 << 0,                     //!< Space, tab, line feed, vertical tab, form feed and carriage return, same as 'isspace'.
+  CCNewline         = 1 << 1,                     //!< Line feed and carriage return.
+  CCDigit           = 1 << 2,                     //!< '0' to '9'.
+};
+
+/*! \enum ScanMode
+  \brief Implementations of the scan functions.
+*/
+enum ScanMode {
+  SMAuto,                                         //!< Fastest implementation supported by the processor.
+  SMScalar,                                       //!< Table driven, one character at a time.
+  SMSSE2,                                         //!< 16 characters at a time.
+  SMAVX2,                                         //!< 32 characters at a time.
+};
+
+typedef const char * (*scanFunction)(const char *, const char *); //!< Returns first character in [begin, end) that ends a run, or end.
+
+/*! \struct Scanner
+  \brief Set of scan functions of one implementation.
+*/
+typedef struct Scanner {
+  scanFunction findSpace;                         //!< Finds the first CCSpace character.
+  scanFunction findNewline;                       //!< Finds the first CCNewline character.
+  scanFunction skipDigits;                        //!< Finds the first character that is not a CCDigit.
+  enum ScanMode mode;                             //!< Implementation of the functions.
+} Scanner;
+
+extern const uint8_t acCharClass[256];            //!< Classes of every character, combination of CharClass bits.
+
+/*! \brief Get scanner.
+  Returns the scanner selected by 'selectScanner', on first use the fastest supported implementation is selected.
+  \return Active scanner.
+*/
+const Scanner * getScanner(void);
+
+/*! \brief Select scanner.
+  Selects the implementation returned by 'getScanner', allows comparing implementations.
+  \param mode Implementation to select.
+  \return 1 on success, 0 when the processor does not support the implementation (selection is unchanged).
+*/
+int8_t selectScanner(enum ScanMode mode);
@@ -0,0 +1,475 @@
+#include "gclip.h"
+
+/*! \file gclip.c
+  \brief Line clipping in homogeneous clip space.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/27
+  \copyright GNU Public License.
+*/
+
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNEL_X86 1                              //!< Vector implementations are available.
+#include <immintrin.h>
+#endif
+
+
+// ----------------- Local Function declarations ---------------------------------------------------
+
+/*! \brief Outcode of a clip space point.
+  \param x X coordinate.
+  \param y Y coordinate.
+  \param z Z coordinate.
+  \param w W coordinate.
+  \return Combination of the CLIP_ bits.
+*/
+static inline uint8_t getOutcode(float x, float y, float z, float w);
+
+/*! \brief Transforms vertices to clip space.
+  Kernels of 'clipTransformSoA', each vector kernel leaves the vertices after the last whole vector to the scalar kernel.
+  \param m Elements of the transformation.
+  \param in Pointer to vertex buffer to transform.
+  \param out Pointer to clip buffer receiving the result.
+  \param first First vertex to transform.
+  \return First vertex that was not transformed.
+*/
+static uint32_t clipSoAScalar(float const * m, VertexBufferSoA const * in, ClipBuffer * out, uint32_t first);
+
+#ifdef KERNEL_X86
+static uint32_t clipSoASSE(float const * m, VertexBufferSoA const * in, ClipBuffer * out, uint32_t first);
+static uint32_t clipSoAAVX(float const * m, VertexBufferSoA const * in, ClipBuffer * out, uint32_t first);
+#endif
+
+/*! \brief Grows the storage of a clip output.
+  \param out Pointer to clip output.
+  \param vertices Amount of vertices that must fit.
+  \param indices Amount of indices that must fit.
+  \return Result code.
+*/
+static enum codes reserveClipOutput(ClipOutput * out, uint64_t vertices, uint64_t indices);
+
+/*! \brief Clips a line against the planes in 'codes' (Liang-Barsky).
+  \param a Start of the line.
+  \param b End of the line.
+  \param codes Planes to clip against, combination of the CLIP_ bits.
+  \param t0 Pointer to receive the start of the visible part, 0 is 'a'.
+  \param t1 Pointer to receive the end of the visible part, 1 is 'b'.
+  \return 1 if part of the line is visible, 0 otherwise.
+*/
+static int8_t clipSegment(Vector4 a, Vector4 b, uint8_t codes, float * t0, float * t1);
+
+/*! \brief Interpolates RGB565 colors per channel.
+  \param a Color at 0.
+  \param b Color at 1.
+  \param t Position.
+  \return Interpolated color.
+*/
+static Color lerpColor(Color a, Color b, float t);
+
+/*! \brief Writes a vertex to a clip output.
+  \param out Pointer to clip output with room for the vertex.
+  \param v Clip space coordinate.
+  \param color Color.
+  \param viewport Pointer to transformation to the screen, may be NULL.
+  \return Index of the written vertex.
+*/
+static uint32_t emitVertex(ClipOutput * out, Vector4 v, Color color, Matrix4 const * viewport);
+
+
+// ----------------- ClipBuffer Functions ----------------------------------------------------------
+
+enum codes initClipBuffer(uint32_t size, ClipBuffer * cb) {
+  // fail on NULL pointers
+  if (!cb) {
+    return NullPointer;
+  }
+  // at least one vector, so an empty buffer still has valid arrays
+  uint64_t capacity = size ? ((uint64_t)size + SOA_PAD - 1) & ~(uint64_t)(SOA_PAD - 1) : SOA_PAD;
+  // fail on sizes that do not fit
+  if (capacity > UINT32_MAX) {
+    return InvalidParam;
+  }
+  size_t floats = sizeof(float) * (size_t)capacity;
+  size_t colors = sizeof(Color) * (size_t)capacity;
+  // aligned_alloc needs a multiple of the alignment, the outcodes alone are only a multiple of SOA_PAD
+  size_t bytes = (floats * 4 + colors + (size_t)capacity + SOA_ALIGN - 1) & ~(size_t)(SOA_ALIGN - 1);
+  char * block = (char *)aligned_alloc(SOA_ALIGN, bytes);
+  // fail on malloc failure
+  if (!block) {
+    return MemAlloc;
+  }
+  cb->x = (float *)block;
+  cb->y = (float *)(block + floats);
+  cb->z = (float *)(block + floats * 2);
+  cb->w = (float *)(block + floats * 3);
+  cb->color = (Color *)(block + floats * 4);
+  cb->outcode = (uint8_t *)(block + floats * 4 + colors);
+  cb->size = size;
+  cb->capacity = (uint32_t)capacity;
+  return Success;
+}
+
+void freeClipBuffer(ClipBuffer * cb) {
+  if (!cb) {
+    return;
+  }
+  // all arrays share the block starting at 'x'
+  free(cb->x);
+  cb->x = cb->y = cb->z = cb->w = NULL;
+  cb->color = NULL;
+  cb->outcode = NULL;
+  cb->size = 0;
+  cb->capacity = 0;
+}
+
+enum codes clipTransform(Matrix4 const * matrix, VertexBuffer const * in, ClipBuffer * out) {
+  // fail on NULL pointers
+  if (!matrix || !in || !out || (!in->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->capacity < in->size) {
+    return InvalidBuffer;
+  }
+  // same evaluation order as 'transformVector'
+  float const * m = matrix->m;
+  uint32_t i;
+  for (i = 0; i < in->size; ++i) {
+    float x = in->vertices[i].coord.x, y = in->vertices[i].coord.y, z = in->vertices[i].coord.z;
+    out->x[i] = ((m[0] * x + m[1] * y) + m[2] * z) + m[3];
+    out->y[i] = ((m[4] * x + m[5] * y) + m[6] * z) + m[7];
+    out->z[i] = ((m[8] * x + m[9] * y) + m[10] * z) + m[11];
+    out->w[i] = ((m[12] * x + m[13] * y) + m[14] * z) + m[15];
+    out->color[i] = in->vertices[i].color;
+    out->outcode[i] = getOutcode(out->x[i], out->y[i], out->z[i], out->w[i]);
+  }
+  out->size = in->size;
+  return Success;
+}
+
+enum codes clipTransformSoA(Matrix4 const * matrix, VertexBufferSoA const * in, ClipBuffer * out) {
+  // fail on NULL pointers
+  if (!matrix || !in || !out) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->capacity < in->size) {
+    return InvalidBuffer;
+  }
+  uint32_t first = 0;
+  switch (getKernel()) {
+#ifdef KERNEL_X86
+  case KAVX:
+    first = clipSoAAVX(matrix->m, in, out, first);
+    // the SSE kernel takes a remaining half vector
+    /* fall through */
+  case KSSE:
+    first = clipSoASSE(matrix->m, in, out, first);
+    break;
+#endif
+
+  default: break;
+  }
+  clipSoAScalar(matrix->m, in, out, first);
+  if (in->size) {
+    memcpy(out->color, in->color, sizeof(Color) * in->size);
+  }
+  out->size = in->size;
+  return Success;
+}
+
+
+// ----------------- Clip Functions ----------------------------------------------------------------
+
+void initClipOutput(ClipOutput * out) {
+  if (!out) {
+    return;
+  }
+  memset(out, 0, sizeof(ClipOutput));
+  out->mesh.indices.width = Index32;
+}
+
+void freeClipOutput(ClipOutput * out) {
+  if (!out) {
+    return;
+  }
+  free(out->mesh.vertices.vertices);
+  free(out->mesh.indices.indices32);
+  free(out->remap);
+  initClipOutput(out);
+}
+
+enum codes clipLines(ClipBuffer const * clip, IndexBuffer const * lines, Matrix4 const * viewport, ClipOutput * out, ClipStats * stats) {
+  // fail on NULL pointers
+  if (!clip || !lines || !out || (!lines->indices && lines->size)) {
+    return NullPointer;
+  }
+  // the remap table is cleared every call, it is the only cost that scales with the vertices instead of the lines
+  if (out->remapCapacity < clip->size) {
+    uint32_t * remap = (uint32_t *)realloc(out->remap, sizeof(uint32_t) * clip->size);
+    // fail on malloc failure
+    if (!remap) {
+      return MemAlloc;
+    }
+    out->remap = remap;
+    out->remapCapacity = clip->size;
+  }
+  if (clip->size) {
+    memset(out->remap, 0, sizeof(uint32_t) * clip->size);
+  }
+  out->mesh.vertices.size = 0;
+  out->mesh.indices.size = 0;
+
+  ClipStats s = {0, 0, 0};
+  uint32_t first[LINE_BATCH];
+  uint32_t second[LINE_BATCH];
+  uint8_t any[LINE_BATCH];
+  uint8_t all[LINE_BATCH];
+  uint32_t count = lines->size / 2;
+  uint32_t line;
+  for (line = 0; line < count; line += LINE_BATCH) {
+    uint32_t batch = count - line < LINE_BATCH ? count - line : LINE_BATCH;
+    uint32_t j;
+    // every line of a batch writes at most 2 vertices and 2 indices
+    enum codes code = reserveClipOutput(out, (uint64_t)out->mesh.vertices.size + batch * 2, (uint64_t)out->mesh.indices.size + batch * 2);
+    if (code != Success) {
+      return code;
+    }
+
+    // classify the whole batch first, a tight loop over the outcodes only
+    uint32_t bad = 0;
+    if (lines->width == Index16) {
+      for (j = 0; j < batch; ++j) {
+        first[j] = lines->indices[(size_t)(line + j) * 2];
+        second[j] = lines->indices[(size_t)(line + j) * 2 + 1];
+      }
+    } else {
+      for (j = 0; j < batch; ++j) {
+        first[j] = lines->indices32[(size_t)(line + j) * 2];
+        second[j] = lines->indices32[(size_t)(line + j) * 2 + 1];
+      }
+    }
+    for (j = 0; j < batch; ++j) {
+      bad |= first[j] >= clip->size || second[j] >= clip->size;
+    }
+    // fail on indices outside the clip buffer
+    if (bad) {
+      return InvalidBuffer;
+    }
+    for (j = 0; j < batch; ++j) {
+      uint8_t a = clip->outcode[first[j]];
+      uint8_t b = clip->outcode[second[j]];
+      any[j] = a | b;
+      all[j] = a & b;
+    }
+
+    // then write the survivors
+    uint32_t * indices = out->mesh.indices.indices32;
+    for (j = 0; j < batch; ++j) {
+      uint32_t a = first[j], b = second[j];
+      if (all[j]) {
+        ++s.rejected;
+        continue;
+      }
+      float t0 = 0.0f, t1 = 1.0f;
+      Vector4 va = {clip->x[a], clip->y[a], clip->z[a], clip->w[a]};
+      Vector4 vb = {clip->x[b], clip->y[b], clip->z[b], clip->w[b]};
+      if (any[j] && !clipSegment(va, vb, any[j], &t0, &t1)) {
+        ++s.rejected;
+        continue;
+      }
+      if (any[j]) {
+        ++s.clipped;
+      } else {
+        ++s.accepted;
+      }
+
+      // unclipped ends are shared through the remap table, clipped ends are new vertices
+      uint32_t ia, ib;
+      if (t0 == 0.0f) {
+        if (!out->remap[a]) {
+          out->remap[a] = emitVertex(out, va, clip->color[a], viewport) + 1;
+        }
+        ia = out->remap[a] - 1;
+      } else {
+        Vector4 v = {va.x + t0 * (vb.x - va.x), va.y + t0 * (vb.y - va.y), va.z + t0 * (vb.z - va.z), va.w + t0 * (vb.w - va.w)};
+        ia = emitVertex(out, v, lerpColor(clip->color[a], clip->color[b], t0), viewport);
+      }
+      if (t1 == 1.0f) {
+        if (!out->remap[b]) {
+          out->remap[b] = emitVertex(out, vb, clip->color[b], viewport) + 1;
+        }
+        ib = out->remap[b] - 1;
+      } else {
+        Vector4 v = {va.x + t1 * (vb.x - va.x), va.y + t1 * (vb.y - va.y), va.z + t1 * (vb.z - va.z), va.w + t1 * (vb.w - va.w)};
+        ib = emitVertex(out, v, lerpColor(clip->color[a], clip->color[b], t1), viewport);
+      }
+      indices[out->mesh.indices.size++] = ia;
+      indices[out->mesh.indices.size++] = ib;
+    }
+  }
+  if (stats) {
+    *stats = s;
+  }
+  return Success;
+}
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+static inline uint8_t getOutcode(float x, float y, float z, float w) {
+  return (x < -w) | (y < -w) << 1 | (z < -w) << 2 | (x > w) << 3 | (y > w) << 4 | (z > w) << 5;
+}
+
+static uint32_t clipSoAScalar(float const * m, VertexBufferSoA const * in, ClipBuffer * out, uint32_t first) {
+  // same evaluation order as 'transformVector'
+  uint32_t i;
+  for (i = first; i < in->size; ++i) {
+    float x = in->x[i], y = in->y[i], z = in->z[i];
+    out->x[i] = ((m[0] * x + m[1] * y) + m[2] * z) + m[3];
+    out->y[i] = ((m[4] * x + m[5] * y) + m[6] * z) + m[7];
+    out->z[i] = ((m[8] * x + m[9] * y) + m[10] * z) + m[11];
+    out->w[i] = ((m[12] * x + m[13] * y) + m[14] * z) + m[15];
+    out->outcode[i] = getOutcode(out->x[i], out->y[i], out->z[i], out->w[i]);
+  }
+  return i;
+}
+
+#ifdef KERNEL_X86
+// clip kernels mirror 'clipSoAScalar' lane by lane, every lane is a vertex
+// outcode bits are built as 32 bit lanes by masking the compares, then narrowed to bytes
+
+__attribute__((target("sse2")))
+static uint32_t clipSoASSE(float const * m, VertexBufferSoA const * in, ClipBuffer * out, uint32_t first) {
+  uint32_t i;
+  for (i = first; i + 4 <= in->size; i += 4) {
+    __m128 x = _mm_load_ps(&in->x[i]);
+    __m128 y = _mm_load_ps(&in->y[i]);
+    __m128 z = _mm_load_ps(&in->z[i]);
+#define ROW(r) _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[r * 4]), x), _mm_mul_ps(_mm_set1_ps(m[r * 4 + 1]), y)), \
+                                     _mm_mul_ps(_mm_set1_ps(m[r * 4 + 2]), z)), _mm_set1_ps(m[r * 4 + 3]))
+    __m128 tx = ROW(0), ty = ROW(1), tz = ROW(2), tw = ROW(3);
+#undef ROW
+    _mm_store_ps(&out->x[i], tx);
+    _mm_store_ps(&out->y[i], ty);
+    _mm_store_ps(&out->z[i], tz);
+    _mm_store_ps(&out->w[i], tw);
+    __m128 nw = _mm_xor_ps(tw, _mm_set1_ps(-0.0f));
+#define BIT(c, b) _mm_and_ps((c), _mm_castsi128_ps(_mm_set1_epi32(b)))
+    __m128 codes = _mm_or_ps(_mm_or_ps(BIT(_mm_cmplt_ps(tx, nw), CLIP_LEFT), BIT(_mm_cmplt_ps(ty, nw), CLIP_BOTTOM)),
+                             _mm_or_ps(BIT(_mm_cmplt_ps(tz, nw), CLIP_NEAR), BIT(_mm_cmpgt_ps(tx, tw), CLIP_RIGHT)));
+    codes = _mm_or_ps(codes, _mm_or_ps(BIT(_mm_cmpgt_ps(ty, tw), CLIP_TOP), BIT(_mm_cmpgt_ps(tz, tw), CLIP_FAR)));
+#undef BIT
+    __m128i bytes = _mm_packs_epi32(_mm_castps_si128(codes), _mm_setzero_si128());
+    bytes = _mm_packus_epi16(bytes, bytes);
+    int32_t packed = _mm_cvtsi128_si32(bytes);
+    memcpy(&out->outcode[i], &packed, sizeof(packed));
+  }
+  return i;
+}
+
+__attribute__((target("avx")))
+static uint32_t clipSoAAVX(float const * m, VertexBufferSoA const * in, ClipBuffer * out, uint32_t first) {
+  uint32_t i;
+  for (i = first; i + 8 <= in->size; i += 8) {
+    __m256 x = _mm256_load_ps(&in->x[i]);
+    __m256 y = _mm256_load_ps(&in->y[i]);
+    __m256 z = _mm256_load_ps(&in->z[i]);
+#define ROW(r) _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[r * 4]), x), _mm256_mul_ps(_mm256_set1_ps(m[r * 4 + 1]), y)), \
+                                           _mm256_mul_ps(_mm256_set1_ps(m[r * 4 + 2]), z)), _mm256_set1_ps(m[r * 4 + 3]))
+    __m256 tx = ROW(0), ty = ROW(1), tz = ROW(2), tw = ROW(3);
+#undef ROW
+    _mm256_store_ps(&out->x[i], tx);
+    _mm256_store_ps(&out->y[i], ty);
+    _mm256_store_ps(&out->z[i], tz);
+    _mm256_store_ps(&out->w[i], tw);
+    __m256 nw = _mm256_xor_ps(tw, _mm256_set1_ps(-0.0f));
+#define BIT(c, b) _mm256_and_ps((c), _mm256_castsi256_ps(_mm256_set1_epi32(b)))
+    __m256 codes = _mm256_or_ps(_mm256_or_ps(BIT(_mm256_cmp_ps(tx, nw, _CMP_LT_OQ), CLIP_LEFT), BIT(_mm256_cmp_ps(ty, nw, _CMP_LT_OQ), CLIP_BOTTOM)),
+                                _mm256_or_ps(BIT(_mm256_cmp_ps(tz, nw, _CMP_LT_OQ), CLIP_NEAR), BIT(_mm256_cmp_ps(tx, tw, _CMP_GT_OQ), CLIP_RIGHT)));
+    codes = _mm256_or_ps(codes, _mm256_or_ps(BIT(_mm256_cmp_ps(ty, tw, _CMP_GT_OQ), CLIP_TOP), BIT(_mm256_cmp_ps(tz, tw, _CMP_GT_OQ), CLIP_FAR)));
+#undef BIT
+    __m256i lanes = _mm256_castps_si256(codes);
+    __m128i bytes = _mm_packs_epi32(_mm256_castsi256_si128(lanes), _mm256_extractf128_si256(lanes, 1));
+    _mm_storel_epi64((__m128i *)&out->outcode[i], _mm_packus_epi16(bytes, bytes));
+  }
+  return i;
+}
+#endif
+
+static enum codes reserveClipOutput(ClipOutput * out, uint64_t vertices, uint64_t indices) {
+  // fail on sizes that do not fit
+  if (vertices > UINT32_MAX || indices > UINT32_MAX) {
+    return InvalidParam;
+  }
+  if (vertices > out->vertexCapacity) {
+    // grow by doubling, so a frame settles after a few calls
+    uint64_t capacity = out->vertexCapacity ? (uint64_t)out->vertexCapacity * 2 : LINE_BATCH * 2;
+    capacity = capacity < vertices ? vertices : capacity > UINT32_MAX ? UINT32_MAX : capacity;
+    Vertex * grown = (Vertex *)realloc(out->mesh.vertices.vertices, sizeof(Vertex) * (size_t)capacity);
+    // fail on malloc failure
+    if (!grown) {
+      return MemAlloc;
+    }
+    out->mesh.vertices.vertices = grown;
+    out->vertexCapacity = (uint32_t)capacity;
+  }
+  if (indices > out->indexCapacity) {
+    uint64_t capacity = out->indexCapacity ? (uint64_t)out->indexCapacity * 2 : LINE_BATCH * 2;
+    capacity = capacity < indices ? indices : capacity > UINT32_MAX ? UINT32_MAX : capacity;
+    uint32_t * grown = (uint32_t *)realloc(out->mesh.indices.indices32, sizeof(uint32_t) * (size_t)capacity);
+    // fail on malloc failure
+    if (!grown) {
+      return MemAlloc;
+    }
+    out->mesh.indices.indices32 = grown;
+    out->indexCapacity = (uint32_t)capacity;
+  }
+  return Success;
+}
+
+static int8_t clipSegment(Vector4 a, Vector4 b, uint8_t codes, float * t0, float * t1) {
+  // signed distances to the planes in the order of the CLIP_ bits, inside is >= 0
+  float da[6] = {a.w + a.x, a.w + a.y, a.w + a.z, a.w - a.x, a.w - a.y, a.w - a.z};
+  float db[6] = {b.w + b.x, b.w + b.y, b.w + b.z, b.w - b.x, b.w - b.y, b.w - b.z};
+  int plane;
+  for (plane = 0; plane < 6; ++plane) {
+    if (!(codes & (1 << plane))) {
+      continue;
+    }
+    float p = da[plane], q = db[plane];
+    if (p < 0.0f && q < 0.0f) {
+      return 0;
+    }
+    if (p < 0.0f) {
+      float t = p / (p - q);
+      *t0 = t > *t0 ? t : *t0;
+    } else if (q < 0.0f) {
+      float t = p / (p - q);
+      *t1 = t < *t1 ? t : *t1;
+    }
+  }
+  return *t0 <= *t1;
+}
+
+static Color lerpColor(Color a, Color b, float t) {
+  int ra = a >> 11, ga = (a >> 5) & 0x3F, ba = a & 0x1F;
+  int rb = b >> 11, gb = (b >> 5) & 0x3F, bb = b & 0x1F;
+  int r = (int)(ra + (rb - ra) * t + 0.5f);
+  int g = (int)(ga + (gb - ga) * t + 0.5f);
+  int bl = (int)(ba + (bb - ba) * t + 0.5f);
+  return (Color)(r << 11 | g << 5 | bl);
+}
+
+static uint32_t emitVertex(ClipOutput * out, Vector4 v, Color color, Matrix4 const * viewport) {
+  Vertex * vertex = &out->mesh.vertices.vertices[out->mesh.vertices.size];
+  Vector ndc = {v.x / v.w, v.y / v.w, v.z / v.w};
+  vertex->coord = viewport ? transformVector(viewport, ndc) : ndc;
+  vertex->color = color;
+  return out->mesh.vertices.size++;
+}
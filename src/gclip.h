@@ -0,0 +1,141 @@
+#ifndef GCLIP_H
+#define GCLIP_H
+
+/*! \file gclip.h
+  \brief Line clipping in homogeneous clip space.
+  Vertices are transformed to clip space once, with an outcode per vertex. Lines are then classified a batch at a time:
+  lines inside the view frustum are accepted, lines outside one plane are rejected and the rest is clipped (Liang-Barsky).
+  Surviving lines are written to a compacted screen space mesh.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/27
+  \copyright GNU Public License.
+*/
+
+
+#include "codes.h"
+#include "gtypes.h"
+#include "gsoa.h"
+#include <stdint.h>
+
+
+// outcode bits, the frustum is -w <= x, y, z <= w; the first 3 bits are the lower planes, the next 3 the upper planes
+#define CLIP_LEFT 0x01                            //!< x < -w.
+#define CLIP_BOTTOM 0x02                          //!< y < -w.
+#define CLIP_NEAR 0x04                            //!< z < -w, also holds for points behind the camera.
+#define CLIP_RIGHT 0x08                           //!< x > w.
+#define CLIP_TOP 0x10                             //!< y > w.
+#define CLIP_FAR 0x20                             //!< z > w.
+
+
+// ----------------- Structs -----------------------------------------------------------------------
+
+/*! \struct Vector4
+  \brief Homogeneous vector.
+*/
+typedef struct Vector4 {
+  float x, y, z, w;                               //!< Coordinate.
+} Vector4;
+
+/*! \struct ClipBuffer
+  \brief Clip space vertex buffer datastruct, structure of arrays.
+  Same layout rules as VertexBufferSoA: all arrays are SOA_ALIGN aligned and hold 'capacity' elements.
+*/
+typedef struct ClipBuffer {
+  float * x;                                      //!< X coordinates.
+  float * y;                                      //!< Y coordinates.
+  float * z;                                      //!< Z coordinates.
+  float * w;                                      //!< W coordinates.
+  Color * color;                                  //!< Colors.
+  uint8_t * outcode;                              //!< Outcodes, combination of the CLIP_ bits.
+  uint32_t size;                                  //!< Amount of vertices in buffer.
+  uint32_t capacity;                              //!< Amount of elements in every array, a multiple of SOA_PAD.
+} ClipBuffer;
+
+/*! \struct ClipOutput
+  \brief Result of 'clipLines'.
+  A mesh of surviving lines in screen space, vertices shared by accepted lines are written once.
+  Storage is kept between calls and only grows, the sizes of the mesh buffers are the amounts in use.
+*/
+typedef struct ClipOutput {
+  Mesh mesh;                                      //!< Surviving lines, 32 bit indices.
+  uint32_t * remap;                               //!< Per input vertex its output index + 1, 0 when not written yet.
+  uint32_t vertexCapacity;                        //!< Amount of vertices that fit in the mesh.
+  uint32_t indexCapacity;                         //!< Amount of indices that fit in the mesh.
+  uint32_t remapCapacity;                         //!< Amount of elements in 'remap'.
+} ClipOutput;
+
+/*! \struct ClipStats
+  \brief Line counts of 'clipLines'.
+*/
+typedef struct ClipStats {
+  uint32_t accepted;                              //!< Lines completely inside the frustum, written as they are.
+  uint32_t clipped;                               //!< Lines partly inside the frustum, written clipped.
+  uint32_t rejected;                              //!< Lines outside the frustum, trivially or after clipping.
+} ClipStats;
+
+
+// ----------------- ClipBuffer Functions ----------------------------------------------------------
+
+/*! \brief Initializes a clip space vertex buffer.
+  \param size Amount of vertices that will fit in the buffer.
+  \param cb Pointer to clip buffer to initialize.
+  \return Result code.
+  \see codes
+*/
+enum codes initClipBuffer(uint32_t size, ClipBuffer * cb);
+
+/*! \brief Frees a clip space vertex buffer.
+  \param cb Pointer to clip buffer initialized by 'initClipBuffer'.
+*/
+void freeClipBuffer(ClipBuffer * cb);
+
+/*! \brief Transforms a vertex buffer to clip space.
+  No division by w is done, every vertex gets its outcode.
+  \param matrix Pointer to transformation to clip space (projection * view * model).
+  \param in Pointer to vertex buffer to transform.
+  \param out Pointer to clip buffer, must hold at least 'in->size' vertices. Its size is set to 'in->size'.
+  \return Result code.
+  \see codes
+*/
+enum codes clipTransform(Matrix4 const * matrix, VertexBuffer const * in, ClipBuffer * out);
+
+/*! \brief Transforms a structure of arrays vertex buffer to clip space.
+  Same as 'clipTransform' and with identical results, 8 (AVX) or 4 (SSE) vertices per step.
+  \param matrix Pointer to transformation to clip space (projection * view * model).
+  \param in Pointer to vertex buffer to transform.
+  \param out Pointer to clip buffer, must hold at least 'in->size' vertices. Its size is set to 'in->size'.
+  \return Result code.
+  \see codes
+*/
+enum codes clipTransformSoA(Matrix4 const * matrix, VertexBufferSoA const * in, ClipBuffer * out);
+
+
+// ----------------- Clip Functions ----------------------------------------------------------------
+
+/*! \brief Initializes a clip output.
+  No storage is allocated until the first 'clipLines'.
+  \param out Pointer to clip output to initialize.
+*/
+void initClipOutput(ClipOutput * out);
+
+/*! \brief Frees a clip output.
+  \param out Pointer to clip output.
+*/
+void freeClipOutput(ClipOutput * out);
+
+/*! \brief Clips lines against the view frustum.
+  Lines are classified by the outcodes of their vertices a batch of LINE_BATCH lines at a time, only lines crossing a plane are clipped.
+  Written vertices are divided by w and transformed by 'viewport', clipped vertices get colors interpolated per channel.
+  \param clip Pointer to clip space vertices.
+  \param lines Pointer to index buffer with the lines, indices refer to 'clip'.
+  \param viewport Pointer to transformation from normalized device coordinates to the screen, NULL keeps normalized device coordinates.
+  \param out Pointer to initialized clip output, its mesh is replaced.
+  \param stats Pointer to receive the line counts, may be NULL.
+  \return Result code, InvalidBuffer for indices outside 'clip'.
+  \see codes
+*/
+enum codes clipLines(ClipBuffer const * clip, IndexBuffer const * lines, Matrix4 const * viewport, ClipOutput * out, ClipStats * stats);
+
+
+#endif // GCLIP_H
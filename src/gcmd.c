@@ -0,0 +1,164 @@
+#include "gcmd.h"
+
+/*! \file gcmd.c
+  \brief Line command buffers.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// ----------------- Local Function declarations ---------------------------------------------------
+
+/*! \brief Snaps screen coordinates to command points.
+  \param screen Pointer to vertices in screen coordinates.
+  \param points Points to receive the pixels.
+  \param valid Per vertex 1 when it fits 16 bits, 0 otherwise (and for NaN).
+*/
+static void snapPoints(VertexBuffer const * screen, CommandPoint * points, uint8_t * valid);
+
+
+// ----------------- Command Buffer Functions ------------------------------------------------------
+
+enum codes initCommandFrames(Mesh const * mesh, CommandFrames * frames) {
+  // fail on NULL pointers
+  if (!mesh || !frames) {
+    return NullPointer;
+  }
+  memset(frames, 0, sizeof(CommandFrames));
+  uint32_t lines = mesh->indices.size / 2;
+  size_t bytes = sizeof(LineCommand) * (size_t)(lines ? lines : 1);
+  bytes = (bytes + COMMAND_ALIGN - 1) & ~(size_t)(COMMAND_ALIGN - 1);
+  uint32_t i;
+  for (i = 0; i < COMMAND_BUFFERS; ++i) {
+    frames->buffers[i].commands = (LineCommand *)aligned_alloc(COMMAND_ALIGN, bytes);
+    frames->buffers[i].capacity = lines;
+  }
+  uint32_t vertices = mesh->vertices.size ? mesh->vertices.size : 1;
+  enum codes result = initVertexBuffer(vertices, &frames->screen);
+  frames->points = (CommandPoint *)malloc(sizeof(CommandPoint) * vertices);
+  frames->valid = (uint8_t *)malloc(vertices);
+  frames->vertices = mesh->vertices.size;
+  // fail on malloc failure
+  if (result != Success || !frames->points || !frames->valid || !frames->buffers[0].commands || !frames->buffers[1].commands) {
+    freeCommandFrames(frames);
+    return MemAlloc;
+  }
+  return Success;
+}
+
+void freeCommandFrames(CommandFrames * frames) {
+  if (!frames) {
+    return;
+  }
+  uint32_t i;
+  for (i = 0; i < COMMAND_BUFFERS; ++i) {
+    free(frames->buffers[i].commands);
+  }
+  free(frames->screen.vertices);
+  free(frames->points);
+  free(frames->valid);
+  memset(frames, 0, sizeof(CommandFrames));
+}
+
+enum codes buildCommandFrame(CommandFrames * frames, Mesh const * mesh, Matrix4 const * matrix, CommandBuffer ** buffer, FrameStats * stats) {
+  // fail on NULL pointers
+  if (!frames || !mesh || !matrix || !buffer || !frames->points) {
+    return NullPointer;
+  }
+  CommandBuffer * block = &frames->buffers[frames->next];
+  uint32_t lines = mesh->indices.size / 2;
+  // fail on a mesh larger than the frames were made for
+  if (lines > block->capacity || mesh->vertices.size > frames->vertices) {
+    return InvalidBuffer;
+  }
+  // fail on a block the device still reads
+  if (__atomic_load_n(&block->busy, __ATOMIC_ACQUIRE)) {
+    return Failed;
+  }
+
+  VertexBuffer screen = { frames->screen.vertices, mesh->vertices.size };
+  enum codes result = transformVertexBuffer(matrix, &mesh->vertices, &screen);
+  if (result != Success) {
+    return result;
+  }
+  snapPoints(&screen, frames->points, frames->valid);
+
+  // one linear pass, records are written back to back and dropped lines leave no gap
+  CommandPoint const * points = frames->points;
+  uint8_t const * valid = frames->valid;
+  Vertex const * vertices = mesh->vertices.vertices;
+  LineCommand * out = block->commands;
+  uint32_t known = mesh->vertices.size;
+  uint32_t count = 0;
+  uint32_t i;
+  if (mesh->indices.width == Index16) {
+    uint16_t const * indices = mesh->indices.indices;
+    for (i = 0; i < lines; ++i) {
+      uint32_t a = indices[i * 2], b = indices[i * 2 + 1];
+      // fail on indices outside the vertices, the block stays free
+      if (a >= known || b >= known) {
+        return InvalidBuffer;
+      }
+      LineCommand command = { points[a].x, points[a].y, points[b].x, points[b].y, vertices[a].color, 0 };
+      out[count] = command;
+      count += valid[a] & valid[b];
+    }
+  } else {
+    uint32_t const * indices = mesh->indices.indices32;
+    for (i = 0; i < lines; ++i) {
+      uint32_t a = indices[i * 2], b = indices[i * 2 + 1];
+      // fail on indices outside the vertices, the block stays free
+      if (a >= known || b >= known) {
+        return InvalidBuffer;
+      }
+      LineCommand command = { points[a].x, points[a].y, points[b].x, points[b].y, vertices[a].color, 0 };
+      out[count] = command;
+      count += valid[a] & valid[b];
+    }
+  }
+
+  block->count = count;
+  block->frame = ++frames->frames;
+  __atomic_store_n(&block->busy, 1, __ATOMIC_RELEASE);
+  frames->next = (frames->next + 1) % COMMAND_BUFFERS;
+  *buffer = block;
+  if (stats) {
+    uint32_t width = mesh->indices.width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    stats->lines = lines;
+    stats->records = count;
+    stats->dropped = lines - count;
+    stats->bytes = sizeof(LineCommand) * (uint64_t)count;
+    stats->sourceBytes = (uint64_t)lines * 2 * (width + sizeof(Vertex));
+  }
+  return Success;
+}
+
+void releaseCommandFrame(CommandBuffer * buffer) {
+  if (!buffer) {
+    return;
+  }
+  __atomic_store_n(&buffer->busy, 0, __ATOMIC_RELEASE);
+}
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+static void snapPoints(VertexBuffer const * screen, CommandPoint * points, uint8_t * valid) {
+  uint32_t i;
+  for (i = 0; i < screen->size; ++i) {
+    float x = screen->vertices[i].coord.x;
+    float y = screen->vertices[i].coord.y;
+    // same range as the commands of 'submitMesh'
+    uint8_t inside = x >= (float)INT16_MIN && x < (float)INT16_MAX + 1.0f && y >= (float)INT16_MIN && y < (float)INT16_MAX + 1.0f;
+    points[i].x = inside ? (int16_t)floorf(x) : 0;
+    points[i].y = inside ? (int16_t)floorf(y) : 0;
+    valid[i] = inside;
+  }
+}
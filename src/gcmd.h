@@ -0,0 +1,112 @@
+#ifndef GCMD_H
+#define GCMD_H
+
+/*! \file gcmd.h
+  \brief Line command buffers.
+  Serializes a mesh into one contiguous block of LineCommands per frame, the layout the FPGA reads in a single DMA burst.
+  Two blocks are kept, so frame N + 1 is built while the device still reads frame N.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include "codes.h"
+#include "gring.h"
+#include "gtypes.h"
+#include <stdint.h>
+
+
+#define COMMAND_ALIGN 4096                        //!< Alignment of a command block in bytes, a page so a burst never starts mid page.
+#define COMMAND_BUFFERS 2                         //!< Amount of command blocks.
+
+
+// ----------------- Structs -----------------------------------------------------------------------
+
+/*! \struct CommandBuffer
+  \brief Command block of one frame.
+*/
+typedef struct CommandBuffer {
+  LineCommand * commands;                         //!< Records, COMMAND_ALIGN aligned.
+  uint32_t count;                                 //!< Amount of records of the frame.
+  uint32_t capacity;                              //!< Amount of records that fit.
+  uint64_t frame;                                 //!< Number of the frame in the block, counting from 1.
+  uint32_t busy;                                  //!< 1 from 'buildCommandFrame' until 'releaseCommandFrame'.
+} CommandBuffer;
+
+/*! \struct CommandPoint
+  \brief Vertex snapped to the pixel coordinates of a command.
+*/
+typedef struct CommandPoint {
+  int16_t x;                                      //!< X of the pixel.
+  int16_t y;                                      //!< Y of the pixel.
+} CommandPoint;
+
+/*! \struct CommandFrames
+  \brief Double buffered command blocks with the scratch space to build them.
+  Sized for one mesh by 'initCommandFrames' and reused every frame.
+*/
+typedef struct CommandFrames {
+  CommandBuffer buffers[COMMAND_BUFFERS];         //!< Command blocks, used in turn.
+  VertexBuffer screen;                            //!< Vertices in screen coordinates.
+  CommandPoint * points;                          //!< Vertices snapped to pixels.
+  uint8_t * valid;                                //!< Per vertex 1 when it fits the coordinates of a command.
+  uint32_t vertices;                              //!< Amount of vertices the scratch space holds.
+  uint32_t next;                                  //!< Block the next frame is built in.
+  uint64_t frames;                                //!< Frames built.
+} CommandFrames;
+
+/*! \struct FrameStats
+  \brief Counts of 'buildCommandFrame'.
+  The cost per line on the bus is 'bytes' / 'records', against 'sourceBytes' / 'lines' to fetch a line through the index buffer.
+*/
+typedef struct FrameStats {
+  uint32_t lines;                                 //!< Lines of the mesh.
+  uint32_t records;                               //!< Records written.
+  uint32_t dropped;                               //!< Lines with an end point outside the coordinates of a command.
+  uint64_t bytes;                                 //!< Size of the block in bytes.
+  uint64_t sourceBytes;                           //!< Bytes of indices and vertices read per line, summed over all lines.
+} FrameStats;
+
+
+// ----------------- Command Buffer Functions ------------------------------------------------------
+
+/*! \brief Initializes command blocks for a mesh.
+  \param mesh Pointer to mesh the frames are built from.
+  \param frames Pointer to command frames to initialize.
+  \return Result code.
+  \see codes
+*/
+enum codes initCommandFrames(Mesh const * mesh, CommandFrames * frames);
+
+/*! \brief Frees command blocks.
+  \param frames Pointer to command frames initialized by 'initCommandFrames'.
+*/
+void freeCommandFrames(CommandFrames * frames);
+
+/*! \brief Builds the command block of a frame.
+  Transforms all vertices with 'transformVertexBuffer', snaps them to pixels like 'rasterizeMesh' does and writes a record per
+  line in mesh order, in a single pass over the index buffer. Every line takes the color of its first vertex, lines with an
+  end point outside 16 bits are dropped, the block holds no gaps.
+  'matrix' is a viewport * projection * view * model matrix; like 'transformVertexBuffer' it needs lines clipped to the near plane.
+  The block is busy until 'releaseCommandFrame', the other block is used for the next frame.
+  \param frames Pointer to command frames.
+  \param mesh Pointer to mesh, no larger than the one the frames were initialized for.
+  \param matrix Pointer to transformation to screen coordinates.
+  \param buffer Pointer to receive the block.
+  \param stats Pointer to receive the counts, may be NULL.
+  \return Result code, InvalidBuffer for a mesh that does not fit or has indices outside its vertices and Failed when the next
+  block is still busy.
+  \see codes
+*/
+enum codes buildCommandFrame(CommandFrames * frames, Mesh const * mesh, Matrix4 const * matrix, CommandBuffer ** buffer, FrameStats * stats);
+
+/*! \brief Releases the command block of a frame.
+  Call when the device is done reading the block, may be called from another thread than 'buildCommandFrame'.
+  \param buffer Pointer to block from 'buildCommandFrame'.
+*/
+void releaseCommandFrame(CommandBuffer * buffer);
+
+
+#endif // GCMD_H
@@ -0,0 +1,206 @@
+#include "gfixed.h"
+
+/*! \file gfixed.c
+  \brief Fixed point graphics datatypes and operators.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/26
+  \copyright GNU Public License.
+*/
+
+
+#include <stddef.h>
+#include <stdlib.h>
+
+
+// ----------------- Helpers -----------------------------------------------------------------------
+
+/*! \brief Saturates a 64 bit value to the fixed point range.
+  \param value Value to saturate.
+  \return Saturated value.
+*/
+static inline Fixed saturateFixed(int64_t value) {
+  return value > FIXED_MAX ? FIXED_MAX : value < FIXED_MIN ? FIXED_MIN : (Fixed)value;
+}
+
+/*! \brief Shifts right, rounding to nearest.
+  \param value Value to shift.
+  \param shift Amount of bits to drop, at least 1.
+  \return Rounded value.
+*/
+static inline int64_t roundShift(int64_t value, int shift) {
+  return (value + ((int64_t)1 << (shift - 1))) >> shift;
+}
+
+/*! \brief Sums four products and shifts the sum right by FIXED_SHIFT, rounding to nearest.
+  Every product of two fixed point values fits 64 bits, the sum of four may not. The bits above and below FIXED_SHIFT are
+  summed apart, neither sum can overflow, so the result is exact without a wider type than the core has.
+  \param a Product.
+  \param b Product.
+  \param c Product.
+  \param d Product.
+  \return Rounded sum shifted right by FIXED_SHIFT.
+*/
+static inline int64_t sumShift(int64_t a, int64_t b, int64_t c, int64_t d) {
+  int64_t mask = FIXED_ONE - 1;
+  int64_t high = (a >> FIXED_SHIFT) + (b >> FIXED_SHIFT) + (c >> FIXED_SHIFT) + (d >> FIXED_SHIFT);
+  int64_t low = (a & mask) + (b & mask) + (c & mask) + (d & mask);
+  return high + roundShift(low, FIXED_SHIFT);
+}
+
+/*! \brief Converts a float to fixed point.
+  \param value Value to convert.
+  \return Nearest fixed point value, saturated.
+*/
+static Fixed floatToFixed(float value) {
+  double scaled = (double)value * FIXED_ONE;
+  scaled += scaled < 0 ? -0.5 : 0.5;
+  return scaled >= (double)FIXED_MAX ? FIXED_MAX : scaled <= (double)FIXED_MIN ? FIXED_MIN : (Fixed)scaled;
+}
+
+
+// ----------------- Fixed Functions ---------------------------------------------------------------
+
+Fixed multiplyFixed(Fixed a, Fixed b) {
+  return saturateFixed(roundShift((int64_t)a * b, FIXED_SHIFT));
+}
+
+Fixed divideFixed(Fixed a, Fixed b) {
+  if (!b) {
+    return a < 0 ? FIXED_MIN : FIXED_MAX;
+  }
+  return saturateFixed((int64_t)a * FIXED_ONE / b);
+}
+
+
+// ----------------- Matrix Functions --------------------------------------------------------------
+
+void toFixedMatrix(Matrix4 const * in, Matrix4Fixed * out) {
+  int i;
+  for (i = 0; i < 16; ++i) {
+    out->m[i] = floatToFixed(in->m[i]);
+  }
+}
+
+void multiplyMatrixFixed(Matrix4Fixed const * a, Matrix4Fixed const * b, Matrix4Fixed * out) {
+  // computed in a temporary, 'out' may be one of the operands
+  Matrix4Fixed r;
+  int row, column;
+  for (row = 0; row < 4; ++row) {
+    for (column = 0; column < 4; ++column) {
+      int64_t sum = sumShift((int64_t)a->m[row * 4] * b->m[column], (int64_t)a->m[row * 4 + 1] * b->m[4 + column],
+                             (int64_t)a->m[row * 4 + 2] * b->m[8 + column], (int64_t)a->m[row * 4 + 3] * b->m[12 + column]);
+      r.m[row * 4 + column] = saturateFixed(sum);
+    }
+  }
+  *out = r;
+}
+
+
+// ----------------- Vector Functions --------------------------------------------------------------
+
+VectorFixed transformVectorFixed(Matrix4Fixed const * matrix, VectorFixed v) {
+  Fixed const * m = matrix->m;
+  // products in Q32.32, the translation is scaled up to match
+  int64_t x = sumShift((int64_t)m[0] * v.x, (int64_t)m[1] * v.y, (int64_t)m[2] * v.z, (int64_t)m[3] * FIXED_ONE);
+  int64_t y = sumShift((int64_t)m[4] * v.x, (int64_t)m[5] * v.y, (int64_t)m[6] * v.z, (int64_t)m[7] * FIXED_ONE);
+  int64_t z = sumShift((int64_t)m[8] * v.x, (int64_t)m[9] * v.y, (int64_t)m[10] * v.z, (int64_t)m[11] * FIXED_ONE);
+  int64_t w = sumShift((int64_t)m[12] * v.x, (int64_t)m[13] * v.y, (int64_t)m[14] * v.z, (int64_t)m[15] * FIXED_ONE);
+
+  // one division for the reciprocal (Q32) instead of three, divisions are the slowest operation on a soft core
+  if (!w) {
+    w = 1;
+  }
+  int64_t magnitude = w < 0 ? -w : w;
+  int64_t inverse = (((int64_t)1 << 48) + magnitude / 2) / magnitude;
+  if (w < 0) {
+    inverse = -inverse;
+  }
+  VectorFixed r;
+  int64_t product;
+  r.x = __builtin_mul_overflow(x, inverse, &product) ? ((x < 0) != (inverse < 0) ? FIXED_MIN : FIXED_MAX) : saturateFixed(roundShift(product, 32));
+  r.y = __builtin_mul_overflow(y, inverse, &product) ? ((y < 0) != (inverse < 0) ? FIXED_MIN : FIXED_MAX) : saturateFixed(roundShift(product, 32));
+  r.z = __builtin_mul_overflow(z, inverse, &product) ? ((z < 0) != (inverse < 0) ? FIXED_MIN : FIXED_MAX) : saturateFixed(roundShift(product, 32));
+  return r;
+}
+
+VectorFixed viewportFixed(VectorFixed v, uint16_t width, uint16_t height) {
+  // (ndc + 1) * size / 2, y is flipped, screen rows grow downwards
+  VectorFixed r;
+  r.x = saturateFixed(roundShift(((int64_t)v.x + FIXED_ONE) * width, 1));
+  r.y = saturateFixed(roundShift(((int64_t)FIXED_ONE - v.y) * height, 1));
+  r.z = saturateFixed(roundShift((int64_t)v.z + FIXED_ONE, 1));
+  return r;
+}
+
+
+// ----------------- VertexBuffer Functions --------------------------------------------------------
+
+enum codes initVertexBufferFixed(uint32_t size, VertexBufferFixed * vb) {
+  // fail on NULL pointers
+  if (!vb) {
+    return NullPointer;
+  }
+  vb->vertices = (VertexFixed *)malloc(sizeof(VertexFixed) * size);
+  // fail on malloc failure
+  if (!vb->vertices) {
+    return MemAlloc;
+  }
+  vb->size = size;
+  return Success;
+}
+
+enum codes toFixedVertexBuffer(VertexBuffer const * in, VertexBufferFixed * out) {
+  // fail on NULL pointers
+  if (!in || !out || (!in->vertices && in->size) || (!out->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->size < in->size) {
+    return InvalidBuffer;
+  }
+  uint32_t i;
+  for (i = 0; i < in->size; ++i) {
+    out->vertices[i].coord.x = floatToFixed(in->vertices[i].coord.x);
+    out->vertices[i].coord.y = floatToFixed(in->vertices[i].coord.y);
+    out->vertices[i].coord.z = floatToFixed(in->vertices[i].coord.z);
+    out->vertices[i].color = in->vertices[i].color;
+  }
+  return Success;
+}
+
+enum codes fromFixedVertexBuffer(VertexBufferFixed const * in, VertexBuffer * out) {
+  // fail on NULL pointers
+  if (!in || !out || (!in->vertices && in->size) || (!out->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->size < in->size) {
+    return InvalidBuffer;
+  }
+  uint32_t i;
+  for (i = 0; i < in->size; ++i) {
+    out->vertices[i].coord.x = FROM_FIXED(in->vertices[i].coord.x);
+    out->vertices[i].coord.y = FROM_FIXED(in->vertices[i].coord.y);
+    out->vertices[i].coord.z = FROM_FIXED(in->vertices[i].coord.z);
+    out->vertices[i].color = in->vertices[i].color;
+  }
+  return Success;
+}
+
+enum codes transformVertexBufferFixed(Matrix4Fixed const * matrix, uint16_t width, uint16_t height, VertexBufferFixed const * in, VertexBufferFixed * out) {
+  // fail on NULL pointers
+  if (!matrix || !in || !out || (!in->vertices && in->size) || (!out->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->size < in->size) {
+    return InvalidBuffer;
+  }
+  uint32_t i;
+  for (i = 0; i < in->size; ++i) {
+    out->vertices[i].coord = viewportFixed(transformVectorFixed(matrix, in->vertices[i].coord), width, height);
+    out->vertices[i].color = in->vertices[i].color;
+  }
+  return Success;
+}
@@ -0,0 +1,238 @@
+#include "gpack.h"
+
+/*! \file gpack.c
+  \brief Quantized vertex buffers.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/27
+  \copyright GNU Public License.
+*/
+
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNEL_X86 1                              //!< Vector implementations are available.
+#include <immintrin.h>
+#endif
+
+
+// ----------------- Local Function declarations ---------------------------------------------------
+
+/*! \brief Quantizes one coordinate.
+  \param value Coordinate.
+  \param offset Minimum of the bounding box on this axis.
+  \param inverse Steps per unit on this axis.
+  \return Nearest step.
+*/
+static uint16_t quantize(float value, float offset, double inverse);
+
+/*! \brief Transforms quantized vertices.
+  Kernels of 'transformVertexBufferPacked'.
+  \param matrix Pointer to transformation of quantized coordinates.
+  \param in First vertex to transform.
+  \param out First vertex to receive the result.
+  \param count Amount of vertices.
+*/
+static void transformPackedScalar(Matrix4 const * matrix, PackedVertex const * in, Vertex * out, uint32_t count);
+
+#ifdef KERNEL_X86
+static void transformPackedSSE(Matrix4 const * matrix, PackedVertex const * in, Vertex * out, uint32_t count);
+#endif
+
+
+// ----------------- VertexBufferPacked Functions --------------------------------------------------
+
+enum codes initVertexBufferPacked(uint32_t size, VertexBufferPacked * vb) {
+  // fail on NULL pointers
+  if (!vb) {
+    return NullPointer;
+  }
+  vb->vertices = (PackedVertex *)malloc(sizeof(PackedVertex) * size);
+  // fail on malloc failure
+  if (!vb->vertices) {
+    return MemAlloc;
+  }
+  vb->size = size;
+  vb->quantization.offset = (Vector){0.0f, 0.0f, 0.0f};
+  vb->quantization.scale = (Vector){0.0f, 0.0f, 0.0f};
+  return Success;
+}
+
+void freeVertexBufferPacked(VertexBufferPacked * vb) {
+  if (!vb) {
+    return;
+  }
+  free(vb->vertices);
+  vb->vertices = NULL;
+  vb->size = 0;
+}
+
+enum codes packVertexBuffer(VertexBuffer const * in, VertexBufferPacked * out) {
+  // fail on NULL pointers
+  if (!in || !out || (!in->vertices && in->size) || (!out->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->size < in->size) {
+    return InvalidBuffer;
+  }
+  Vector min = {0.0f, 0.0f, 0.0f};
+  Vector max = {0.0f, 0.0f, 0.0f};
+  uint32_t i;
+  if (in->size) {
+    min = max = in->vertices[0].coord;
+  }
+  for (i = 1; i < in->size; ++i) {
+    Vector v = in->vertices[i].coord;
+    min.x = v.x < min.x ? v.x : min.x;
+    min.y = v.y < min.y ? v.y : min.y;
+    min.z = v.z < min.z ? v.z : min.z;
+    max.x = v.x > max.x ? v.x : max.x;
+    max.y = v.y > max.y ? v.y : max.y;
+    max.z = v.z > max.z ? v.z : max.z;
+  }
+
+  // steps are computed in double, so the rounding to a step is the only error added while packing
+  double extentX = (double)max.x - min.x;
+  double extentY = (double)max.y - min.y;
+  double extentZ = (double)max.z - min.z;
+  double inverseX = extentX > 0.0 ? PACK_STEPS / extentX : 0.0;
+  double inverseY = extentY > 0.0 ? PACK_STEPS / extentY : 0.0;
+  double inverseZ = extentZ > 0.0 ? PACK_STEPS / extentZ : 0.0;
+  out->quantization.offset = min;
+  out->quantization.scale = (Vector){(float)(extentX / PACK_STEPS), (float)(extentY / PACK_STEPS), (float)(extentZ / PACK_STEPS)};
+  for (i = 0; i < in->size; ++i) {
+    Vertex const * v = &in->vertices[i];
+    out->vertices[i].x = quantize(v->coord.x, min.x, inverseX);
+    out->vertices[i].y = quantize(v->coord.y, min.y, inverseY);
+    out->vertices[i].z = quantize(v->coord.z, min.z, inverseZ);
+    out->vertices[i].color = v->color;
+  }
+  out->size = in->size;
+  return Success;
+}
+
+enum codes unpackVertexBuffer(VertexBufferPacked const * in, VertexBuffer * out) {
+  // fail on NULL pointers
+  if (!in || !out || (!in->vertices && in->size) || (!out->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->size < in->size) {
+    return InvalidBuffer;
+  }
+  uint32_t i;
+  for (i = 0; i < in->size; ++i) {
+    out->vertices[i].coord = unpackVector(&in->quantization, &in->vertices[i]);
+    out->vertices[i].color = in->vertices[i].color;
+  }
+  return Success;
+}
+
+Vector unpackVector(Quantization const * quantization, PackedVertex const * vertex) {
+  Vector r;
+  r.x = quantization->offset.x + vertex->x * quantization->scale.x;
+  r.y = quantization->offset.y + vertex->y * quantization->scale.y;
+  r.z = quantization->offset.z + vertex->z * quantization->scale.z;
+  return r;
+}
+
+void dequantizationMatrix(Quantization const * quantization, Matrix4 * out) {
+  Matrix4 translation;
+  translationMatrix(quantization->offset, &translation);
+  scaleMatrix(quantization->scale, out);
+  multiplyMatrix(&translation, out, out);
+}
+
+enum codes transformVertexBufferPacked(Matrix4 const * matrix, VertexBufferPacked const * in, VertexBuffer * out) {
+  // fail on NULL pointers
+  if (!matrix || !in || !out || (!in->vertices && in->size) || (!out->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->size < in->size) {
+    return InvalidBuffer;
+  }
+  Matrix4 m;
+  dequantizationMatrix(&in->quantization, &m);
+  multiplyMatrix(matrix, &m, &m);
+  switch (getKernel()) {
+#ifdef KERNEL_X86
+  case KAVX:
+  case KSSE:
+    transformPackedSSE(&m, in->vertices, out->vertices, in->size);
+    break;
+#endif
+
+  default:
+    transformPackedScalar(&m, in->vertices, out->vertices, in->size);
+    break;
+  }
+  return Success;
+}
+
+enum codes measurePackError(VertexBuffer const * original, VertexBufferPacked const * packed, Vector * error) {
+  // fail on NULL pointers
+  if (!original || !packed || !error || (!original->vertices && original->size) || (!packed->vertices && original->size)) {
+    return NullPointer;
+  }
+  // fail on buffers that do not match
+  if (packed->size != original->size) {
+    return InvalidBuffer;
+  }
+  Vector e = {0.0f, 0.0f, 0.0f};
+  uint32_t i;
+  for (i = 0; i < original->size; ++i) {
+    Vector a = original->vertices[i].coord;
+    Vector b = unpackVector(&packed->quantization, &packed->vertices[i]);
+    e.x = fmaxf(e.x, fabsf(a.x - b.x));
+    e.y = fmaxf(e.y, fabsf(a.y - b.y));
+    e.z = fmaxf(e.z, fabsf(a.z - b.z));
+  }
+  *error = e;
+  return Success;
+}
+
+
+// ----------------- Local Functions ---------------------------------------------------------------
+
+static uint16_t quantize(float value, float offset, double inverse) {
+  double step = ((double)value - offset) * inverse + 0.5;
+  return step <= 0.0 ? 0 : step >= PACK_STEPS ? PACK_STEPS : (uint16_t)step;
+}
+
+static void transformPackedScalar(Matrix4 const * matrix, PackedVertex const * in, Vertex * out, uint32_t count) {
+  uint32_t i;
+  for (i = 0; i < count; ++i) {
+    Vector v = {(float)in[i].x, (float)in[i].y, (float)in[i].z};
+    out[i].coord = transformVector(matrix, v);
+    out[i].color = in[i].color;
+  }
+}
+
+#ifdef KERNEL_X86
+// a vertex is widened from 4 16 bit lanes to 4 32 bit lanes: x, y and z are converted to float,
+// the color lane keeps its integer bits, which is exactly the color with zeroed padding of a Vertex
+__attribute__((target("sse2")))
+static void transformPackedSSE(Matrix4 const * matrix, PackedVertex const * in, Vertex * out, uint32_t count) {
+  float const * m = matrix->m;
+  __m128 c0 = _mm_setr_ps(m[0], m[4], m[8], m[12]);
+  __m128 c1 = _mm_setr_ps(m[1], m[5], m[9], m[13]);
+  __m128 c2 = _mm_setr_ps(m[2], m[6], m[10], m[14]);
+  __m128 c3 = _mm_setr_ps(m[3], m[7], m[11], m[15]);
+  __m128 keep = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+  __m128i zero = _mm_setzero_si128();
+  uint32_t i;
+  for (i = 0; i < count; ++i) {
+    __m128i q = _mm_unpacklo_epi16(_mm_loadl_epi64((__m128i const *)&in[i]), zero);
+    __m128 v = _mm_cvtepi32_ps(q);
+    __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(v, v, 0x00)), _mm_mul_ps(c1, _mm_shuffle_ps(v, v, 0x55)));
+    r = _mm_add_ps(_mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, 0xAA))), c3);
+    r = _mm_div_ps(r, _mm_shuffle_ps(r, r, 0xFF));
+    _mm_storeu_ps((float *)&out[i], _mm_or_ps(_mm_andnot_ps(keep, r), _mm_and_ps(keep, _mm_castsi128_ps(q))));
+  }
+}
+#endif
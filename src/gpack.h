@@ -0,0 +1,120 @@
+#ifndef GPACK_H
+#define GPACK_H
+
+/*! \file gpack.h
+  \brief Quantized vertex buffers.
+  Positions are stored as 16 bit integers relative to the bounding box of the buffer, 8 bytes per vertex instead of 16.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/27
+  \copyright GNU Public License.
+*/
+
+
+#include "codes.h"
+#include "gtypes.h"
+#include <stdint.h>
+
+
+#define PACK_STEPS 65535                          //!< Largest quantized coordinate, the bounding box is divided in this amount of steps.
+
+
+// ----------------- Structs -----------------------------------------------------------------------
+
+/*! \struct PackedVertex
+  \brief Quantized vertex, 8 bytes.
+*/
+typedef struct PackedVertex {
+  uint16_t x, y, z;                               //!< Quantized coordinate, 0 is the minimum of the bounding box, PACK_STEPS the maximum.
+  Color color;                                    //!< Color.
+} PackedVertex;
+
+/*! \struct Quantization
+  \brief Dequantization parameters.
+  A coordinate is 'offset' + quantized coordinate * 'scale', on every axis.
+*/
+typedef struct Quantization {
+  Vector offset;                                  //!< Minimum of the bounding box.
+  Vector scale;                                   //!< Size of one step, 0 on axes where the bounding box is flat.
+} Quantization;
+
+/*! \struct VertexBufferPacked
+  \brief Quantized vertex buffer datastruct.
+  Holds the vertices of a VertexBuffer together with the parameters to restore them.
+*/
+typedef struct VertexBufferPacked {
+  PackedVertex * vertices;                        //!< Vertices in buffer.
+  uint32_t size;                                  //!< Amount of vertices in buffer.
+  Quantization quantization;                      //!< Dequantization parameters of all vertices.
+} VertexBufferPacked;
+
+
+// ----------------- VertexBufferPacked Functions --------------------------------------------------
+
+/*! \brief Initializes a quantized vertex buffer.
+  \param size Amount of vertices that will fit in the buffer.
+  \param vb Pointer to vertex buffer to initialize.
+  \return Result code.
+  \see codes
+*/
+enum codes initVertexBufferPacked(uint32_t size, VertexBufferPacked * vb);
+
+/*! \brief Frees a quantized vertex buffer.
+  \param vb Pointer to vertex buffer initialized by 'initVertexBufferPacked'.
+*/
+void freeVertexBufferPacked(VertexBufferPacked * vb);
+
+/*! \brief Quantizes a vertex buffer.
+  Every coordinate is rounded to the nearest of PACK_STEPS + 1 steps over the bounding box of 'in',
+  so it moves at most half a step: (maximum - minimum) / (2 * PACK_STEPS) on every axis, plus the float rounding of the restored coordinate.
+  \param in Pointer to vertex buffer to quantize.
+  \param out Pointer to initialized vertex buffer, must hold at least 'in->size' vertices. Its size and quantization are set.
+  \return Result code.
+  \see codes
+*/
+enum codes packVertexBuffer(VertexBuffer const * in, VertexBufferPacked * out);
+
+/*! \brief Restores a quantized vertex buffer.
+  \param in Pointer to vertex buffer to restore.
+  \param out Pointer to initialized vertex buffer, must hold at least 'in->size' vertices.
+  \return Result code.
+  \see codes
+*/
+enum codes unpackVertexBuffer(VertexBufferPacked const * in, VertexBuffer * out);
+
+/*! \brief Restores a quantized coordinate.
+  \param quantization Pointer to dequantization parameters.
+  \param vertex Pointer to quantized vertex.
+  \return Coordinate.
+*/
+Vector unpackVector(Quantization const * quantization, PackedVertex const * vertex);
+
+/*! \brief Dequantization as a matrix.
+  Multiplying a transformation by this matrix lets it work on quantized coordinates directly.
+  \param quantization Pointer to dequantization parameters.
+  \param out Pointer to receive the matrix.
+*/
+void dequantizationMatrix(Quantization const * quantization, Matrix4 * out);
+
+/*! \brief Transforms a quantized vertex buffer.
+  Same as 'transformVertexBuffer' on the restored buffer, reading 8 instead of 16 bytes per vertex.
+  The dequantization is folded into the matrix, so results can differ from unpacking first by float rounding.
+  \param matrix Pointer to transformation.
+  \param in Pointer to vertex buffer to transform.
+  \param out Pointer to vertex buffer receiving the result, must hold at least 'in->size' vertices.
+  \return Result code.
+  \see codes
+*/
+enum codes transformVertexBufferPacked(Matrix4 const * matrix, VertexBufferPacked const * in, VertexBuffer * out);
+
+/*! \brief Measures the quantization error.
+  \param original Pointer to vertex buffer that was quantized.
+  \param packed Pointer to the quantized vertex buffer, must hold as many vertices as 'original'.
+  \param error Pointer to receive the largest absolute difference on every axis.
+  \return Result code.
+  \see codes
+*/
+enum codes measurePackError(VertexBuffer const * original, VertexBufferPacked const * packed, Vector * error);
+
+
+#endif // GPACK_H
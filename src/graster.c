@@ -0,0 +1,657 @@
+#include "graster.h"
+
+/*! \file graster.c
+  \brief Software line rasterizer.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define FRAMEBUFFER_ALIGN 64                      //!< Alignment of the pixels in bytes, one cache line.
+#define HASH_BASIS 0xCBF29CE484222325ull          //!< FNV-1a 64 bit offset basis.
+#define HASH_PRIME 0x100000001B3ull               //!< FNV-1a 64 bit prime.
+#define TILE_PREFETCH 8                           //!< Lines ahead in a bin whose first vertex is prefetched.
+
+
+// ----------------- Local Function declarations ---------------------------------------------------
+
+/*! \brief Divides, rounding towards minus infinity.
+  \param a Dividend.
+  \param b Divisor, greater than 0.
+  \return floor(a / b).
+*/
+static inline int64_t floorDiv(int64_t a, int64_t b);
+
+/*! \brief Steps of a line inside a rectangle.
+  Works on the major axis m (the one with the most steps) and the minor axis n of a line, see graster.h for the pixels of a line.
+  \param m0 Major coordinate of the first end point.
+  \param n0 Minor coordinate of the first end point.
+  \param am Steps along the major axis.
+  \param an Steps along the minor axis, at most 'am'.
+  \param sm Direction along the major axis, 1 or -1.
+  \param sn Direction along the minor axis, 1 or -1.
+  \param mmin Smallest major coordinate inside the rectangle.
+  \param mmax Largest major coordinate inside the rectangle.
+  \param nmin Smallest minor coordinate inside the rectangle.
+  \param nmax Largest minor coordinate inside the rectangle.
+  \param first Pointer to receive the first step inside.
+  \param last Pointer to receive the last step inside.
+  \return 1 if any step is inside, 0 otherwise.
+*/
+static int8_t clipSteps(int32_t m0, int32_t n0, int64_t am, int64_t an, int32_t sm, int32_t sn,
+                        int32_t mmin, int32_t mmax, int32_t nmin, int32_t nmax, int64_t * first, int64_t * last);
+
+/*! \brief Draws the part of a line inside a rectangle.
+  \param pixels Pixel at (0, 0).
+  \param stride Pixels per row.
+  \param xmin Left column of the rectangle.
+  \param ymin Top row of the rectangle.
+  \param xmax Right column of the rectangle, inclusive.
+  \param ymax Bottom row of the rectangle, inclusive.
+  \param x0 X of the first end point.
+  \param y0 Y of the first end point.
+  \param x1 X of the second end point.
+  \param y1 Y of the second end point.
+  \param color Color.
+  \return Amount of pixels written.
+*/
+static uint32_t drawLineRect(Color * pixels, int32_t stride, int32_t xmin, int32_t ymin, int32_t xmax, int32_t ymax,
+                             int32_t x0, int32_t y0, int32_t x1, int32_t y1, Color color);
+
+/*! \brief Snaps a screen coordinate to its pixel.
+  \param value Screen coordinate.
+  \param pixel Pointer to receive the pixel.
+  \return 1 on success, 0 for coordinates beyond RASTER_LIMIT (and NaN).
+*/
+static inline int8_t snapPixel(float value, int32_t * pixel);
+
+/*! \brief Walks the tiles a line has pixels in.
+  Without 'lines' the count of every tile in 'slots' is incremented, otherwise 'id' is stored at 'slots' of every tile, which advance.
+  \param bins Pointer to tile bins giving the screen.
+  \param x0 X of the first end point.
+  \param y0 Y of the first end point.
+  \param x1 X of the second end point.
+  \param y1 Y of the second end point.
+  \param slots Count or next entry per tile.
+  \param lines Line ids to fill, NULL to count.
+  \param id Line id.
+  \return Amount of tiles.
+*/
+static uint32_t binLine(TileBins const * bins, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t * slots, uint32_t * lines, uint32_t id);
+
+
+// ----------------- Framebuffer Functions ---------------------------------------------------------
+
+enum codes initFramebuffer(uint16_t width, uint16_t height, Framebuffer * fb) {
+  // fail on NULL pointers
+  if (!fb) {
+    return NullPointer;
+  }
+  size_t size = sizeof(Color) * (size_t)width * height;
+  size = (size + FRAMEBUFFER_ALIGN - 1) & ~(size_t)(FRAMEBUFFER_ALIGN - 1);
+  fb->pixels = (Color *)aligned_alloc(FRAMEBUFFER_ALIGN, size ? size : FRAMEBUFFER_ALIGN);
+  // fail on malloc failure
+  if (!fb->pixels) {
+    return MemAlloc;
+  }
+  fb->width = width;
+  fb->height = height;
+  return Success;
+}
+
+void freeFramebuffer(Framebuffer * fb) {
+  if (!fb) {
+    return;
+  }
+  free(fb->pixels);
+  fb->pixels = NULL;
+  fb->width = 0;
+  fb->height = 0;
+}
+
+void clearFramebuffer(Framebuffer * fb, Color color) {
+  if (!fb) {
+    return;
+  }
+  size_t count = (size_t)fb->width * fb->height;
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    fb->pixels[i] = color;
+  }
+}
+
+enum codes writePPM(char const * path, Framebuffer const * fb) {
+  // fail on NULL pointers
+  if (!path || !fb || !fb->pixels) {
+    return NullPointer;
+  }
+  FILE * file = fopen(path, "wb");
+  if (!file) {
+    return Failed;
+  }
+  uint8_t * row = (uint8_t *)malloc((size_t)fb->width * 3 + 1);
+  // fail on malloc failure
+  if (!row) {
+    fclose(file);
+    return MemAlloc;
+  }
+  int8_t ok = fprintf(file, "P6\n%u %u\n255\n", fb->width, fb->height) > 0;
+  uint32_t x, y;
+  for (y = 0; y < fb->height && ok; ++y) {
+    Color const * line = &fb->pixels[(size_t)y * fb->width];
+    for (x = 0; x < fb->width; ++x) {
+      uint8_t r = line[x] >> 11, g = (line[x] >> 5) & 0x3F, b = line[x] & 0x1F;
+      row[x * 3] = (uint8_t)(r << 3 | r >> 2);
+      row[x * 3 + 1] = (uint8_t)(g << 2 | g >> 4);
+      row[x * 3 + 2] = (uint8_t)(b << 3 | b >> 2);
+    }
+    ok = fwrite(row, 3, fb->width, file) == fb->width;
+  }
+  free(row);
+  ok &= fclose(file) == 0;
+  return ok ? Success : Failed;
+}
+
+uint64_t hashFramebuffer(Framebuffer const * fb) {
+  uint64_t hash = HASH_BASIS;
+  if (!fb || !fb->pixels) {
+    return hash;
+  }
+  size_t count = (size_t)fb->width * fb->height;
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    hash = (hash ^ fb->pixels[i]) * HASH_PRIME;
+  }
+  return hash;
+}
+
+
+// ----------------- Raster Functions --------------------------------------------------------------
+
+uint32_t drawLine(Framebuffer * fb, int32_t x0, int32_t y0, int32_t x1, int32_t y1, Color color) {
+  if (!fb || !fb->width || !fb->height) {
+    return 0;
+  }
+  // beyond the limit the step arithmetic could overflow
+  if (x0 < -RASTER_LIMIT || x0 > RASTER_LIMIT || y0 < -RASTER_LIMIT || y0 > RASTER_LIMIT
+      || x1 < -RASTER_LIMIT || x1 > RASTER_LIMIT || y1 < -RASTER_LIMIT || y1 > RASTER_LIMIT) {
+    return 0;
+  }
+  return drawLineRect(fb->pixels, fb->width, 0, 0, fb->width - 1, fb->height - 1, x0, y0, x1, y1, color);
+}
+
+/*! \struct RasterState
+  \brief State of 'rasterizeMesh' passed to its batch callback.
+*/
+typedef struct RasterState {
+  Framebuffer * fb;                               //!< Framebuffer to draw in.
+  RasterStats stats;                              //!< Counts so far.
+} RasterState;
+
+/*! \brief Draws a batch of lines.
+  \param batch Lines to draw.
+  \param user Pointer to RasterState.
+*/
+static void rasterizeBatch(LineBatch const * batch, void * user) {
+  RasterState * state = (RasterState *)user;
+  Framebuffer * fb = state->fb;
+  uint32_t j;
+  for (j = 0; j < batch->count; ++j) {
+    Vertex const * a = batch->first[j];
+    Vertex const * b = batch->second[j];
+    int32_t x0, y0, x1, y1;
+    if (!snapPixel(a->coord.x, &x0) || !snapPixel(a->coord.y, &y0) || !snapPixel(b->coord.x, &x1) || !snapPixel(b->coord.y, &y1)) {
+      continue;
+    }
+    uint32_t pixels = drawLineRect(fb->pixels, fb->width, 0, 0, fb->width - 1, fb->height - 1, x0, y0, x1, y1, a->color);
+    state->stats.drawn += pixels != 0;
+    state->stats.pixels += pixels;
+  }
+}
+
+enum codes rasterizeMesh(Framebuffer * fb, Mesh const * mesh, RasterStats * stats) {
+  // fail on NULL pointers
+  if (!fb || !mesh || !fb->pixels) {
+    return NullPointer;
+  }
+  RasterState state = { fb, { mesh->indices.size / 2, 0, 0 } };
+  enum codes result = Success;
+  if (fb->width && fb->height) {
+    result = iterateLineBatches(mesh, rasterizeBatch, &state);
+  }
+  if (stats) {
+    *stats = state.stats;
+  }
+  return result;
+}
+
+
+// ----------------- Tile Functions ----------------------------------------------------------------
+
+enum codes initTileBins(uint16_t width, uint16_t height, TileBins * bins) {
+  // fail on NULL pointers
+  if (!bins) {
+    return NullPointer;
+  }
+  uint32_t columns = ((uint32_t)width + TILE_WIDTH - 1) / TILE_WIDTH;
+  uint32_t tiles = columns * (((uint32_t)height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+  bins->start = (uint32_t *)calloc(tiles + 1, sizeof(uint32_t));
+  // fail on malloc failure
+  if (!bins->start) {
+    return MemAlloc;
+  }
+  bins->lines = NULL;
+  bins->size = 0;
+  bins->capacity = 0;
+  bins->tiles = tiles;
+  bins->columns = columns;
+  bins->drawn = 0;
+  bins->width = width;
+  bins->height = height;
+  return Success;
+}
+
+void freeTileBins(TileBins * bins) {
+  if (!bins) {
+    return;
+  }
+  free(bins->start);
+  free(bins->lines);
+  bins->start = NULL;
+  bins->lines = NULL;
+  bins->size = 0;
+  bins->capacity = 0;
+  bins->tiles = 0;
+  bins->drawn = 0;
+}
+
+/*! \struct BinState
+  \brief State of 'binLines' passed to its worker callback.
+*/
+typedef struct BinState {
+  TileBins * bins;                                //!< Tile bins to count or fill.
+  uint32_t * slots;                               //!< Counts, then next entries, 'tiles' per worker.
+  uint32_t * drawn;                               //!< Lines in at least one tile per worker.
+  int8_t fill;                                    //!< 0 while counting, 1 while filling.
+} BinState;
+
+/*! \brief Counts or bins a batch of lines.
+  \param worker Id of the worker.
+  \param batch Lines to bin.
+  \param user Pointer to BinState.
+*/
+static void binBatch(uint32_t worker, LineBatch const * batch, void * user) {
+  BinState * state = (BinState *)user;
+  TileBins const * bins = state->bins;
+  uint32_t * slots = &state->slots[(size_t)worker * bins->tiles];
+  uint32_t * lines = state->fill ? bins->lines : NULL;
+  uint32_t drawn = 0;
+  uint32_t j;
+  for (j = 0; j < batch->count; ++j) {
+    Vertex const * a = batch->first[j];
+    Vertex const * b = batch->second[j];
+    int32_t x0, y0, x1, y1;
+    if (!snapPixel(a->coord.x, &x0) || !snapPixel(a->coord.y, &y0) || !snapPixel(b->coord.x, &x1) || !snapPixel(b->coord.y, &y1)) {
+      continue;
+    }
+    drawn += binLine(bins, x0, y0, x1, y1, slots, lines, batch->offset + j) != 0;
+  }
+  state->drawn[worker] += drawn;
+}
+
+enum codes binLines(Mesh const * mesh, uint32_t workers, TileBins * bins) {
+  // fail on NULL pointers
+  if (!mesh || !bins || !bins->start) {
+    return NullPointer;
+  }
+  // fail on no workers
+  if (!workers) {
+    return InvalidParam;
+  }
+  BinState state = { bins, NULL, NULL, 0 };
+  state.slots = (uint32_t *)calloc((size_t)workers * bins->tiles + 1, sizeof(uint32_t));
+  state.drawn = (uint32_t *)calloc(workers, sizeof(uint32_t));
+  // fail on malloc failure
+  if (!state.slots || !state.drawn) {
+    free(state.slots);
+    free(state.drawn);
+    return MemAlloc;
+  }
+
+  enum codes result = iterateLinesParallel(mesh, workers, binBatch, &state);
+  if (result != Success) {
+    free(state.slots);
+    free(state.drawn);
+    return result;
+  }
+  // a tile takes the lines of worker 0 first, the ranges of the workers follow each other in the mesh
+  uint64_t total = 0;
+  uint32_t t, w;
+  for (t = 0; t < bins->tiles; ++t) {
+    bins->start[t] = (uint32_t)total;
+    for (w = 0; w < workers; ++w) {
+      uint32_t count = state.slots[(size_t)w * bins->tiles + t];
+      state.slots[(size_t)w * bins->tiles + t] = (uint32_t)total;
+      total += count;
+    }
+  }
+  // fail on more entries than a bin can index
+  if (total > UINT32_MAX) {
+    free(state.slots);
+    free(state.drawn);
+    return MemAlloc;
+  }
+  bins->start[bins->tiles] = (uint32_t)total;
+  if (total > bins->capacity) {
+    uint32_t * lines = (uint32_t *)realloc(bins->lines, sizeof(uint32_t) * total);
+    // fail on malloc failure
+    if (!lines) {
+      free(state.slots);
+      free(state.drawn);
+      return MemAlloc;
+    }
+    bins->lines = lines;
+    bins->capacity = (uint32_t)total;
+  }
+  bins->size = (uint32_t)total;
+
+  memset(state.drawn, 0, sizeof(uint32_t) * workers);
+  state.fill = 1;
+  result = iterateLinesParallel(mesh, workers, binBatch, &state);
+  bins->drawn = 0;
+  for (w = 0; w < workers; ++w) {
+    bins->drawn += state.drawn[w];
+  }
+  free(state.slots);
+  free(state.drawn);
+  return result;
+}
+
+/*! \struct TileRaster
+  \brief Shared state of 'rasterizeTiles'.
+*/
+typedef struct TileRaster {
+  Framebuffer * fb;                               //!< Framebuffer to draw in.
+  Mesh const * mesh;                              //!< Mesh the line ids refer to.
+  TileBins const * bins;                          //!< Lines per tile.
+  uint32_t next;                                  //!< Next tile to be taken by a worker.
+} TileRaster;
+
+/*! \struct TileWorker
+  \brief State of one worker of 'rasterizeTiles'.
+*/
+typedef struct TileWorker {
+  TileRaster * shared;                            //!< Shared state.
+  uint64_t pixels;                                //!< Pixels written by the worker.
+} TileWorker;
+
+/*! \brief Worker drawing tiles until none are left.
+  \param arg Pointer to TileWorker.
+  \return NULL.
+*/
+static void * rasterizeTileWorker(void * arg) {
+  TileWorker * worker = (TileWorker *)arg;
+  TileRaster * shared = worker->shared;
+  Framebuffer * fb = shared->fb;
+  TileBins const * bins = shared->bins;
+  Vertex const * vertices = shared->mesh->vertices.vertices;
+  IndexBuffer const * indices = &shared->mesh->indices;
+  uint64_t pixels = 0;
+  uint32_t t;
+  while ((t = __atomic_fetch_add(&shared->next, 1, __ATOMIC_RELAXED)) < bins->tiles) {
+    int32_t xmin = (int32_t)(t % bins->columns) * TILE_WIDTH;
+    int32_t ymin = (int32_t)(t / bins->columns) * TILE_HEIGHT;
+    int32_t xmax = xmin + TILE_WIDTH < fb->width ? xmin + TILE_WIDTH - 1 : fb->width - 1;
+    int32_t ymax = ymin + TILE_HEIGHT < fb->height ? ymin + TILE_HEIGHT - 1 : fb->height - 1;
+    uint32_t i, end = bins->start[t + 1];
+    for (i = bins->start[t]; i < end; ++i) {
+      // a bin picks lines from all over the mesh, fetch their vertices ahead
+      if (i + TILE_PREFETCH < end) {
+        __builtin_prefetch(&vertices[getIndex(bins->lines[i + TILE_PREFETCH] * 2, indices)]);
+      }
+      uint32_t id = bins->lines[i];
+      Vertex const * a = &vertices[getIndex(id * 2, indices)];
+      Vertex const * b = &vertices[getIndex(id * 2 + 1, indices)];
+      // binned lines always snap, unless the mesh changed since
+      int32_t x0, y0, x1, y1;
+      if (!snapPixel(a->coord.x, &x0) || !snapPixel(a->coord.y, &y0) || !snapPixel(b->coord.x, &x1) || !snapPixel(b->coord.y, &y1)) {
+        continue;
+      }
+      pixels += drawLineRect(fb->pixels, fb->width, xmin, ymin, xmax, ymax, x0, y0, x1, y1, a->color);
+    }
+  }
+  worker->pixels = pixels;
+  return NULL;
+}
+
+enum codes rasterizeTiles(Framebuffer * fb, Mesh const * mesh, TileBins const * bins, uint32_t workers, RasterStats * stats) {
+  // fail on NULL pointers
+  if (!fb || !mesh || !bins || !fb->pixels || !bins->start) {
+    return NullPointer;
+  }
+  // fail on no workers
+  if (!workers) {
+    return InvalidParam;
+  }
+  // fail on bins of another screen
+  if (bins->width != fb->width || bins->height != fb->height) {
+    return InvalidBuffer;
+  }
+  TileWorker * states = (TileWorker *)malloc(sizeof(TileWorker) * workers);
+  pthread_t * threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+  int8_t * started = (int8_t *)calloc(workers, sizeof(int8_t));
+  // fail on malloc failure
+  if (!states || !threads || !started) {
+    free(states);
+    free(threads);
+    free(started);
+    return MemAlloc;
+  }
+
+  TileRaster shared = { fb, mesh, bins, 0 };
+  uint32_t i;
+  for (i = 0; i < workers; ++i) {
+    states[i].shared = &shared;
+    states[i].pixels = 0;
+  }
+  // a worker that can not be started leaves its tiles to the others
+  for (i = 1; i < workers; ++i) {
+    started[i] = !pthread_create(&threads[i], NULL, rasterizeTileWorker, &states[i]);
+  }
+  rasterizeTileWorker(&states[0]);
+  uint64_t pixels = states[0].pixels;
+  for (i = 1; i < workers; ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+      pixels += states[i].pixels;
+    }
+  }
+  if (stats) {
+    stats->lines = mesh->indices.size / 2;
+    stats->drawn = bins->drawn;
+    stats->pixels = pixels;
+  }
+
+  free(states);
+  free(threads);
+  free(started);
+  return Success;
+}
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+static inline int64_t floorDiv(int64_t a, int64_t b) {
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int8_t clipSteps(int32_t m0, int32_t n0, int64_t am, int64_t an, int32_t sm, int32_t sn,
+                        int32_t mmin, int32_t mmax, int32_t nmin, int32_t nmax, int64_t * first, int64_t * last) {
+  // steps keeping the major coordinate inside
+  int64_t lo = sm > 0 ? (int64_t)mmin - m0 : (int64_t)m0 - mmax;
+  int64_t hi = sm > 0 ? (int64_t)mmax - m0 : (int64_t)m0 - mmin;
+  lo = lo > 0 ? lo : 0;
+  hi = hi < am ? hi : am;
+
+  // minor offsets q keeping the minor coordinate inside, step i has q = floor((2 * i * an + am) / (2 * am))
+  int64_t qlo = sn > 0 ? (int64_t)nmin - n0 : (int64_t)n0 - nmax;
+  int64_t qhi = sn > 0 ? (int64_t)nmax - n0 : (int64_t)n0 - nmin;
+  if (an == 0) {
+    // q is always 0
+    if (qlo > 0 || qhi < 0) {
+      return 0;
+    }
+  } else {
+    // q >= qlo from the first step with 2 * i * an + am >= 2 * am * qlo,
+    // q <= qhi up to the last step with 2 * i * an + am < 2 * am * (qhi + 1)
+    int64_t from = -floorDiv(am - 2 * am * qlo, 2 * an);
+    int64_t to = floorDiv(2 * am * (qhi + 1) - am - 1, 2 * an);
+    lo = from > lo ? from : lo;
+    hi = to < hi ? to : hi;
+  }
+  *first = lo;
+  *last = hi;
+  return lo <= hi;
+}
+
+static uint32_t drawLineRect(Color * pixels, int32_t stride, int32_t xmin, int32_t ymin, int32_t xmax, int32_t ymax,
+                             int32_t x0, int32_t y0, int32_t x1, int32_t y1, Color color) {
+  int64_t ax = x1 > x0 ? (int64_t)x1 - x0 : (int64_t)x0 - x1;
+  int64_t ay = y1 > y0 ? (int64_t)y1 - y0 : (int64_t)y0 - y1;
+  int32_t sx = x1 < x0 ? -1 : 1;
+  int32_t sy = y1 < y0 ? -1 : 1;
+
+  // work along the major axis, a diagonal is x major
+  int8_t xMajor = ax >= ay;
+  int64_t am = xMajor ? ax : ay;
+  int64_t an = xMajor ? ay : ax;
+  int64_t first = 0, last = am, q = 0, error = am;
+  if (x0 < xmin || x0 > xmax || y0 < ymin || y0 > ymax || x1 < xmin || x1 > xmax || y1 < ymin || y1 > ymax) {
+    int8_t inside = xMajor
+      ? clipSteps(x0, y0, am, an, sx, sy, xmin, xmax, ymin, ymax, &first, &last)
+      : clipSteps(y0, x0, am, an, sy, sx, ymin, ymax, xmin, xmax, &first, &last);
+    if (!inside) {
+      return 0;
+    }
+    // position of the first step inside, the error term continues from there
+    int64_t numerator = 2 * first * an + am;
+    q = am ? numerator / (2 * am) : 0;
+    error = am ? numerator % (2 * am) : 0;
+  }
+  int64_t x = xMajor ? x0 + sx * first : x0 + sx * q;
+  int64_t y = xMajor ? y0 + sy * q : y0 + sy * first;
+  ptrdiff_t stepMajor = xMajor ? sx : (ptrdiff_t)sy * stride;
+  ptrdiff_t stepMinor = xMajor ? (ptrdiff_t)sy * stride : sx;
+  Color * p = pixels + (ptrdiff_t)y * stride + x;
+  uint32_t count = (uint32_t)(last - first + 1);
+  uint32_t i;
+
+  if (an == 0 && xMajor) {
+    // horizontal, one contiguous run written from its left end
+    Color * run = sx > 0 ? p : p - (count - 1);
+    for (i = 0; i < count; ++i) {
+      run[i] = color;
+    }
+  } else if (an == 0) {
+    // vertical
+    for (i = 0; i < count; ++i, p += stepMajor) {
+      *p = color;
+    }
+  } else if (an == am) {
+    // diagonal, every step moves along both axes
+    ptrdiff_t step = stepMajor + stepMinor;
+    for (i = 0; i < count; ++i, p += step) {
+      *p = color;
+    }
+  } else {
+    int64_t twoAn = 2 * an, twoAm = 2 * am;
+    for (i = 0; i < count; ++i) {
+      *p = color;
+      p += stepMajor;
+      error += twoAn;
+      if (error >= twoAm) {
+        error -= twoAm;
+        p += stepMinor;
+      }
+    }
+  }
+  return count;
+}
+
+static inline int8_t snapPixel(float value, int32_t * pixel) {
+  if (!(value >= -(float)RASTER_LIMIT && value <= (float)RASTER_LIMIT)) {
+    return 0;
+  }
+  *pixel = (int32_t)floorf(value);
+  return 1;
+}
+
+static uint32_t binLine(TileBins const * bins, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t * slots, uint32_t * lines, uint32_t id) {
+  if (!bins->width || !bins->height) {
+    return 0;
+  }
+  int64_t ax = x1 > x0 ? (int64_t)x1 - x0 : (int64_t)x0 - x1;
+  int64_t ay = y1 > y0 ? (int64_t)y1 - y0 : (int64_t)y0 - y1;
+  int32_t sx = x1 < x0 ? -1 : 1;
+  int32_t sy = y1 < y0 ? -1 : 1;
+  int8_t xMajor = ax >= ay;
+  int64_t am = xMajor ? ax : ay;
+  int64_t an = xMajor ? ay : ax;
+  int32_t m0 = xMajor ? x0 : y0, n0 = xMajor ? y0 : x0;
+  int32_t sm = xMajor ? sx : sy, sn = xMajor ? sy : sx;
+  int32_t mTile = xMajor ? TILE_WIDTH : TILE_HEIGHT, nTile = xMajor ? TILE_HEIGHT : TILE_WIDTH;
+  int64_t first = 0, last = am;
+  if (x0 < 0 || x0 >= bins->width || y0 < 0 || y0 >= bins->height || x1 < 0 || x1 >= bins->width || y1 < 0 || y1 >= bins->height) {
+    int8_t inside = xMajor
+      ? clipSteps(x0, y0, am, an, sx, sy, 0, bins->width - 1, 0, bins->height - 1, &first, &last)
+      : clipSteps(y0, x0, am, an, sy, sx, 0, bins->height - 1, 0, bins->width - 1, &first, &last);
+    if (!inside) {
+      return 0;
+    }
+  } else if (x0 / TILE_WIDTH == x1 / TILE_WIDTH && y0 / TILE_HEIGHT == y1 / TILE_HEIGHT) {
+    // inside one tile, most lines of a dense mesh
+    uint32_t tile = (uint32_t)(y0 / TILE_HEIGHT) * bins->columns + (uint32_t)(x0 / TILE_WIDTH);
+    if (lines) {
+      lines[slots[tile]++] = id;
+    } else {
+      ++slots[tile];
+    }
+    return 1;
+  }
+
+  // one span of steps per tile along the major axis, the minor coordinate only grows (or shrinks) by 1 per step,
+  // so the span covers every tile between the ones of its end pixels
+  uint32_t tiles = 0;
+  int64_t i = first;
+  while (i <= last) {
+    int64_t tm = (m0 + sm * i) / mTile;
+    int64_t end = sm > 0 ? (tm + 1) * mTile - 1 - m0 : m0 - tm * mTile;
+    end = end < last ? end : last;
+    int64_t na = n0 + sn * (am ? (2 * i * an + am) / (2 * am) : 0);
+    int64_t nb = n0 + sn * (am ? (2 * end * an + am) / (2 * am) : 0);
+    int64_t from = (na < nb ? na : nb) / nTile;
+    int64_t to = (na < nb ? nb : na) / nTile;
+    int64_t tn;
+    for (tn = from; tn <= to; ++tn) {
+      uint32_t tile = (uint32_t)(xMajor ? tn * bins->columns + tm : tm * bins->columns + tn);
+      if (lines) {
+        lines[slots[tile]++] = id;
+      } else {
+        ++slots[tile];
+      }
+      ++tiles;
+    }
+    i = end + 1;
+  }
+  return tiles;
+}
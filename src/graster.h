@@ -0,0 +1,178 @@
+#ifndef GRASTER_H
+#define GRASTER_H
+
+/*! \file graster.h
+  \brief Software line rasterizer.
+  Integer Bresenham lines into an RGB565 framebuffer, the reference of the line unit of the FPGA.
+
+  Lines run between the pixels holding their end points, pixel (x, y) covers [x, x + 1) x [y, y + 1) on the screen.
+  With dx = x1 - x0, dy = y1 - y0 and |dx| >= |dy|, pixel i (0 <= i <= |dx|) of a line is
+  (x0 + i * sign(dx), y0 + sign(dy) * floor((2 * i * |dy| + |dx|) / (2 * |dx|))), the same with x and y swapped otherwise.
+  This is the Bresenham line from the first end point with halfway cases rounded away from it.
+  Clipping only removes pixels, a clipped line draws exactly the pixels of the full line inside the clip rectangle.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include "codes.h"
+#include "gtypes.h"
+#include <stdint.h>
+
+
+#define RASTER_LIMIT (1 << 24)                    //!< Lines with an end point further than this from the origin are not drawn.
+#define TILE_WIDTH 64                             //!< Width of a tile in pixels, a chosen default: 64 x 32 RGB565 pixels are 4 KB, a size an on-chip tile buffer could hold.
+#define TILE_HEIGHT 32                            //!< Height of a tile in pixels, see TILE_WIDTH.
+
+
+// ----------------- Structs -----------------------------------------------------------------------
+
+/*! \struct Framebuffer
+  \brief RGB565 framebuffer.
+  Pixels are stored row by row, top row first.
+*/
+typedef struct Framebuffer {
+  Color * pixels;                                 //!< Pixels, 'width' * 'height' of them.
+  uint16_t width;                                 //!< Width in pixels.
+  uint16_t height;                                //!< Height in pixels.
+} Framebuffer;
+
+/*! \struct RasterStats
+  \brief Counts of 'rasterizeMesh'.
+*/
+typedef struct RasterStats {
+  uint32_t lines;                                 //!< Lines of the mesh.
+  uint32_t drawn;                                 //!< Lines with at least one pixel in the framebuffer.
+  uint64_t pixels;                                //!< Pixels written.
+} RasterStats;
+
+/*! \struct TileBins
+  \brief Lines of a mesh sorted into screen tiles.
+  Tiles are TILE_WIDTH x TILE_HEIGHT pixels, numbered row by row, the last column and row may be cut off by the screen.
+  Bins are stored compressed: tile t holds the line ids 'lines[start[t]]' up to 'lines[start[t + 1]]', ascending.
+  A line is in exactly the tiles it has pixels in, so every bin can be drawn on its own, by a thread or by the FPGA.
+  Sized for one screen by 'initTileBins' and reused every frame.
+*/
+typedef struct TileBins {
+  uint32_t * start;                               //!< First entry of every tile in 'lines', 'tiles' + 1 entries.
+  uint32_t * lines;                               //!< Line ids of all bins, a line id is its position in the mesh.
+  uint32_t size;                                  //!< Amount of entries in 'lines'.
+  uint32_t capacity;                              //!< Amount of entries that fit in 'lines', grows when needed.
+  uint32_t tiles;                                 //!< Amount of tiles.
+  uint32_t columns;                               //!< Tiles per row.
+  uint32_t drawn;                                 //!< Lines in at least one tile.
+  uint16_t width;                                 //!< Width of the screen in pixels.
+  uint16_t height;                                //!< Height of the screen in pixels.
+} TileBins;
+
+
+// ----------------- Framebuffer Functions ---------------------------------------------------------
+
+/*! \brief Initializes a framebuffer.
+  \param width Width in pixels.
+  \param height Height in pixels.
+  \param fb Pointer to framebuffer to initialize.
+  \return Result code.
+  \see codes
+*/
+enum codes initFramebuffer(uint16_t width, uint16_t height, Framebuffer * fb);
+
+/*! \brief Frees a framebuffer.
+  \param fb Pointer to framebuffer initialized by 'initFramebuffer'.
+*/
+void freeFramebuffer(Framebuffer * fb);
+
+/*! \brief Fills a framebuffer with one color.
+  \param fb Pointer to framebuffer.
+  \param color Color.
+*/
+void clearFramebuffer(Framebuffer * fb, Color color);
+
+/*! \brief Writes a framebuffer as binary PPM (P6).
+  Channels are widened to 8 bits by repeating their high bits, so white stays 255.
+  \param path Path of the image.
+  \param fb Pointer to framebuffer.
+  \return Result code.
+  \see codes
+*/
+enum codes writePPM(char const * path, Framebuffer const * fb);
+
+/*! \brief Hashes the pixels of a framebuffer.
+  FNV-1a over the pixels, for comparing frames of different renderers.
+  \param fb Pointer to framebuffer.
+  \return Hash.
+*/
+uint64_t hashFramebuffer(Framebuffer const * fb);
+
+
+// ----------------- Raster Functions --------------------------------------------------------------
+
+/*! \brief Draws a line.
+  Clipped to the framebuffer. Horizontal, vertical and diagonal lines have their own loops.
+  \param fb Pointer to framebuffer.
+  \param x0 X of the first end point.
+  \param y0 Y of the first end point.
+  \param x1 X of the second end point.
+  \param y1 Y of the second end point.
+  \param color Color.
+  \return Amount of pixels written.
+*/
+uint32_t drawLine(Framebuffer * fb, int32_t x0, int32_t y0, int32_t x1, int32_t y1, Color color);
+
+/*! \brief Draws all lines of a mesh.
+  Vertices must be in screen coordinates (see 'viewportMatrix'), every line is drawn in the color of its first vertex.
+  Lines are fetched through 'iterateLineBatches'.
+  \param fb Pointer to framebuffer.
+  \param mesh Pointer to mesh.
+  \param stats Pointer to receive the counts, may be NULL.
+  \return Result code.
+  \see codes
+*/
+enum codes rasterizeMesh(Framebuffer * fb, Mesh const * mesh, RasterStats * stats);
+
+
+// ----------------- Tile Functions ----------------------------------------------------------------
+
+/*! \brief Initializes tile bins for a screen.
+  \param width Width of the screen in pixels.
+  \param height Height of the screen in pixels.
+  \param bins Pointer to tile bins to initialize.
+  \return Result code.
+  \see codes
+*/
+enum codes initTileBins(uint16_t width, uint16_t height, TileBins * bins);
+
+/*! \brief Frees tile bins.
+  \param bins Pointer to tile bins initialized by 'initTileBins'.
+*/
+void freeTileBins(TileBins * bins);
+
+/*! \brief Sorts the lines of a mesh into tiles.
+  Vertices must be in screen coordinates, lines are snapped to pixels like 'rasterizeMesh' does.
+  Lines are walked tile by tile along the line, so a long diagonal line is only binned to the tiles it crosses.
+  Runs in 2 passes over 'iterateLinesParallel', counting and then filling, with per worker counts so bins stay in mesh order.
+  \param mesh Pointer to mesh.
+  \param workers Amount of threads, at least 1.
+  \param bins Pointer to tile bins initialized for the screen.
+  \return Result code.
+  \see codes
+*/
+enum codes binLines(Mesh const * mesh, uint32_t workers, TileBins * bins);
+
+/*! \brief Draws binned lines tile by tile.
+  Threads take whole tiles and draw their bins clipped to the tile, so no pixel is written by 2 threads.
+  Lines of a bin are drawn in mesh order, the result is identical to 'rasterizeMesh', including the counts.
+  \param fb Pointer to framebuffer, same size as the screen of 'bins'.
+  \param mesh Pointer to mesh binned by 'binLines'.
+  \param bins Pointer to tile bins.
+  \param workers Amount of threads, at least 1.
+  \param stats Pointer to receive the counts, may be NULL.
+  \return Result code, InvalidBuffer when 'bins' is for another screen.
+  \see codes
+*/
+enum codes rasterizeTiles(Framebuffer * fb, Mesh const * mesh, TileBins const * bins, uint32_t workers, RasterStats * stats);
+
+
+#endif // GRASTER_H
@@ -0,0 +1,405 @@
+#include "gring.h"
+
+/*! \file gring.c
+  \brief Line command ring.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <fcntl.h>
+#include <math.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+
+// ----------------- Local Function declarations ---------------------------------------------------
+
+/*! \brief Maps a command ring.
+  \param fd Descriptor of the shared memory object.
+  \param size Size of the object in bytes.
+  \param ring Pointer to ring to set.
+  \return Result code.
+*/
+static enum codes mapCommandRing(int fd, size_t size, CommandRing * ring);
+
+/*! \brief Waits a little for the other side.
+  Polls RING_SPINS times, then gives the processor away, so a ring on a single core still moves.
+  \param spins Pointer to the amount of polls so far.
+*/
+static inline void waitTurn(uint32_t * spins);
+
+/*! \brief Reads the monotonic clock, the same in every process.
+  \return Time in nanoseconds.
+*/
+static inline uint64_t nowNanoseconds(void);
+
+/*! \brief Snaps a screen coordinate to the pixel coordinates of a command.
+  \param value Screen coordinate.
+  \param pixel Pointer to receive the pixel.
+  \return 1 on success, 0 for coordinates outside 16 bits (and NaN).
+*/
+static inline int8_t snapCommand(float value, int16_t * pixel);
+
+
+// ----------------- Ring Functions ----------------------------------------------------------------
+
+enum codes createCommandRing(char const * name, uint32_t capacity, uint16_t width, uint16_t height, CommandRing * ring) {
+  // fail on NULL pointers
+  if (!name || !ring) {
+    return NullPointer;
+  }
+  // fail on a capacity that is not a power of 2
+  if (!capacity || (capacity & (capacity - 1))) {
+    return InvalidParam;
+  }
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return Failed;
+  }
+  size_t size = sizeof(RingShared) + sizeof(LineCommand) * (size_t)capacity;
+  if (ftruncate(fd, (off_t)size)) {
+    close(fd);
+    shm_unlink(name);
+    return Failed;
+  }
+  enum codes result = mapCommandRing(fd, size, ring);
+  close(fd);
+  if (result != Success) {
+    shm_unlink(name);
+    return result;
+  }
+  // the object starts zeroed, only the constants are set
+  ring->shared->capacity = capacity;
+  ring->shared->width = width;
+  ring->shared->height = height;
+  __atomic_store_n(&ring->shared->magic, RING_MAGIC, __ATOMIC_RELEASE);
+  ring->mask = capacity - 1;
+  return Success;
+}
+
+enum codes openCommandRing(char const * name, CommandRing * ring) {
+  // fail on NULL pointers
+  if (!name || !ring) {
+    return NullPointer;
+  }
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) {
+    return Failed;
+  }
+  struct stat st;
+  if (fstat(fd, &st)) {
+    close(fd);
+    return Failed;
+  }
+  // fail on anything too small to hold the shared fields
+  if ((size_t)st.st_size < sizeof(RingShared)) {
+    close(fd);
+    return InvalidBuffer;
+  }
+  enum codes result = mapCommandRing(fd, (size_t)st.st_size, ring);
+  close(fd);
+  if (result != Success) {
+    return result;
+  }
+  RingShared const * shared = ring->shared;
+  uint32_t capacity = shared->capacity;
+  // fail on memory that is no command ring
+  if (__atomic_load_n(&shared->magic, __ATOMIC_ACQUIRE) != RING_MAGIC || !capacity || (capacity & (capacity - 1))
+      || ring->size != sizeof(RingShared) + sizeof(LineCommand) * (size_t)capacity) {
+    closeCommandRing(ring);
+    return InvalidBuffer;
+  }
+  ring->mask = capacity - 1;
+  ring->seen = __atomic_load_n(&shared->tail, __ATOMIC_ACQUIRE);
+  ring->doorbell = 0;
+  return Success;
+}
+
+void closeCommandRing(CommandRing * ring) {
+  if (!ring || !ring->shared) {
+    return;
+  }
+  munmap(ring->shared, ring->size);
+  ring->shared = NULL;
+  ring->commands = NULL;
+  ring->size = 0;
+}
+
+enum codes removeCommandRing(char const * name) {
+  // fail on NULL pointers
+  if (!name) {
+    return NullPointer;
+  }
+  return shm_unlink(name) ? Failed : Success;
+}
+
+
+// ----------------- Producer Functions ------------------------------------------------------------
+
+uint32_t pushCommands(CommandRing * ring, LineCommand const * commands, uint32_t count) {
+  RingShared * shared = ring->shared;
+  uint64_t capacity = (uint64_t)ring->mask + 1;
+  // only the producer writes 'head'
+  uint64_t head = shared->head;
+  if (head + count - ring->seen > capacity) {
+    ring->seen = __atomic_load_n(&shared->tail, __ATOMIC_ACQUIRE);
+  }
+  uint64_t space = capacity - (head - ring->seen);
+  uint32_t n = count < space ? count : (uint32_t)space;
+  if (!n) {
+    return 0;
+  }
+  uint32_t slot = (uint32_t)(head & ring->mask);
+  uint32_t first = n < capacity - slot ? n : (uint32_t)(capacity - slot);
+  memcpy(&ring->commands[slot], commands, sizeof(LineCommand) * first);
+  memcpy(ring->commands, commands + first, sizeof(LineCommand) * (n - first));
+  // the commands are visible to whoever sees the new head, the doorbell follows the head
+  __atomic_store_n(&shared->stamp, nowNanoseconds(), __ATOMIC_RELAXED);
+  __atomic_store_n(&shared->head, head + n, __ATOMIC_RELEASE);
+  __atomic_store_n(&shared->doorbell, shared->doorbell + 1, __ATOMIC_RELEASE);
+  return n;
+}
+
+uint32_t submitCommands(CommandRing * ring, LineCommand const * commands, uint32_t count) {
+  uint32_t stalls = 0;
+  uint32_t spins = 0;
+  while (count) {
+    uint32_t n = pushCommands(ring, commands, count);
+    if (!n) {
+      stalls += !spins;
+      waitTurn(&spins);
+      continue;
+    }
+    spins = 0;
+    commands += n;
+    count -= n;
+  }
+  return stalls;
+}
+
+void closeCommands(CommandRing * ring) {
+  __atomic_store_n(&ring->shared->closed, 1, __ATOMIC_RELEASE);
+}
+
+/*! \struct SubmitState
+  \brief State of 'submitMesh' passed to its batch callback.
+*/
+typedef struct SubmitState {
+  CommandRing * ring;                             //!< Producer side.
+  SubmitStats stats;                              //!< Counts so far.
+} SubmitState;
+
+/*! \brief Submits a batch of lines.
+  \param batch Lines to submit.
+  \param user Pointer to SubmitState.
+*/
+static void submitBatch(LineBatch const * batch, void * user) {
+  SubmitState * state = (SubmitState *)user;
+  LineCommand commands[LINE_BATCH];
+  uint32_t count = 0;
+  uint32_t j;
+  for (j = 0; j < batch->count; ++j) {
+    Vertex const * a = batch->first[j];
+    Vertex const * b = batch->second[j];
+    LineCommand * command = &commands[count];
+    if (!snapCommand(a->coord.x, &command->x0) || !snapCommand(a->coord.y, &command->y0)
+        || !snapCommand(b->coord.x, &command->x1) || !snapCommand(b->coord.y, &command->y1)) {
+      ++state->stats.dropped;
+      continue;
+    }
+    command->color = a->color;
+    command->flags = 0;
+    ++count;
+  }
+  state->stats.stalls += submitCommands(state->ring, commands, count);
+  state->stats.submitted += count;
+}
+
+enum codes submitMesh(CommandRing * ring, Mesh const * mesh, SubmitStats * stats) {
+  // fail on NULL pointers
+  if (!ring || !mesh || !ring->shared) {
+    return NullPointer;
+  }
+  SubmitState state = { ring, { mesh->indices.size / 2, 0, 0, 0, 0 } };
+  uint64_t doorbell = ring->shared->doorbell;
+  enum codes result = iterateLineBatches(mesh, submitBatch, &state);
+  state.stats.doorbells = (uint32_t)(ring->shared->doorbell - doorbell);
+  if (stats) {
+    *stats = state.stats;
+  }
+  return result;
+}
+
+
+// ----------------- Consumer Functions ------------------------------------------------------------
+
+uint32_t popCommands(CommandRing * ring, LineCommand * commands, uint32_t count) {
+  RingShared * shared = ring->shared;
+  // only the consumer writes 'tail'
+  uint64_t tail = shared->tail;
+  if (ring->seen == tail) {
+    ring->seen = __atomic_load_n(&shared->head, __ATOMIC_ACQUIRE);
+  }
+  uint64_t available = ring->seen - tail;
+  uint32_t n = count < available ? count : (uint32_t)available;
+  if (!n) {
+    return 0;
+  }
+  uint32_t slot = (uint32_t)(tail & ring->mask);
+  uint32_t first = n < ring->mask + 1 - slot ? n : ring->mask + 1 - slot;
+  memcpy(commands, &ring->commands[slot], sizeof(LineCommand) * first);
+  memcpy(commands + first, ring->commands, sizeof(LineCommand) * (n - first));
+  // the slots are free once the copies are done
+  __atomic_store_n(&shared->tail, tail + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+enum codes runLineUnit(CommandRing * ring, Framebuffer * fb, LineUnitStats * stats) {
+  // fail on NULL pointers
+  if (!ring || !ring->shared) {
+    return NullPointer;
+  }
+  RingShared * shared = ring->shared;
+  Framebuffer own = { NULL, 0, 0 };
+  if (!fb) {
+    enum codes result = initFramebuffer(shared->width, shared->height, &own);
+    if (result != Success) {
+      return result;
+    }
+    clearFramebuffer(&own, 0);
+    fb = &own;
+  }
+
+  LineUnitStats counts;
+  memset(&counts, 0, sizeof(counts));
+  LineCommand batch[RING_BATCH];
+  uint64_t start = 0;
+  uint32_t spins = 0;
+  for (;;) {
+    uint64_t doorbell = __atomic_load_n(&shared->doorbell, __ATOMIC_ACQUIRE);
+    if (doorbell == ring->doorbell) {
+      // closed is set after the last doorbell, check the doorbell once more before leaving
+      if (__atomic_load_n(&shared->closed, __ATOMIC_ACQUIRE)) {
+        if (__atomic_load_n(&shared->doorbell, __ATOMIC_ACQUIRE) == ring->doorbell) {
+          break;
+        }
+        continue;
+      }
+      waitTurn(&spins);
+      continue;
+    }
+    spins = 0;
+    ring->doorbell = doorbell;
+    uint64_t now = nowNanoseconds();
+    uint64_t stamp = __atomic_load_n(&shared->stamp, __ATOMIC_RELAXED);
+    uint64_t latency = now > stamp ? now - stamp : 0;
+    start = counts.pickups ? start : now;
+    counts.latency += latency;
+    counts.latencyMax = latency > counts.latencyMax ? latency : counts.latencyMax;
+    ++counts.pickups;
+
+    // take everything published, also what arrives while drawing
+    uint32_t n, j;
+    while ((n = popCommands(ring, batch, RING_BATCH))) {
+      for (j = 0; j < n; ++j) {
+        counts.pixels += drawLine(fb, batch[j].x0, batch[j].y0, batch[j].x1, batch[j].y1, batch[j].color);
+      }
+      counts.commands += n;
+    }
+  }
+  counts.elapsed = counts.pickups ? nowNanoseconds() - start : 0;
+  counts.hash = hashFramebuffer(fb);
+  shared->stats = counts;
+  if (stats) {
+    *stats = counts;
+  }
+  freeFramebuffer(&own);
+  return Success;
+}
+
+enum codes startLineUnit(char const * name, pid_t * pid) {
+  // fail on NULL pointers
+  if (!name || !pid) {
+    return NullPointer;
+  }
+  pid_t child = fork();
+  if (child < 0) {
+    return Failed;
+  }
+  if (!child) {
+    CommandRing ring;
+    enum codes result = openCommandRing(name, &ring);
+    if (result == Success) {
+      result = runLineUnit(&ring, NULL, NULL);
+      closeCommandRing(&ring);
+    }
+    _exit(result == Success ? 0 : 1);
+  }
+  *pid = child;
+  return Success;
+}
+
+enum codes waitLineUnit(CommandRing const * ring, pid_t pid, LineUnitStats * stats) {
+  // fail on NULL pointers
+  if (!ring || !ring->shared) {
+    return NullPointer;
+  }
+  int status;
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status)) {
+    return Failed;
+  }
+  if (stats) {
+    *stats = ring->shared->stats;
+  }
+  return Success;
+}
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+static enum codes mapCommandRing(int fd, size_t size, CommandRing * ring) {
+  void * base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    return Failed;
+  }
+  ring->shared = (RingShared *)base;
+  ring->commands = (LineCommand *)((char *)base + sizeof(RingShared));
+  ring->size = size;
+  ring->mask = 0;
+  ring->seen = 0;
+  ring->doorbell = 0;
+  return Success;
+}
+
+static inline void waitTurn(uint32_t * spins) {
+  if (++*spins % RING_SPINS) {
+#if defined(__x86_64__)||defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  } else {
+    sched_yield();
+  }
+}
+
+static inline uint64_t nowNanoseconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline int8_t snapCommand(float value, int16_t * pixel) {
+  if (!(value >= (float)INT16_MIN && value < (float)INT16_MAX + 1.0f)) {
+    return 0;
+  }
+  *pixel = (int16_t)floorf(value);
+  return 1;
+}
@@ -0,0 +1,216 @@
+#ifndef GRING_H
+#define GRING_H
+
+/*! \file gring.h
+  \brief Line command ring.
+  Single producer, single consumer ring of line commands in shared memory, the submission queue of the FPGA line unit.
+  The producer copies commands into the ring and publishes a batch at once by moving 'head' and ringing the doorbell.
+  The consumer takes everything published at once and frees it by moving 'tail'. Both positions only grow, a slot is
+  position & (capacity - 1). Producer, consumer and the constants each have their own cache line, so the sides never
+  write a line the other writes.
+  A forked process running 'runLineUnit' emulates the line unit, so the queue can be measured without the device.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include "codes.h"
+#include "graster.h"
+#include "gtypes.h"
+#include <stdint.h>
+#include <sys/types.h>
+
+
+#define RING_CACHE_LINE 64                        //!< Size of a cache line in bytes, shared fields of each side are kept on their own line.
+#define RING_BATCH 256                            //!< Maximum amount of commands taken by the line unit at once.
+#define RING_SPINS 64                             //!< Polls of a waiting side before it yields the processor.
+#define RING_MAGIC 0x474E5252u                    //!< Marks shared memory holding a command ring.
+
+
+// ----------------- Structs -----------------------------------------------------------------------
+
+/*! \struct LineCommand
+  \brief Line as the line unit draws it.
+  End points are pixels (see graster.h), the line unit draws the same pixels as 'drawLine'.
+*/
+typedef struct LineCommand {
+  int16_t x0;                                     //!< X of the first end point.
+  int16_t y0;                                     //!< Y of the first end point.
+  int16_t x1;                                     //!< X of the second end point.
+  int16_t y1;                                     //!< Y of the second end point.
+  Color color;                                    //!< Color.
+  uint16_t flags;                                 //!< Reserved, 0.
+} LineCommand;
+
+/*! \struct LineUnitStats
+  \brief Counts of the emulated line unit.
+*/
+typedef struct LineUnitStats {
+  uint64_t commands;                              //!< Commands drawn.
+  uint64_t pickups;                               //!< Times published commands were taken.
+  uint64_t pixels;                                //!< Pixels written.
+  uint64_t elapsed;                               //!< Nanoseconds from the first pickup to the close of the ring.
+  uint64_t latency;                               //!< Sum over all pickups of the nanoseconds since the newest publish.
+  uint64_t latencyMax;                            //!< Largest latency of a pickup in nanoseconds.
+  uint64_t hash;                                  //!< 'hashFramebuffer' of the framebuffer after the last command.
+} LineUnitStats;
+
+/*! \struct RingShared
+  \brief Shared memory of a command ring, followed by the command slots.
+*/
+typedef struct RingShared {
+  uint32_t magic;                                 //!< RING_MAGIC.
+  uint32_t capacity;                              //!< Amount of command slots, a power of 2.
+  uint16_t width;                                 //!< Width of the framebuffer of the line unit.
+  uint16_t height;                                //!< Height of the framebuffer of the line unit.
+  uint64_t head __attribute__((aligned(RING_CACHE_LINE))); //!< Commands published, written by the producer.
+  uint64_t doorbell;                              //!< Batches published, written by the producer.
+  uint64_t stamp;                                 //!< Time of the newest publish in nanoseconds, written by the producer.
+  uint32_t closed;                                //!< 1 when the producer publishes no more commands.
+  uint64_t tail __attribute__((aligned(RING_CACHE_LINE))); //!< Commands consumed, written by the consumer.
+  LineUnitStats stats __attribute__((aligned(RING_CACHE_LINE))); //!< Counts left by 'runLineUnit' when the ring closes.
+} __attribute__((aligned(RING_CACHE_LINE))) RingShared;
+
+/*! \struct CommandRing
+  \brief One side of a command ring.
+  Each side keeps its own position and the last seen position of the other side, so the other line is only read when needed.
+*/
+typedef struct CommandRing {
+  RingShared * shared;                            //!< Shared memory.
+  LineCommand * commands;                         //!< Command slots, after the shared fields.
+  size_t size;                                    //!< Size of the mapping in bytes.
+  uint32_t mask;                                  //!< Capacity - 1.
+  uint64_t seen;                                  //!< Last seen head (consumer) or tail (producer).
+  uint64_t doorbell;                              //!< Last seen doorbell (consumer).
+} CommandRing;
+
+/*! \struct SubmitStats
+  \brief Counts of 'submitMesh'.
+*/
+typedef struct SubmitStats {
+  uint32_t lines;                                 //!< Lines of the mesh.
+  uint32_t submitted;                             //!< Commands published.
+  uint32_t dropped;                               //!< Lines with an end point outside the coordinates of a command.
+  uint32_t doorbells;                             //!< Batches published.
+  uint32_t stalls;                                //!< Times the producer waited for free slots.
+} SubmitStats;
+
+
+// ----------------- Ring Functions ----------------------------------------------------------------
+
+/*! \brief Creates a command ring.
+  Creates the shared memory object 'name', failing when it already exists.
+  \param name Name of the shared memory object, starting with '/'.
+  \param capacity Amount of command slots, a power of 2.
+  \param width Width of the framebuffer of the line unit.
+  \param height Height of the framebuffer of the line unit.
+  \param ring Pointer to ring to initialize as producer.
+  \return Result code, InvalidParam for a capacity that is not a power of 2.
+  \see codes
+*/
+enum codes createCommandRing(char const * name, uint32_t capacity, uint16_t width, uint16_t height, CommandRing * ring);
+
+/*! \brief Opens an existing command ring.
+  \param name Name of the shared memory object.
+  \param ring Pointer to ring to initialize as consumer.
+  \return Result code, InvalidBuffer when the object is no command ring.
+  \see codes
+*/
+enum codes openCommandRing(char const * name, CommandRing * ring);
+
+/*! \brief Closes a side of a command ring.
+  Unmaps the shared memory, the object stays until 'removeCommandRing'.
+  \param ring Pointer to ring.
+*/
+void closeCommandRing(CommandRing * ring);
+
+/*! \brief Removes a command ring.
+  Mappings stay valid until closed.
+  \param name Name of the shared memory object.
+  \return Result code.
+  \see codes
+*/
+enum codes removeCommandRing(char const * name);
+
+
+// ----------------- Producer Functions ------------------------------------------------------------
+
+/*! \brief Publishes commands.
+  Copies as many commands as there are free slots and publishes them as one batch, ringing the doorbell once.
+  \param ring Pointer to producer side.
+  \param commands Commands to publish.
+  \param count Amount of commands.
+  \return Amount of commands published.
+*/
+uint32_t pushCommands(CommandRing * ring, LineCommand const * commands, uint32_t count);
+
+/*! \brief Publishes all commands, waiting for free slots.
+  \param ring Pointer to producer side.
+  \param commands Commands to publish.
+  \param count Amount of commands.
+  \return Amount of times the producer had to wait.
+*/
+uint32_t submitCommands(CommandRing * ring, LineCommand const * commands, uint32_t count);
+
+/*! \brief Tells the consumer no more commands follow.
+  \param ring Pointer to producer side.
+*/
+void closeCommands(CommandRing * ring);
+
+/*! \brief Submits all lines of a mesh.
+  Lines are fetched through 'iterateLineBatches', snapped to pixels like 'rasterizeMesh' does and published a batch at a time.
+  Every line takes the color of its first vertex. Lines with an end point outside 16 bits are dropped, clip them first.
+  Does not close the ring, so several meshes can make up a frame.
+  \param ring Pointer to producer side.
+  \param mesh Pointer to mesh in screen coordinates.
+  \param stats Pointer to receive the counts, may be NULL.
+  \return Result code.
+  \see codes
+*/
+enum codes submitMesh(CommandRing * ring, Mesh const * mesh, SubmitStats * stats);
+
+
+// ----------------- Consumer Functions ------------------------------------------------------------
+
+/*! \brief Takes published commands.
+  Copies up to 'count' published commands and frees their slots.
+  \param ring Pointer to consumer side.
+  \param commands Pointer to receive the commands.
+  \param count Maximum amount of commands.
+  \return Amount of commands taken, 0 when none are published.
+*/
+uint32_t popCommands(CommandRing * ring, LineCommand * commands, uint32_t count);
+
+/*! \brief Emulates the line unit.
+  Draws commands with 'drawLine' into a framebuffer until the ring is closed and empty, then stores the counts in the ring.
+  \param ring Pointer to consumer side.
+  \param fb Pointer to framebuffer to draw in, NULL to allocate one of the size of the ring.
+  \param stats Pointer to receive the counts, may be NULL.
+  \return Result code.
+  \see codes
+*/
+enum codes runLineUnit(CommandRing * ring, Framebuffer * fb, LineUnitStats * stats);
+
+/*! \brief Starts an emulated line unit in a child process.
+  The child opens the ring 'name', runs 'runLineUnit' on a cleared framebuffer and exits.
+  \param name Name of an existing command ring.
+  \param pid Pointer to receive the id of the child.
+  \return Result code.
+  \see codes
+*/
+enum codes startLineUnit(char const * name, pid_t * pid);
+
+/*! \brief Waits for an emulated line unit to finish.
+  Call after 'closeCommands', the counts are read from the ring.
+  \param ring Pointer to producer side.
+  \param pid Id of the child from 'startLineUnit'.
+  \param stats Pointer to receive the counts, may be NULL.
+  \return Result code, Failed when the child did not finish successfully.
+  \see codes
+*/
+enum codes waitLineUnit(CommandRing const * ring, pid_t pid, LineUnitStats * stats);
+
+
+#endif // GRING_H
@@ -0,0 +1,367 @@
+#include "gsoa.h"
+
+/*! \file gsoa.c
+  \brief Structure of arrays vertex buffers.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/26
+  \copyright GNU Public License.
+*/
+
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNEL_X86 1                              //!< Vector implementations are available.
+#include <immintrin.h>
+#endif
+
+
+// ----------------- Local Function declarations ---------------------------------------------------
+
+/*! \brief Converts vertices to structure of arrays.
+  \param in Pointer to vertex buffer to convert.
+  \param out Pointer to vertex buffer receiving the result.
+  \param first First vertex to convert.
+*/
+static void toSoAScalar(VertexBuffer const * in, VertexBufferSoA * out, uint32_t first);
+
+/*! \brief Converts vertices to array of structures.
+  \param in Pointer to vertex buffer to convert.
+  \param out Pointer to vertex buffer receiving the result.
+  \param first First vertex to convert.
+*/
+static void toAoSScalar(VertexBufferSoA const * in, VertexBuffer * out, uint32_t first);
+
+/*! \brief Transforms vertices.
+  Kernels of 'transformVertexBufferSoA', each vector kernel leaves the vertices after the last whole vector to the scalar kernel.
+  \param m Elements of the transformation.
+  \param in Pointer to vertex buffer to transform.
+  \param out Pointer to vertex buffer receiving the result.
+  \param first First vertex to transform.
+  \return First vertex that was not transformed.
+*/
+static uint32_t transformSoAScalar(float const * m, VertexBufferSoA const * in, VertexBufferSoA * out, uint32_t first);
+
+/*! \brief Bounding box of vertices.
+  \param vb Pointer to vertex buffer.
+  \param first First vertex to include.
+  \param min Pointer to the smallest coordinates so far, updated.
+  \param max Pointer to the largest coordinates so far, updated.
+*/
+static void boundsSoAScalar(VertexBufferSoA const * vb, uint32_t first, Vector * min, Vector * max);
+
+#ifdef KERNEL_X86
+static uint32_t toSoASSE(VertexBuffer const * in, VertexBufferSoA * out);
+static uint32_t toAoSSSE(VertexBufferSoA const * in, VertexBuffer * out);
+static uint32_t transformSoASSE(float const * m, VertexBufferSoA const * in, VertexBufferSoA * out, uint32_t first);
+static uint32_t transformSoAAVX(float const * m, VertexBufferSoA const * in, VertexBufferSoA * out, uint32_t first);
+static uint32_t boundsSoAAVX(VertexBufferSoA const * vb, Vector * min, Vector * max);
+#endif
+
+
+// ----------------- VertexBufferSoA Functions -----------------------------------------------------
+
+enum codes initVertexBufferSoA(uint32_t size, VertexBufferSoA * vb) {
+  // fail on NULL pointers
+  if (!vb) {
+    return NullPointer;
+  }
+  // at least one vector, so an empty buffer still has valid arrays
+  uint64_t capacity = size ? ((uint64_t)size + SOA_PAD - 1) & ~(uint64_t)(SOA_PAD - 1) : SOA_PAD;
+  // fail on sizes that do not fit
+  if (capacity > UINT32_MAX) {
+    return InvalidParam;
+  }
+  size_t floats = sizeof(float) * (size_t)capacity;
+  size_t colors = sizeof(Color) * (size_t)capacity;
+  char * block = (char *)aligned_alloc(SOA_ALIGN, floats * 3 + colors);
+  // fail on malloc failure
+  if (!block) {
+    return MemAlloc;
+  }
+  vb->x = (float *)block;
+  vb->y = (float *)(block + floats);
+  vb->z = (float *)(block + floats * 2);
+  vb->color = (Color *)(block + floats * 3);
+  vb->size = size;
+  vb->capacity = (uint32_t)capacity;
+  return Success;
+}
+
+void freeVertexBufferSoA(VertexBufferSoA * vb) {
+  if (!vb) {
+    return;
+  }
+  // all arrays share the block starting at 'x'
+  free(vb->x);
+  vb->x = vb->y = vb->z = NULL;
+  vb->color = NULL;
+  vb->size = 0;
+  vb->capacity = 0;
+}
+
+enum codes convertToSoA(VertexBuffer const * in, VertexBufferSoA * out) {
+  // fail on NULL pointers
+  if (!in || !out || (!in->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->capacity < in->size) {
+    return InvalidBuffer;
+  }
+  uint32_t first = 0;
+#ifdef KERNEL_X86
+  if (getKernel() != KScalar) {
+    first = toSoASSE(in, out);
+  }
+#endif
+  toSoAScalar(in, out, first);
+  out->size = in->size;
+  return Success;
+}
+
+enum codes convertToAoS(VertexBufferSoA const * in, VertexBuffer * out) {
+  // fail on NULL pointers
+  if (!in || !out || (!out->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->size < in->size) {
+    return InvalidBuffer;
+  }
+  uint32_t first = 0;
+#ifdef KERNEL_X86
+  if (getKernel() != KScalar) {
+    first = toAoSSSE(in, out);
+  }
+#endif
+  toAoSScalar(in, out, first);
+  return Success;
+}
+
+enum codes transformVertexBufferSoA(Matrix4 const * matrix, VertexBufferSoA const * in, VertexBufferSoA * out) {
+  // fail on NULL pointers
+  if (!matrix || !in || !out) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->capacity < in->size) {
+    return InvalidBuffer;
+  }
+  uint32_t first = 0;
+  switch (getKernel()) {
+#ifdef KERNEL_X86
+  case KAVX:
+    first = transformSoAAVX(matrix->m, in, out, first);
+    // the SSE kernel takes a remaining half vector
+    /* fall through */
+  case KSSE:
+    first = transformSoASSE(matrix->m, in, out, first);
+    break;
+#endif
+
+  default: break;
+  }
+  transformSoAScalar(matrix->m, in, out, first);
+  if (out != in && in->size) {
+    memcpy(out->color, in->color, sizeof(Color) * in->size);
+  }
+  out->size = in->size;
+  return Success;
+}
+
+enum codes boundsVertexBufferSoA(VertexBufferSoA const * vb, Vector * min, Vector * max) {
+  // fail on NULL pointers
+  if (!vb || !min || !max) {
+    return NullPointer;
+  }
+  // fail on no vertices
+  if (!vb->size) {
+    return InvalidParam;
+  }
+  min->x = max->x = vb->x[0];
+  min->y = max->y = vb->y[0];
+  min->z = max->z = vb->z[0];
+  uint32_t first = 1;
+#ifdef KERNEL_X86
+  if (getKernel() == KAVX) {
+    first = boundsSoAAVX(vb, min, max);
+  }
+#endif
+  boundsSoAScalar(vb, first, min, max);
+  return Success;
+}
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+static void toSoAScalar(VertexBuffer const * in, VertexBufferSoA * out, uint32_t first) {
+  uint32_t i;
+  for (i = first; i < in->size; ++i) {
+    out->x[i] = in->vertices[i].coord.x;
+    out->y[i] = in->vertices[i].coord.y;
+    out->z[i] = in->vertices[i].coord.z;
+    out->color[i] = in->vertices[i].color;
+  }
+}
+
+static void toAoSScalar(VertexBufferSoA const * in, VertexBuffer * out, uint32_t first) {
+  uint32_t i;
+  for (i = first; i < in->size; ++i) {
+    out->vertices[i].coord.x = in->x[i];
+    out->vertices[i].coord.y = in->y[i];
+    out->vertices[i].coord.z = in->z[i];
+    out->vertices[i].color = in->color[i];
+  }
+}
+
+static uint32_t transformSoAScalar(float const * m, VertexBufferSoA const * in, VertexBufferSoA * out, uint32_t first) {
+  // same evaluation order as 'transformVector'
+  uint32_t i;
+  for (i = first; i < in->size; ++i) {
+    float x = in->x[i], y = in->y[i], z = in->z[i];
+    float tx = ((m[0] * x + m[1] * y) + m[2] * z) + m[3];
+    float ty = ((m[4] * x + m[5] * y) + m[6] * z) + m[7];
+    float tz = ((m[8] * x + m[9] * y) + m[10] * z) + m[11];
+    float tw = ((m[12] * x + m[13] * y) + m[14] * z) + m[15];
+    out->x[i] = tx / tw;
+    out->y[i] = ty / tw;
+    out->z[i] = tz / tw;
+  }
+  return i;
+}
+
+static void boundsSoAScalar(VertexBufferSoA const * vb, uint32_t first, Vector * min, Vector * max) {
+  uint32_t i;
+  for (i = first; i < vb->size; ++i) {
+    min->x = vb->x[i] < min->x ? vb->x[i] : min->x;
+    min->y = vb->y[i] < min->y ? vb->y[i] : min->y;
+    min->z = vb->z[i] < min->z ? vb->z[i] : min->z;
+    max->x = vb->x[i] > max->x ? vb->x[i] : max->x;
+    max->y = vb->y[i] > max->y ? vb->y[i] : max->y;
+    max->z = vb->z[i] > max->z ? vb->z[i] : max->z;
+  }
+}
+
+#ifdef KERNEL_X86
+// conversions transpose 4 vertices at a time: x, y, z and the color with its padding form a 4x4 matrix of 32 bit lanes
+
+__attribute__((target("sse2")))
+static uint32_t toSoASSE(VertexBuffer const * in, VertexBufferSoA * out) {
+  uint32_t i;
+  for (i = 0; i + 4 <= in->size; i += 4) {
+    __m128 x = _mm_loadu_ps((float const *)&in->vertices[i]);
+    __m128 y = _mm_loadu_ps((float const *)&in->vertices[i + 1]);
+    __m128 z = _mm_loadu_ps((float const *)&in->vertices[i + 2]);
+    __m128 c = _mm_loadu_ps((float const *)&in->vertices[i + 3]);
+    _MM_TRANSPOSE4_PS(x, y, z, c);
+    _mm_store_ps(&out->x[i], x);
+    _mm_store_ps(&out->y[i], y);
+    _mm_store_ps(&out->z[i], z);
+    // colors are the low halves of the 32 bit lanes, gather them in the low 64 bits
+    __m128i colors = _mm_castps_si128(c);
+    colors = _mm_shufflehi_epi16(_mm_shufflelo_epi16(colors, _MM_SHUFFLE(3, 3, 2, 0)), _MM_SHUFFLE(3, 3, 2, 0));
+    _mm_storel_epi64((__m128i *)&out->color[i], _mm_shuffle_epi32(colors, _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  return i;
+}
+
+__attribute__((target("sse2")))
+static uint32_t toAoSSSE(VertexBufferSoA const * in, VertexBuffer * out) {
+  uint32_t i;
+  for (i = 0; i + 4 <= in->size; i += 4) {
+    __m128 x = _mm_load_ps(&in->x[i]);
+    __m128 y = _mm_load_ps(&in->y[i]);
+    __m128 z = _mm_load_ps(&in->z[i]);
+    // colors are widened to 32 bit lanes, the padding of the vertices becomes zero
+    __m128 c = _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((__m128i const *)&in->color[i]), _mm_setzero_si128()));
+    _MM_TRANSPOSE4_PS(x, y, z, c);
+    _mm_storeu_ps((float *)&out->vertices[i], x);
+    _mm_storeu_ps((float *)&out->vertices[i + 1], y);
+    _mm_storeu_ps((float *)&out->vertices[i + 2], z);
+    _mm_storeu_ps((float *)&out->vertices[i + 3], c);
+  }
+  return i;
+}
+
+// transform kernels mirror 'transformSoAScalar' lane by lane, every lane is a vertex
+
+__attribute__((target("sse2")))
+static uint32_t transformSoASSE(float const * m, VertexBufferSoA const * in, VertexBufferSoA * out, uint32_t first) {
+  uint32_t i;
+  for (i = first; i + 4 <= in->size; i += 4) {
+    __m128 x = _mm_load_ps(&in->x[i]);
+    __m128 y = _mm_load_ps(&in->y[i]);
+    __m128 z = _mm_load_ps(&in->z[i]);
+#define ROW(r) _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[r * 4]), x), _mm_mul_ps(_mm_set1_ps(m[r * 4 + 1]), y)), \
+                                     _mm_mul_ps(_mm_set1_ps(m[r * 4 + 2]), z)), _mm_set1_ps(m[r * 4 + 3]))
+    __m128 w = ROW(3);
+    _mm_store_ps(&out->x[i], _mm_div_ps(ROW(0), w));
+    _mm_store_ps(&out->y[i], _mm_div_ps(ROW(1), w));
+    _mm_store_ps(&out->z[i], _mm_div_ps(ROW(2), w));
+#undef ROW
+  }
+  return i;
+}
+
+__attribute__((target("avx")))
+static uint32_t transformSoAAVX(float const * m, VertexBufferSoA const * in, VertexBufferSoA * out, uint32_t first) {
+  uint32_t i;
+  for (i = first; i + 8 <= in->size; i += 8) {
+    __m256 x = _mm256_load_ps(&in->x[i]);
+    __m256 y = _mm256_load_ps(&in->y[i]);
+    __m256 z = _mm256_load_ps(&in->z[i]);
+#define ROW(r) _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[r * 4]), x), _mm256_mul_ps(_mm256_set1_ps(m[r * 4 + 1]), y)), \
+                                           _mm256_mul_ps(_mm256_set1_ps(m[r * 4 + 2]), z)), _mm256_set1_ps(m[r * 4 + 3]))
+    __m256 w = ROW(3);
+    _mm256_store_ps(&out->x[i], _mm256_div_ps(ROW(0), w));
+    _mm256_store_ps(&out->y[i], _mm256_div_ps(ROW(1), w));
+    _mm256_store_ps(&out->z[i], _mm256_div_ps(ROW(2), w));
+#undef ROW
+  }
+  return i;
+}
+
+__attribute__((target("avx")))
+static uint32_t boundsSoAAVX(VertexBufferSoA const * vb, Vector * min, Vector * max) {
+  if (vb->size < 8) {
+    return 1;
+  }
+  __m256 minX = _mm256_load_ps(vb->x), maxX = minX;
+  __m256 minY = _mm256_load_ps(vb->y), maxY = minY;
+  __m256 minZ = _mm256_load_ps(vb->z), maxZ = minZ;
+  uint32_t i;
+  for (i = 8; i + 8 <= vb->size; i += 8) {
+    __m256 x = _mm256_load_ps(&vb->x[i]);
+    __m256 y = _mm256_load_ps(&vb->y[i]);
+    __m256 z = _mm256_load_ps(&vb->z[i]);
+    minX = _mm256_min_ps(minX, x);
+    maxX = _mm256_max_ps(maxX, x);
+    minY = _mm256_min_ps(minY, y);
+    maxY = _mm256_max_ps(maxY, y);
+    minZ = _mm256_min_ps(minZ, z);
+    maxZ = _mm256_max_ps(maxZ, z);
+  }
+  // reduce the lanes, the scalar kernel then continues with the remaining vertices
+  float lanes[6][8];
+  _mm256_storeu_ps(lanes[0], minX);
+  _mm256_storeu_ps(lanes[1], minY);
+  _mm256_storeu_ps(lanes[2], minZ);
+  _mm256_storeu_ps(lanes[3], maxX);
+  _mm256_storeu_ps(lanes[4], maxY);
+  _mm256_storeu_ps(lanes[5], maxZ);
+  int lane;
+  for (lane = 0; lane < 8; ++lane) {
+    min->x = lanes[0][lane] < min->x ? lanes[0][lane] : min->x;
+    min->y = lanes[1][lane] < min->y ? lanes[1][lane] : min->y;
+    min->z = lanes[2][lane] < min->z ? lanes[2][lane] : min->z;
+    max->x = lanes[3][lane] > max->x ? lanes[3][lane] : max->x;
+    max->y = lanes[4][lane] > max->y ? lanes[4][lane] : max->y;
+    max->z = lanes[5][lane] > max->z ? lanes[5][lane] : max->z;
+  }
+  return i;
+}
+#endif
@@ -0,0 +1,100 @@
+#ifndef GSOA_H
+#define GSOA_H
+
+/*! \file gsoa.h
+  \brief Structure of arrays vertex buffers.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/25
+  \copyright GNU Public License.
+*/
+
+
+#include "codes.h"
+#include "gtypes.h"
+#include <stdint.h>
+
+
+#define SOA_ALIGN 32                              //!< Alignment of every array in bytes, one AVX register.
+#define SOA_PAD 16                                //!< Arrays are padded to a multiple of this amount of elements, so every array starts aligned.
+
+
+// ----------------- Structs -----------------------------------------------------------------------
+
+/*! \struct VertexBufferSoA
+  \brief Vertex buffer datastruct, structure of arrays.
+  Holds the same data as a VertexBuffer, every component in its own array.
+  All arrays are SOA_ALIGN aligned and hold 'capacity' elements, so aligned vector loads never cross the end of an array.
+  Elements between 'size' and 'capacity' are not used.
+*/
+typedef struct VertexBufferSoA {
+  float * x;                                      //!< X coordinates.
+  float * y;                                      //!< Y coordinates.
+  float * z;                                      //!< Z coordinates.
+  Color * color;                                  //!< Colors.
+  uint32_t size;                                  //!< Amount of vertices in buffer.
+  uint32_t capacity;                              //!< Amount of elements in every array, a multiple of SOA_PAD.
+} VertexBufferSoA;
+
+/*! \struct MeshSoA
+  \brief Mesh datatype with structure of arrays vertices.
+*/
+typedef struct MeshSoA {
+  VertexBufferSoA vertices;
+  IndexBuffer indices;
+} MeshSoA;
+
+
+// ----------------- VertexBufferSoA Functions -----------------------------------------------------
+
+/*! \brief Initializes a vertex buffer.
+  Initializes a vertex buffer for specified amount of vertices, all arrays are allocated as one block.
+  \param size Amount of vertices that will fit in the buffer.
+  \param vb Pointer to vertex buffer to initialize.
+  \return Result code.
+  \see codes
+*/
+enum codes initVertexBufferSoA(uint32_t size, VertexBufferSoA * vb);
+
+/*! \brief Frees a vertex buffer.
+  \param vb Pointer to vertex buffer initialized by 'initVertexBufferSoA'.
+*/
+void freeVertexBufferSoA(VertexBufferSoA * vb);
+
+/*! \brief Converts a vertex buffer to structure of arrays.
+  \param in Pointer to vertex buffer to convert.
+  \param out Pointer to initialized vertex buffer, must hold at least 'in->size' vertices. Its size is set to 'in->size'.
+  \return Result code.
+  \see codes
+*/
+enum codes convertToSoA(VertexBuffer const * in, VertexBufferSoA * out);
+
+/*! \brief Converts a vertex buffer to array of structures.
+  \param in Pointer to vertex buffer to convert.
+  \param out Pointer to initialized vertex buffer, must hold at least 'in->size' vertices.
+  \return Result code.
+  \see codes
+*/
+enum codes convertToAoS(VertexBufferSoA const * in, VertexBuffer * out);
+
+/*! \brief Transforms a vertex buffer.
+  Same as 'transformVertexBuffer' and with identical results, 8 (AVX) or 4 (SSE) vertices per step.
+  \param matrix Pointer to transformation.
+  \param in Pointer to vertex buffer to transform.
+  \param out Pointer to vertex buffer receiving the result, must hold at least 'in->size' vertices, may be 'in'. Its size is set to 'in->size'.
+  \return Result code.
+  \see codes
+*/
+enum codes transformVertexBufferSoA(Matrix4 const * matrix, VertexBufferSoA const * in, VertexBufferSoA * out);
+
+/*! \brief Bounding box of a vertex buffer.
+  \param vb Pointer to vertex buffer.
+  \param min Pointer to receive the smallest coordinate on every axis.
+  \param max Pointer to receive the largest coordinate on every axis.
+  \return Result code, InvalidParam for an empty buffer.
+  \see codes
+*/
+enum codes boundsVertexBufferSoA(VertexBufferSoA const * vb, Vector * min, Vector * max);
+
+
+#endif // GSOA_H
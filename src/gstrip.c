@@ -0,0 +1,309 @@
+#include "gstrip.h"
+
+/*! \file gstrip.c
+  \brief Line strips.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define STRIP_NONE UINT32_MAX                     //!< No vertex or entry.
+
+
+// ----------------- Local Function declarations ---------------------------------------------------
+
+/*! \brief Gets an end point of a line or a virtual line.
+  \param line Line id, virtual lines follow the lines of 'lines'.
+  \param second 1 for the second end point.
+  \param lines Pointer to index buffer with the lines.
+  \param virtual End points of the virtual lines, 2 per line.
+  \return Vertex index.
+*/
+static inline uint32_t lineEnd(uint32_t line, uint32_t second, IndexBuffer const * lines, uint32_t const * virtual);
+
+/*! \brief Appends an index.
+  \param out Indices.
+  \param size Pointer to the amount of indices in 'out', is incremented.
+  \param width Width of 'out'.
+  \param index Index to append.
+*/
+static inline void appendIndex(void * out, uint32_t * size, enum IndexWidth width, uint32_t index);
+
+
+// ----------------- Strip Functions ---------------------------------------------------------------
+
+enum codes buildStrips(IndexBuffer const * lines, uint32_t vertices, enum StripMode mode, StripBuffer * strips, StripStats * stats) {
+  // fail on NULL pointers
+  if (!lines || !strips || (!lines->indices && lines->size)) {
+    return NullPointer;
+  }
+  uint32_t count = lines->size / 2;
+  uint32_t i, v;
+  // fail on indices outside the vertices
+  for (i = 0; i < count * 2; ++i) {
+    if (getIndex(i, lines) >= vertices) {
+      return InvalidBuffer;
+    }
+  }
+
+  // lines leaving minus lines arriving per vertex, without directions only the parity of the degree counts
+  int32_t * surplus = (int32_t *)calloc(vertices ? vertices : 1, sizeof(int32_t));
+  // fail on malloc failure
+  if (!surplus) {
+    return MemAlloc;
+  }
+  for (i = 0; i < count; ++i) {
+    uint32_t a = getIndex(i * 2, lines), b = getIndex(i * 2 + 1, lines);
+    if (mode == StripAnyDirection) {
+      surplus[a] ^= 1;
+      surplus[b] ^= 1;
+    } else {
+      ++surplus[a];
+      --surplus[b];
+    }
+  }
+  uint64_t unbalanced = 0;
+  for (v = 0; v < vertices; ++v) {
+    unbalanced += surplus[v] > 0 ? (uint32_t)surplus[v] : 0;
+  }
+  uint32_t extra = (uint32_t)(mode == StripAnyDirection ? unbalanced / 2 : unbalanced);
+  uint32_t total = count + extra;
+  uint32_t sides = mode == StripAnyDirection ? 2 : 1;
+
+  uint32_t * virtual = (uint32_t *)malloc(sizeof(uint32_t) * 2 * (size_t)(extra ? extra : 1));
+  uint32_t * adjacent = (uint32_t *)calloc((size_t)vertices + 1, sizeof(uint32_t));
+  uint32_t * cursor = (uint32_t *)malloc(sizeof(uint32_t) * (vertices ? vertices : 1));
+  uint32_t * entries = (uint32_t *)malloc(sizeof(uint32_t) * ((size_t)total * sides + 1));
+  uint8_t * used = (uint8_t *)calloc(total ? total : 1, 1);
+  uint32_t * stackVertex = (uint32_t *)malloc(sizeof(uint32_t) * ((size_t)total + 1));
+  uint32_t * stackEntry = (uint32_t *)malloc(sizeof(uint32_t) * ((size_t)total + 1));
+  uint32_t * walkVertex = (uint32_t *)malloc(sizeof(uint32_t) * ((size_t)total + 1));
+  uint32_t * walkEntry = (uint32_t *)malloc(sizeof(uint32_t) * ((size_t)total + 1));
+  // a strip per line at worst: 2 indices per line and a marker in between
+  enum IndexWidth width = vertices < STRIP_RESTART16 ? Index16 : Index32;
+  size_t capacity = (size_t)count * 3;
+  void * out = malloc((width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t)) * (capacity ? capacity : 1));
+  // fail on malloc failure
+  if (!virtual || !adjacent || !cursor || !entries || !used || !stackVertex || !stackEntry || !walkVertex || !walkEntry || !out) {
+    free(surplus);
+    free(virtual);
+    free(adjacent);
+    free(cursor);
+    free(entries);
+    free(used);
+    free(stackVertex);
+    free(stackEntry);
+    free(walkVertex);
+    free(walkEntry);
+    free(out);
+    return MemAlloc;
+  }
+
+  // virtual lines from vertices with more lines arriving to vertices with more lines leaving (between pairs of odd vertices
+  // without directions) balance every vertex, so every component has a closed walk over all its lines
+  uint32_t k = 0;
+  if (mode == StripAnyDirection) {
+    uint32_t pending = STRIP_NONE;
+    for (v = 0; v < vertices; ++v) {
+      if (surplus[v] && pending == STRIP_NONE) {
+        pending = v;
+      } else if (surplus[v]) {
+        virtual[k * 2] = pending;
+        virtual[k * 2 + 1] = v;
+        ++k;
+        pending = STRIP_NONE;
+      }
+    }
+  } else {
+    uint32_t arrive = 0, leave = 0;
+    for (k = 0; k < extra; ++k) {
+      while (surplus[arrive] >= 0) {
+        ++arrive;
+      }
+      while (surplus[leave] <= 0) {
+        ++leave;
+      }
+      ++surplus[arrive];
+      --surplus[leave];
+      virtual[k * 2] = arrive;
+      virtual[k * 2 + 1] = leave;
+    }
+  }
+  free(surplus);
+
+  // entries of every vertex: line id times 2 of the lines leaving it, plus 1 for lines arriving when directions do not matter
+  for (i = 0; i < total; ++i) {
+    ++adjacent[lineEnd(i, 0, lines, virtual) + 1];
+    adjacent[lineEnd(i, 1, lines, virtual) + 1] += sides - 1;
+  }
+  for (v = 0; v < vertices; ++v) {
+    adjacent[v + 1] += adjacent[v];
+    cursor[v] = adjacent[v];
+  }
+  for (i = 0; i < total; ++i) {
+    entries[cursor[lineEnd(i, 0, lines, virtual)]++] = i * 2;
+    if (sides == 2) {
+      entries[cursor[lineEnd(i, 1, lines, virtual)]++] = i * 2 + 1;
+    }
+  }
+  for (v = 0; v < vertices; ++v) {
+    cursor[v] = adjacent[v];
+  }
+
+  uint32_t size = 0, built = 0, walked = 0;
+  for (v = 0; v < vertices; ++v) {
+    // Hierholzer: follow unused lines, a vertex without any left is popped onto the walk, so closed detours are spliced in
+    uint32_t top = 0, length = 0;
+    stackVertex[0] = v;
+    stackEntry[0] = STRIP_NONE;
+    for (;;) {
+      uint32_t u = stackVertex[top];
+      while (cursor[u] < adjacent[u + 1] && used[entries[cursor[u]] >> 1]) {
+        ++cursor[u];
+      }
+      if (cursor[u] < adjacent[u + 1]) {
+        uint32_t entry = entries[cursor[u]++];
+        used[entry >> 1] = 1;
+        ++top;
+        stackVertex[top] = lineEnd(entry >> 1, !(entry & 1), lines, virtual);
+        stackEntry[top] = entry;
+        continue;
+      }
+      walkVertex[length] = u;
+      walkEntry[length] = stackEntry[top];
+      ++length;
+      if (!top--) {
+        break;
+      }
+    }
+
+    // popped in reverse: line j of the walk runs from walkVertex[j + 1] to walkVertex[j] over walkEntry[j]
+    // the walk is closed, starting right after a virtual line keeps every strip in one piece
+    uint32_t steps = length - 1;
+    uint32_t start = 0;
+    uint32_t j;
+    for (j = 0; j < steps; ++j) {
+      if ((walkEntry[j] >> 1) >= count) {
+        start = j;
+        break;
+      }
+    }
+    int8_t open = 0;
+    for (j = 0; j < steps; ++j) {
+      uint32_t at = (start + steps - 1 - j) % steps;
+      if ((walkEntry[at] >> 1) >= count) {
+        open = 0;
+        continue;
+      }
+      if (!open) {
+        if (built) {
+          appendIndex(out, &size, width, width == Index16 ? STRIP_RESTART16 : STRIP_RESTART32);
+        }
+        appendIndex(out, &size, width, walkVertex[at + 1]);
+        ++built;
+        open = 1;
+      }
+      appendIndex(out, &size, width, walkVertex[at]);
+      ++walked;
+    }
+  }
+  free(virtual);
+  free(adjacent);
+  free(cursor);
+  free(entries);
+  free(used);
+  free(stackVertex);
+  free(stackEntry);
+  free(walkVertex);
+  free(walkEntry);
+
+  void * shrunk = realloc(out, (width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t)) * (size ? size : 1));
+  strips->indices.indices = (uint16_t *)(shrunk ? shrunk : out);
+  strips->indices.size = size;
+  strips->indices.width = width;
+  strips->strips = built;
+  strips->lines = walked;
+  if (stats) {
+    stats->lines = count;
+    stats->strips = built;
+    stats->indices = size;
+    stats->listBytes = (uint64_t)count * 2 * (lines->width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t));
+    stats->stripBytes = (uint64_t)size * (width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t));
+  }
+  return Success;
+}
+
+void freeStripBuffer(StripBuffer * strips) {
+  if (!strips) {
+    return;
+  }
+  free(strips->indices.indices);
+  strips->indices.indices = NULL;
+  strips->indices.size = 0;
+  strips->strips = 0;
+  strips->lines = 0;
+}
+
+enum codes iterateStripBatches(VertexBuffer const * vertices, StripBuffer const * strips, batchIterator fnIterator, void * user) {
+  // fail on NULL pointers
+  if (!vertices || !strips || !fnIterator) {
+    return NullPointer;
+  }
+  LineBatch batch;
+  batch.count = 0;
+  batch.offset = 0;
+  uint32_t restart = strips->indices.width == Index16 ? STRIP_RESTART16 : STRIP_RESTART32;
+  Vertex const * previous = NULL;
+  uint32_t i;
+  // fail on indices outside the vertices, before any batch is handed out
+  for (i = 0; i < strips->indices.size; ++i) {
+    uint32_t index = getIndex(i, &strips->indices);
+    if (index != restart && index >= vertices->size) {
+      return InvalidBuffer;
+    }
+  }
+  for (i = 0; i < strips->indices.size; ++i) {
+    uint32_t index = getIndex(i, &strips->indices);
+    if (index == restart) {
+      previous = NULL;
+      continue;
+    }
+    Vertex const * current = &vertices->vertices[index];
+    if (previous) {
+      batch.first[batch.count] = previous;
+      batch.second[batch.count] = current;
+      if (++batch.count == LINE_BATCH) {
+        fnIterator(&batch, user);
+        batch.offset += LINE_BATCH;
+        batch.count = 0;
+      }
+    }
+    previous = current;
+  }
+  if (batch.count) {
+    fnIterator(&batch, user);
+  }
+  return Success;
+}
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+static inline uint32_t lineEnd(uint32_t line, uint32_t second, IndexBuffer const * lines, uint32_t const * virtual) {
+  uint32_t count = lines->size / 2;
+  return line < count ? getIndex(line * 2 + second, lines) : virtual[(line - count) * 2 + second];
+}
+
+static inline void appendIndex(void * out, uint32_t * size, enum IndexWidth width, uint32_t index) {
+  if (width == Index16) {
+    ((uint16_t *)out)[(*size)++] = (uint16_t)index;
+  } else {
+    ((uint32_t *)out)[(*size)++] = index;
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef GSTRIP_H
+#define GSTRIP_H
+
+/*! \file gstrip.h
+  \brief Line strips.
+  Chains the lines of an index buffer into strips along shared vertices: a strip of k + 1 indices holds k lines.
+  Strips are stored back to back in one index buffer, separated by a restart marker, so a mesh of long strips
+  needs close to 1 index per line instead of 2.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include "codes.h"
+#include "gtypes.h"
+#include <stdint.h>
+
+
+#define STRIP_RESTART16 UINT16_MAX                 //!< Restart marker of 16 bit strips.
+#define STRIP_RESTART32 UINT32_MAX                 //!< Restart marker of 32 bit strips.
+
+
+// ----------------- Enums -------------------------------------------------------------------------
+
+/*! \enum StripMode
+  \brief Lines 'buildStrips' may chain.
+*/
+enum StripMode {
+  StripKeepDirection,                             //!< Lines keep their direction, so they draw the same pixels in the same color.
+  StripAnyDirection,                              //!< Lines may be reversed, giving longer strips; a reversed line takes the color of its other vertex.
+};
+
+
+// ----------------- Structs -----------------------------------------------------------------------
+
+/*! \struct StripBuffer
+  \brief Lines as strips.
+  Line j of a strip runs from its index j to its index j + 1. Strips are separated by STRIP_RESTART16 or STRIP_RESTART32,
+  by width of the indices. 16 bits are used when the vertices allow it with the marker left out.
+*/
+typedef struct StripBuffer {
+  IndexBuffer indices;                            //!< Indices of all strips with the markers in between.
+  uint32_t strips;                                //!< Amount of strips.
+  uint32_t lines;                                 //!< Amount of lines in all strips.
+} StripBuffer;
+
+/*! \struct StripStats
+  \brief Counts of 'buildStrips'.
+*/
+typedef struct StripStats {
+  uint32_t lines;                                 //!< Lines of the index buffer.
+  uint32_t strips;                                //!< Strips built.
+  uint32_t indices;                               //!< Indices of the strips, markers included.
+  uint64_t listBytes;                             //!< Size of the indices as a line list in bytes.
+  uint64_t stripBytes;                            //!< Size of the indices as strips in bytes.
+} StripStats;
+
+
+// ----------------- Strip Functions ---------------------------------------------------------------
+
+/*! \brief Builds strips from a line list.
+  Eulerian path cover: virtual lines are added from every vertex with more lines arriving than leaving to one with more
+  leaving than arriving (between pairs of odd degree vertices with StripAnyDirection), which balances every vertex.
+  Hierholzer's algorithm then finds a closed walk over all lines of each component, and each walk is cut into strips
+  at its virtual lines. Every line ends up in exactly 1 strip, and the amount of strips is minimal: one per virtual line
+  plus one per component without unbalanced vertices, which is the least any cover needs.
+  \param lines Pointer to index buffer with the lines.
+  \param vertices Amount of vertices the indices refer to.
+  \param mode Lines that may be chained.
+  \param strips Pointer to strip buffer to receive the strips, free it with 'freeStripBuffer'.
+  \param stats Pointer to receive the counts, may be NULL.
+  \return Result code, InvalidBuffer for indices outside 'vertices'.
+  \see codes
+*/
+enum codes buildStrips(IndexBuffer const * lines, uint32_t vertices, enum StripMode mode, StripBuffer * strips, StripStats * stats);
+
+/*! \brief Frees a strip buffer.
+  \param strips Pointer to strip buffer filled by 'buildStrips'.
+*/
+void freeStripBuffer(StripBuffer * strips);
+
+/*! \brief Iterates through all lines of strips a batch at a time.
+  Same as 'iterateLineBatches' for the lines of the strips, in strip order. 'LineBatch.offset' counts lines in strip order.
+  \param vertices Pointer to vertex buffer the strips refer to.
+  \param strips Pointer to strips.
+  \param fnIterator Callback function for each batch.
+  \param user Pointer passed to every call of 'fnIterator'.
+  \return Result code, InvalidBuffer for indices outside 'vertices' (no batch is handed out then).
+  \see codes
+*/
+enum codes iterateStripBatches(VertexBuffer const * vertices, StripBuffer const * strips, batchIterator fnIterator, void * user);
+
+
+#endif // GSTRIP_H
@@ -0,0 +1,285 @@
+#include "gtopo.h"
+
+/*! \file gtopo.c
+  \brief Face topology and edge culling.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ull   //!< Fibonacci hashing multiplier, 2^64 divided by the golden ratio.
+
+
+// ----------------- Local Function declarations ---------------------------------------------------
+
+/*! \brief Computes the face planes of a topology.
+  Normals are Newell normals, so concave and slightly non planar faces get a sensible plane as well.
+  \param vertices Pointer to vertex buffer the faces refer to.
+  \param topology Pointer to topology with faces and allocated planes.
+*/
+static void computePlanes(VertexBuffer const * vertices, Topology * topology);
+
+/*! \brief Builds the edge adjacency of a topology.
+  \param topology Pointer to topology with faces.
+  \return Result code.
+*/
+static enum codes buildEdges(Topology * topology);
+
+
+// ----------------- Topology Functions ------------------------------------------------------------
+
+enum codes initTopology(VertexBuffer const * vertices, uint32_t faces, uint32_t * faceStart, uint32_t * faceIndices, Topology ** topology) {
+  // fail on NULL pointers
+  if (!vertices || !faceStart || !topology || (!faceIndices && faceStart[faces])) {
+    free(faceStart);
+    free(faceIndices);
+    return NullPointer;
+  }
+  // fail on indices outside the vertices
+  uint32_t i;
+  for (i = 0; i < faceStart[faces]; ++i) {
+    if (faceIndices[i] >= vertices->size) {
+      free(faceStart);
+      free(faceIndices);
+      return InvalidBuffer;
+    }
+  }
+  Topology * t = (Topology *)calloc(1, sizeof(Topology));
+  // fail on malloc failure
+  if (!t) {
+    free(faceStart);
+    free(faceIndices);
+    return MemAlloc;
+  }
+  t->faceStart = faceStart;
+  t->faceIndices = faceIndices;
+  t->faces = faces;
+  // all planes share one block starting at 'planeX'
+  t->planeX = (float *)malloc(sizeof(float) * 4 * (size_t)(faces ? faces : 1));
+  if (!t->planeX) {
+    freeTopology(t);
+    return MemAlloc;
+  }
+  t->planeY = t->planeX + faces;
+  t->planeZ = t->planeY + faces;
+  t->planeD = t->planeZ + faces;
+  computePlanes(vertices, t);
+
+  enum codes result = buildEdges(t);
+  if (result != Success) {
+    freeTopology(t);
+    return result;
+  }
+  *topology = t;
+  return Success;
+}
+
+void freeTopology(Topology * topology) {
+  if (!topology) {
+    return;
+  }
+  free(topology->faceStart);
+  free(topology->faceIndices);
+  free(topology->planeX);
+  free(topology->edges);
+  free(topology->edgeFaces);
+  free(topology);
+}
+
+
+// ----------------- Cull Functions ----------------------------------------------------------------
+
+enum codes initCullBuffer(Mesh const * mesh, CullBuffer * cb) {
+  // fail on NULL pointers
+  if (!mesh || !cb) {
+    return NullPointer;
+  }
+  // fail on a mesh without faces
+  if (!mesh->topology) {
+    return InvalidParam;
+  }
+  Topology const * t = mesh->topology;
+  enum codes result = initIndexBuffer(t->edgeCount ? t->edgeCount : 1, mesh->indices.width, &cb->lines);
+  if (result != Success) {
+    return result;
+  }
+  cb->facing = (uint8_t *)malloc(t->faces ? t->faces : 1);
+  // fail on malloc failure
+  if (!cb->facing) {
+    free(cb->lines.indices);
+    cb->lines.indices = NULL;
+    return MemAlloc;
+  }
+  cb->lines.size = 0;
+  cb->capacity = t->edgeCount;
+  cb->faces = t->faces;
+  return Success;
+}
+
+void freeCullBuffer(CullBuffer * cb) {
+  if (!cb) {
+    return;
+  }
+  free(cb->lines.indices);
+  free(cb->facing);
+  cb->lines.indices = NULL;
+  cb->lines.size = 0;
+  cb->facing = NULL;
+  cb->capacity = 0;
+  cb->faces = 0;
+}
+
+enum codes cullEdges(Mesh const * mesh, Vector eye, enum CullMode mode, CullBuffer * cb, CullStats * stats) {
+  // fail on NULL pointers
+  if (!mesh || !cb || !mesh->topology) {
+    return NullPointer;
+  }
+  Topology const * t = mesh->topology;
+  // fail on a buffer made for another mesh
+  if (cb->capacity < t->edgeCount || cb->faces < t->faces || cb->lines.width != mesh->indices.width) {
+    return InvalidBuffer;
+  }
+
+  // one plane test per face, a loop over 4 arrays the compiler can vectorize
+  uint8_t * facing = cb->facing;
+  uint32_t front = 0;
+  uint32_t f;
+  for (f = 0; f < t->faces; ++f) {
+    facing[f] = t->planeX[f] * eye.x + t->planeY[f] * eye.y + t->planeZ[f] * eye.z + t->planeD[f] > 0.0f;
+    front += facing[f];
+  }
+
+  // every edge is written and kept by advancing the output, so there is no branch to mispredict
+  // a border edge has no second face, it counts as back facing so the border of a front face is part of the silhouette
+  uint32_t kept = 0;
+  uint32_t e;
+  if (cb->lines.width == Index16) {
+    for (e = 0; e < t->edgeCount; ++e) {
+      uint32_t second = t->edgeFaces[e * 2 + 1];
+      uint8_t a = facing[t->edgeFaces[e * 2]];
+      uint8_t b = second == TOPOLOGY_NO_FACE ? 0 : facing[second];
+      cb->lines.indices[kept * 2] = (uint16_t)t->edges[e * 2];
+      cb->lines.indices[kept * 2 + 1] = (uint16_t)t->edges[e * 2 + 1];
+      kept += mode == CullFront ? (a | b) : (a ^ b);
+    }
+  } else {
+    for (e = 0; e < t->edgeCount; ++e) {
+      uint32_t second = t->edgeFaces[e * 2 + 1];
+      uint8_t a = facing[t->edgeFaces[e * 2]];
+      uint8_t b = second == TOPOLOGY_NO_FACE ? 0 : facing[second];
+      cb->lines.indices32[kept * 2] = t->edges[e * 2];
+      cb->lines.indices32[kept * 2 + 1] = t->edges[e * 2 + 1];
+      kept += mode == CullFront ? (a | b) : (a ^ b);
+    }
+  }
+  cb->lines.size = kept * 2;
+  if (stats) {
+    stats->faces = t->faces;
+    stats->front = front;
+    stats->edges = t->edgeCount;
+    stats->kept = kept;
+  }
+  return Success;
+}
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+static void computePlanes(VertexBuffer const * vertices, Topology * topology) {
+  uint32_t f;
+  for (f = 0; f < topology->faces; ++f) {
+    uint32_t first = topology->faceStart[f];
+    uint32_t end = topology->faceStart[f + 1];
+    Vector normal = {0.0f, 0.0f, 0.0f};
+    Vector center = {0.0f, 0.0f, 0.0f};
+    uint32_t i;
+    for (i = first; i < end; ++i) {
+      Vector a = vertices->vertices[topology->faceIndices[i]].coord;
+      Vector b = vertices->vertices[topology->faceIndices[i + 1 < end ? i + 1 : first]].coord;
+      normal.x += (a.y - b.y) * (a.z + b.z);
+      normal.y += (a.z - b.z) * (a.x + b.x);
+      normal.z += (a.x - b.x) * (a.y + b.y);
+      center = addVector(center, a);
+    }
+    // the plane goes through the centroid, a degenerate face gets a zero plane and never faces the eye
+    if (end > first) {
+      center = scaleVector(center, 1.0f / (float)(end - first));
+    }
+    topology->planeX[f] = normal.x;
+    topology->planeY[f] = normal.y;
+    topology->planeZ[f] = normal.z;
+    topology->planeD[f] = -dotVector(normal, center);
+  }
+}
+
+static enum codes buildEdges(Topology * topology) {
+  // every index of a face starts an edge, so there are at most as many edges as indices
+  uint32_t slots = topology->faceStart[topology->faces];
+  uint32_t bits = 4;
+  while (((uint64_t)1 << bits) < (uint64_t)slots * 2) {
+    ++bits;
+  }
+  // keys are (low << 32 | high) + 1, so 0 marks an empty slot
+  uint64_t * keys = (uint64_t *)calloc((size_t)1 << bits, sizeof(uint64_t));
+  uint32_t * ids = (uint32_t *)malloc(sizeof(uint32_t) * ((size_t)1 << bits));
+  topology->edges = (uint32_t *)malloc(sizeof(uint32_t) * 2 * (size_t)(slots ? slots : 1));
+  topology->edgeFaces = (uint32_t *)malloc(sizeof(uint32_t) * 2 * (size_t)(slots ? slots : 1));
+  // fail on malloc failure
+  if (!keys || !ids || !topology->edges || !topology->edgeFaces) {
+    free(keys);
+    free(ids);
+    return MemAlloc;
+  }
+
+  uint64_t mask = ((uint64_t)1 << bits) - 1;
+  uint32_t count = 0;
+  uint32_t f;
+  for (f = 0; f < topology->faces; ++f) {
+    uint32_t first = topology->faceStart[f];
+    uint32_t end = topology->faceStart[f + 1];
+    uint32_t i;
+    for (i = first; i < end; ++i) {
+      uint32_t a = topology->faceIndices[i];
+      uint32_t b = topology->faceIndices[i + 1 < end ? i + 1 : first];
+      if (a == b) {
+        continue;
+      }
+      uint64_t key = ((uint64_t)(a < b ? a : b) << 32 | (a < b ? b : a)) + 1;
+      uint64_t slot = (key * HASH_MULTIPLIER) >> (64 - bits);
+      while (keys[slot] && keys[slot] != key) {
+        slot = (slot + 1) & mask;
+      }
+      if (!keys[slot]) {
+        // new edge, oriented as its first face runs
+        keys[slot] = key;
+        ids[slot] = count;
+        topology->edges[count * 2] = a;
+        topology->edges[count * 2 + 1] = b;
+        topology->edgeFaces[count * 2] = f;
+        topology->edgeFaces[count * 2 + 1] = TOPOLOGY_NO_FACE;
+        ++count;
+      } else if (topology->edgeFaces[ids[slot] * 2 + 1] == TOPOLOGY_NO_FACE && topology->edgeFaces[ids[slot] * 2] != f) {
+        topology->edgeFaces[ids[slot] * 2 + 1] = f;
+      }
+    }
+  }
+  free(keys);
+  free(ids);
+
+  // give back what the duplicates did not use
+  topology->edgeCount = count;
+  if (count) {
+    uint32_t * edges = (uint32_t *)realloc(topology->edges, sizeof(uint32_t) * 2 * count);
+    uint32_t * edgeFaces = (uint32_t *)realloc(topology->edgeFaces, sizeof(uint32_t) * 2 * count);
+    topology->edges = edges ? edges : topology->edges;
+    topology->edgeFaces = edgeFaces ? edgeFaces : topology->edgeFaces;
+  }
+  return Success;
+}
@@ -0,0 +1,126 @@
+#ifndef GTOPO_H
+#define GTOPO_H
+
+/*! \file gtopo.h
+  \brief Face topology and edge culling.
+  Faces of a mesh with the faces on both sides of every edge, so lines can be culled by the faces they belong to.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include "codes.h"
+#include "gtypes.h"
+#include <stdint.h>
+
+
+#define TOPOLOGY_NO_FACE UINT32_MAX               //!< Second face of an edge on the border of the mesh.
+
+
+// ----------------- Enums -------------------------------------------------------------------------
+
+/*! \enum CullMode
+  \brief Edges kept by 'cullEdges'.
+*/
+enum CullMode {
+  CullFront,                                      //!< Edges of at least one front facing face.
+  CullSilhouette,                                 //!< Edges between a front and a back facing face, and border edges of front facing faces.
+};
+
+
+// ----------------- Structs -----------------------------------------------------------------------
+
+/*! \struct Topology
+  \brief Faces and edge adjacency of a mesh.
+  Faces are stored compressed: face f has the indices 'faceIndices[faceStart[f]]' up to 'faceIndices[faceStart[f + 1]]'.
+  A face faces the viewer when its indices run counter clockwise, like wavefront files describe them.
+  Edges shared by more than 2 faces keep the first 2.
+*/
+struct Topology {
+  uint32_t * faceStart;                           //!< First index of every face, 'faces' + 1 entries.
+  uint32_t * faceIndices;                         //!< Vertex indices of all faces.
+  uint32_t faces;                                 //!< Amount of faces.
+  float * planeX;                                 //!< X of the face normals, not normalized.
+  float * planeY;                                 //!< Y of the face normals.
+  float * planeZ;                                 //!< Z of the face normals.
+  float * planeD;                                 //!< Plane offsets, a point p is in front of face f when normal . p + planeD[f] > 0.
+  uint32_t * edges;                               //!< 2 vertex indices per edge, every edge once.
+  uint32_t * edgeFaces;                           //!< 2 faces per edge, the second is TOPOLOGY_NO_FACE on the border.
+  uint32_t edgeCount;                             //!< Amount of edges.
+};
+
+/*! \struct CullBuffer
+  \brief Result and scratch space of 'cullEdges'.
+  Sized for one mesh by 'initCullBuffer' and reused every frame.
+*/
+typedef struct CullBuffer {
+  IndexBuffer lines;                              //!< Kept edges as lines, same width as the indices of the mesh.
+  uint8_t * facing;                               //!< Per face 1 when it faces the eye.
+  uint32_t capacity;                              //!< Amount of lines that fit in 'lines'.
+  uint32_t faces;                                 //!< Amount of elements in 'facing'.
+} CullBuffer;
+
+/*! \struct CullStats
+  \brief Counts of 'cullEdges'.
+*/
+typedef struct CullStats {
+  uint32_t faces;                                 //!< Faces of the mesh.
+  uint32_t front;                                 //!< Faces facing the eye.
+  uint32_t edges;                                 //!< Edges of the mesh.
+  uint32_t kept;                                  //!< Edges written as lines.
+} CullStats;
+
+
+// ----------------- Topology Functions ------------------------------------------------------------
+
+/*! \brief Builds a topology.
+  Computes the face planes and the edge adjacency. Takes ownership of 'faceStart' and 'faceIndices', also on failure.
+  \param vertices Pointer to vertex buffer the faces refer to.
+  \param faces Amount of faces.
+  \param faceStart First index of every face, 'faces' + 1 entries, allocated with malloc.
+  \param faceIndices Vertex indices of all faces, allocated with malloc.
+  \param topology Pointer to receive the topology, free it with 'freeTopology'.
+  \return Result code, InvalidBuffer for indices outside 'vertices'.
+  \see codes
+*/
+enum codes initTopology(VertexBuffer const * vertices, uint32_t faces, uint32_t * faceStart, uint32_t * faceIndices, Topology ** topology);
+
+/*! \brief Frees a topology.
+  \param topology Pointer to topology built by 'initTopology', may be NULL.
+*/
+void freeTopology(Topology * topology);
+
+
+// ----------------- Cull Functions ----------------------------------------------------------------
+
+/*! \brief Initializes a cull buffer for a mesh.
+  \param mesh Pointer to mesh with topology.
+  \param cb Pointer to cull buffer to initialize.
+  \return Result code, InvalidParam for a mesh without topology.
+  \see codes
+*/
+enum codes initCullBuffer(Mesh const * mesh, CullBuffer * cb);
+
+/*! \brief Frees a cull buffer.
+  \param cb Pointer to cull buffer initialized by 'initCullBuffer'.
+*/
+void freeCullBuffer(CullBuffer * cb);
+
+/*! \brief Culls the edges of a mesh.
+  Classifies every face against the eye, then writes the edges kept by 'mode' to 'cb->lines'.
+  The lines index the vertices of 'mesh', so they can be drawn as a mesh with the same vertex buffer.
+  Lines of the mesh that are not edges of a face (wavefront faces of 2 indices) are never kept.
+  \param mesh Pointer to mesh with topology.
+  \param eye Position of the eye in model coordinates.
+  \param mode Edges to keep.
+  \param cb Pointer to cull buffer initialized for 'mesh'.
+  \param stats Pointer to receive the counts, may be NULL.
+  \return Result code.
+  \see codes
+*/
+enum codes cullEdges(Mesh const * mesh, Vector eye, enum CullMode mode, CullBuffer * cb, CullStats * stats);
+
+
+#endif // GTOPO_H
@@ -9,13 +9,284 @@
 */
 
 
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNEL_X86 1                              //!< Vector implementations are available.
+#include <immintrin.h>
+#endif
+
+
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ull   //!< Fibonacci hashing multiplier, 2^64 divided by the golden ratio.
+
+static enum Kernel activeKernel = KAuto;          //!< Selected kernel, KAuto until first use.
+
+
+// ----------------- Kernel Functions --------------------------------------------------------------
+
+int8_t selectKernel(enum Kernel kernel) {
+#ifdef KERNEL_X86
+  __builtin_cpu_init();
+  int8_t bSSE = __builtin_cpu_supports("sse2") != 0;
+  int8_t bAVX = __builtin_cpu_supports("avx") != 0;
+#else
+  int8_t bSSE = 0;
+  int8_t bAVX = 0;
+#endif
+
+  switch (kernel) {
+  case KAuto:
+    kernel = bAVX ? KAVX : bSSE ? KSSE : KScalar;
+    break;
+
+  case KScalar:
+    break;
+
+  case KSSE:
+    if (!bSSE) {
+      return 0;
+    }
+    break;
+
+  case KAVX:
+    if (!bAVX) {
+      return 0;
+    }
+    break;
+
+  default:
+    return 0;
+  }
+  __atomic_store_n(&activeKernel, kernel, __ATOMIC_RELAXED);
+  return 1;
+}
+
+enum Kernel getKernel(void) {
+  enum Kernel kernel = __atomic_load_n(&activeKernel, __ATOMIC_RELAXED);
+  // every thread selects the same implementation, so racing on the first use is harmless
+  if (kernel == KAuto) {
+    selectKernel(KAuto);
+    kernel = __atomic_load_n(&activeKernel, __ATOMIC_RELAXED);
+  }
+  return kernel;
+}
+
+
+// ----------------- Vector Functions --------------------------------------------------------------
+
+Vector addVector(Vector a, Vector b) {
+  Vector v = { a.x + b.x, a.y + b.y, a.z + b.z };
+  return v;
+}
+
+Vector subtractVector(Vector a, Vector b) {
+  Vector v = { a.x - b.x, a.y - b.y, a.z - b.z };
+  return v;
+}
+
+Vector scaleVector(Vector v, float factor) {
+  Vector r = { v.x * factor, v.y * factor, v.z * factor };
+  return r;
+}
+
+float dotVector(Vector a, Vector b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vector crossVector(Vector a, Vector b) {
+  Vector v = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+  return v;
+}
+
+float lengthVector(Vector v) {
+  return sqrtf(dotVector(v, v));
+}
+
+Vector normalizeVector(Vector v) {
+  float length = lengthVector(v);
+  return length > 0.0f ? scaleVector(v, 1.0f / length) : v;
+}
+
+Vector transformVector(Matrix4 const * matrix, Vector v) {
+  // evaluation order is the same as in the vector kernels, so all implementations round identically
+  float const * m = matrix->m;
+  float x = ((m[0] * v.x + m[1] * v.y) + m[2] * v.z) + m[3];
+  float y = ((m[4] * v.x + m[5] * v.y) + m[6] * v.z) + m[7];
+  float z = ((m[8] * v.x + m[9] * v.y) + m[10] * v.z) + m[11];
+  float w = ((m[12] * v.x + m[13] * v.y) + m[14] * v.z) + m[15];
+  Vector r = { x / w, y / w, z / w };
+  return r;
+}
+
+
+// ----------------- Matrix Functions --------------------------------------------------------------
+
+void identityMatrix(Matrix4 * out) {
+  memset(out, 0, sizeof(Matrix4));
+  out->m[0] = out->m[5] = out->m[10] = out->m[15] = 1.0f;
+}
+
+void multiplyMatrix(Matrix4 const * a, Matrix4 const * b, Matrix4 * out) {
+  // computed in a temporary, 'out' may be one of the operands
+  Matrix4 r;
+  int row, column;
+  for (row = 0; row < 4; ++row) {
+    for (column = 0; column < 4; ++column) {
+      r.m[row * 4 + column] = a->m[row * 4] * b->m[column] + a->m[row * 4 + 1] * b->m[4 + column]
+        + a->m[row * 4 + 2] * b->m[8 + column] + a->m[row * 4 + 3] * b->m[12 + column];
+    }
+  }
+  *out = r;
+}
+
+void translationMatrix(Vector offset, Matrix4 * out) {
+  identityMatrix(out);
+  out->m[3] = offset.x;
+  out->m[7] = offset.y;
+  out->m[11] = offset.z;
+}
+
+void scaleMatrix(Vector factors, Matrix4 * out) {
+  identityMatrix(out);
+  out->m[0] = factors.x;
+  out->m[5] = factors.y;
+  out->m[10] = factors.z;
+}
+
+void rotationMatrix(Vector axis, float angle, Matrix4 * out) {
+  // Rodrigues' rotation formula
+  Vector n = normalizeVector(axis);
+  float c = cosf(angle);
+  float s = sinf(angle);
+  float t = 1.0f - c;
+  identityMatrix(out);
+  out->m[0] = t * n.x * n.x + c;
+  out->m[1] = t * n.x * n.y - s * n.z;
+  out->m[2] = t * n.x * n.z + s * n.y;
+  out->m[4] = t * n.x * n.y + s * n.z;
+  out->m[5] = t * n.y * n.y + c;
+  out->m[6] = t * n.y * n.z - s * n.x;
+  out->m[8] = t * n.x * n.z - s * n.y;
+  out->m[9] = t * n.y * n.z + s * n.x;
+  out->m[10] = t * n.z * n.z + c;
+}
+
+void lookAtMatrix(Vector eye, Vector target, Vector up, Matrix4 * out) {
+  Vector forward = normalizeVector(subtractVector(target, eye));
+  Vector side = normalizeVector(crossVector(forward, up));
+  Vector upward = crossVector(side, forward);
+  identityMatrix(out);
+  out->m[0] = side.x;
+  out->m[1] = side.y;
+  out->m[2] = side.z;
+  out->m[3] = -dotVector(side, eye);
+  out->m[4] = upward.x;
+  out->m[5] = upward.y;
+  out->m[6] = upward.z;
+  out->m[7] = -dotVector(upward, eye);
+  out->m[8] = -forward.x;
+  out->m[9] = -forward.y;
+  out->m[10] = -forward.z;
+  out->m[11] = dotVector(forward, eye);
+}
+
+void perspectiveMatrix(float fovy, float aspect, float near, float far, Matrix4 * out) {
+  float f = 1.0f / tanf(fovy * 0.5f);
+  memset(out, 0, sizeof(Matrix4));
+  out->m[0] = f / aspect;
+  out->m[5] = f;
+  out->m[10] = (far + near) / (near - far);
+  out->m[11] = 2.0f * far * near / (near - far);
+  out->m[14] = -1.0f;
+}
+
+void viewportMatrix(float width, float height, Matrix4 * out) {
+  // y is flipped, screen rows grow downwards
+  identityMatrix(out);
+  out->m[0] = width * 0.5f;
+  out->m[3] = width * 0.5f;
+  out->m[5] = -height * 0.5f;
+  out->m[7] = height * 0.5f;
+  out->m[10] = 0.5f;
+  out->m[11] = 0.5f;
+}
+
+
+// ----------------- Vertex Functions --------------------------------------------------------------
+
+void transformVertex(Matrix4 const * matrix, Vertex const * in, Vertex * out) {
+  out->coord = transformVector(matrix, in->coord);
+  out->color = in->color;
+}
+
+
+// ----------------- Transform kernels -------------------------------------------------------------
+
+/*! \brief Transforms vertices.
+  Kernels of 'transformVertexBuffer', 'in' and 'out' may be the same.
+  \param matrix Pointer to transformation.
+  \param in First vertex to transform.
+  \param out First vertex to receive the result.
+  \param count Amount of vertices.
+*/
+static void transformScalar(Matrix4 const * matrix, Vertex const * in, Vertex * out, uint32_t count) {
+  uint32_t i;
+  for (i = 0; i < count; ++i) {
+    transformVertex(matrix, &in[i], &out[i]);
+  }
+}
+
+#ifdef KERNEL_X86
+// a vertex is loaded as 4 floats: x, y, z and the color (with its padding) as 4th lane, which is passed through untouched
+// the matrix is held as its 4 columns, so a vertex is transformed with 3 broadcasts and multiply-adds
+
+__attribute__((target("sse2")))
+static void transformSSE(Matrix4 const * matrix, Vertex const * in, Vertex * out, uint32_t count) {
+  float const * m = matrix->m;
+  __m128 c0 = _mm_setr_ps(m[0], m[4], m[8], m[12]);
+  __m128 c1 = _mm_setr_ps(m[1], m[5], m[9], m[13]);
+  __m128 c2 = _mm_setr_ps(m[2], m[6], m[10], m[14]);
+  __m128 c3 = _mm_setr_ps(m[3], m[7], m[11], m[15]);
+  __m128 keep = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+  uint32_t i;
+  for (i = 0; i < count; ++i) {
+    __m128 v = _mm_loadu_ps((float const *)&in[i]);
+    __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(v, v, 0x00)), _mm_mul_ps(c1, _mm_shuffle_ps(v, v, 0x55)));
+    r = _mm_add_ps(_mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, 0xAA))), c3);
+    r = _mm_div_ps(r, _mm_shuffle_ps(r, r, 0xFF));
+    _mm_storeu_ps((float *)&out[i], _mm_or_ps(_mm_andnot_ps(keep, r), _mm_and_ps(keep, v)));
+  }
+}
+
+// 2 vertices per step, one in each 128 bit half
+__attribute__((target("avx")))
+static void transformAVX(Matrix4 const * matrix, Vertex const * in, Vertex * out, uint32_t count) {
+  float const * m = matrix->m;
+  __m256 c0 = _mm256_setr_ps(m[0], m[4], m[8], m[12], m[0], m[4], m[8], m[12]);
+  __m256 c1 = _mm256_setr_ps(m[1], m[5], m[9], m[13], m[1], m[5], m[9], m[13]);
+  __m256 c2 = _mm256_setr_ps(m[2], m[6], m[10], m[14], m[2], m[6], m[10], m[14]);
+  __m256 c3 = _mm256_setr_ps(m[3], m[7], m[11], m[15], m[3], m[7], m[11], m[15]);
+  uint32_t i;
+  for (i = 0; i + 2 <= count; i += 2) {
+    __m256 v = _mm256_loadu_ps((float const *)&in[i]);
+    __m256 r = _mm256_add_ps(_mm256_mul_ps(c0, _mm256_permute_ps(v, 0x00)), _mm256_mul_ps(c1, _mm256_permute_ps(v, 0x55)));
+    r = _mm256_add_ps(_mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_permute_ps(v, 0xAA))), c3);
+    r = _mm256_div_ps(r, _mm256_permute_ps(r, 0xFF));
+    _mm256_storeu_ps((float *)&out[i], _mm256_blend_ps(r, v, 0x88));
+  }
+  transformSSE(matrix, in + i, out + i, count - i);
+}
+#endif
 
 
 // ----------------- VertexBuffer Functions --------------------------------------------------------
 
-enum codes initVertexBuffer(uint16_t size, VertexBuffer * vb) {
+enum codes initVertexBuffer(uint32_t size, VertexBuffer * vb) {
   // fail on NULL pointers
   if (!vb) {
     return NullPointer;
@@ -29,7 +300,7 @@ enum codes initVertexBuffer(uint16_t size, VertexBuffer * vb) {
   return Success;
 }
 
-Vertex * getVertex(uint16_t index, VertexBuffer * vb) {
+Vertex * getVertex(uint32_t index, VertexBuffer * vb) {
   // fail on NULL pointers
   if (!vb) {
     return NULL;
@@ -41,16 +312,48 @@ Vertex * getVertex(uint16_t index, VertexBuffer * vb) {
   return &vb->vertices[index];
 }
 
+enum codes transformVertexBuffer(Matrix4 const * matrix, VertexBuffer const * in, VertexBuffer * out) {
+  // fail on NULL pointers
+  if (!matrix || !in || !out || (!in->vertices && in->size) || (!out->vertices && in->size)) {
+    return NullPointer;
+  }
+  // fail on a buffer too small
+  if (out->size < in->size) {
+    return InvalidBuffer;
+  }
+  switch (getKernel()) {
+#ifdef KERNEL_X86
+  case KAVX:
+    transformAVX(matrix, in->vertices, out->vertices, in->size);
+    break;
+
+  case KSSE:
+    transformSSE(matrix, in->vertices, out->vertices, in->size);
+    break;
+#endif
+
+  default:
+    transformScalar(matrix, in->vertices, out->vertices, in->size);
+    break;
+  }
+  return Success;
+}
+
 
 // ----------------- IndexBuffer Functions --------------------------------------------------------
 
-enum codes initIndexBuffer(uint16_t lines, IndexBuffer * ib) {
+enum codes initIndexBuffer(uint32_t lines, enum IndexWidth width, IndexBuffer * ib) {
   // fail on NULL pointers
   if (!ib) {
     return NullPointer;
   }
+  // fail on sizes that do not fit
+  if (lines > UINT32_MAX / 2 || (width != Index16 && width != Index32)) {
+    return InvalidParam;
+  }
   ib->size = lines * 2;
-  ib->indices = (uint16_t *)malloc(sizeof(uint16_t) * ib->size);
+  ib->width = width;
+  ib->indices = (uint16_t *)malloc((width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t)) * (size_t)ib->size);
   // fail on malloc failure
   if (!ib->indices) {
     return MemAlloc;
@@ -58,6 +361,107 @@ enum codes initIndexBuffer(uint16_t lines, IndexBuffer * ib) {
   return Success;
 }
 
+enum codes narrowIndexBuffer(uint32_t vertices, IndexBuffer * ib) {
+  // fail on NULL pointers
+  if (!ib || (!ib->indices && ib->size)) {
+    return NullPointer;
+  }
+  if (ib->width == Index16 || vertices > UINT16_MAX + 1) {
+    return Success;
+  }
+  // a 16 bit index is never stored beyond the 32 bit index it came from, so converting front to back is safe
+  // the loaders reject indices outside the vertices, so none is truncated
+  uint32_t i;
+  for (i = 0; i < ib->size; ++i) {
+    assert(ib->indices32[i] < vertices);
+    ib->indices[i] = (uint16_t)ib->indices32[i];
+  }
+  ib->width = Index16;
+  if (ib->size) {
+    // keep the old storage when shrinking fails, it is only larger than needed
+    uint16_t * indices = (uint16_t *)realloc(ib->indices, sizeof(uint16_t) * ib->size);
+    if (indices) {
+      ib->indices = indices;
+    }
+  }
+  return Success;
+}
+
+/*! \brief Inserts a line in a line set.
+  \param set Open addressing set, zero marks an empty slot.
+  \param bits Base 2 logarithm of the set size.
+  \param a First index of the line.
+  \param b Second index of the line.
+  \return 1 when the line was inserted, 0 when it already was in the set.
+*/
+static inline int8_t insertLine(uint64_t * set, uint32_t bits, uint32_t a, uint32_t b) {
+  // keys are stored plus one so zero stays free to mark empty slots
+  uint64_t mask = (1ull << bits) - 1;
+  uint64_t key = (a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a)) + 1;
+  uint64_t slot = (key * HASH_MULTIPLIER) >> (64 - bits);
+  while (set[slot] && set[slot] != key) {
+    slot = (slot + 1) & mask;
+  }
+  if (set[slot]) {
+    return 0;
+  }
+  set[slot] = key;
+  return 1;
+}
+
+enum codes dedupLines(IndexBuffer * ib) {
+  // fail on NULL pointers
+  if (!ib || (!ib->indices && ib->size)) {
+    return NullPointer;
+  }
+  uint32_t lines = ib->size / 2;
+  if (lines < 2) {
+    return Success;
+  }
+  // set is at most half full
+  uint32_t bits = 1;
+  while ((1ull << bits) < (uint64_t)lines * 2) {
+    ++bits;
+  }
+  uint64_t * set = (uint64_t *)calloc((size_t)1 << bits, sizeof(uint64_t));
+  // fail on malloc failure
+  if (!set) {
+    return MemAlloc;
+  }
+
+  uint32_t i, kept = 0;
+  if (ib->width == Index16) {
+    for (i = 0; i < lines; ++i) {
+      uint16_t a = ib->indices[i * 2];
+      uint16_t b = ib->indices[i * 2 + 1];
+      if (insertLine(set, bits, a, b)) {
+        ib->indices[kept * 2] = a;
+        ib->indices[kept * 2 + 1] = b;
+        ++kept;
+      }
+    }
+  } else {
+    for (i = 0; i < lines; ++i) {
+      uint32_t a = ib->indices32[i * 2];
+      uint32_t b = ib->indices32[i * 2 + 1];
+      if (insertLine(set, bits, a, b)) {
+        ib->indices32[kept * 2] = a;
+        ib->indices32[kept * 2 + 1] = b;
+        ++kept;
+      }
+    }
+  }
+  free(set);
+
+  ib->size = kept * 2;
+  // keep the old storage when shrinking fails, it is only larger than needed
+  uint16_t * indices = (uint16_t *)realloc(ib->indices, (ib->width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t)) * ib->size);
+  if (indices) {
+    ib->indices = indices;
+  }
+  return Success;
+}
+
 
 // ----------------- Mesh Functions ----------------------------------------------------------------
 
@@ -66,9 +470,154 @@ enum codes iterateLines(Mesh const * mesh, meshIterator fnIterator) {
   if (!mesh) {
     return NullPointer;
   }
-  int i;
-  for (i = 0; (i + 1) < mesh->indices.size; i += 2) {
-    fnIterator(&mesh->vertices.vertices[mesh->indices.indices[i]], &mesh->vertices.vertices[mesh->indices.indices[i + 1]]);
+  Vertex const * vertices = mesh->vertices.vertices;
+  uint32_t i;
+  // one loop per width keeps the width check out of the loop
+  if (mesh->indices.width == Index16) {
+    uint16_t const * indices = mesh->indices.indices;
+    for (i = 0; (i + 1) < mesh->indices.size; i += 2) {
+      fnIterator(&vertices[indices[i]], &vertices[indices[i + 1]]);
+    }
+  } else {
+    uint32_t const * indices = mesh->indices.indices32;
+    for (i = 0; (i + 1) < mesh->indices.size; i += 2) {
+      fnIterator(&vertices[indices[i]], &vertices[indices[i + 1]]);
+    }
+  }
+  return Success;
+}
+
+/*! \brief Fills a batch from an index range.
+  \param vertices Vertices of the mesh.
+  \param indices Indices of the lines in the batch, 2 per line.
+  \param count Amount of lines, at most LINE_BATCH.
+  \param batch Pointer to batch to fill.
+*/
+#define FILL_BATCH(vertices, indices, count, batch) \
+  do { \
+    uint32_t j; \
+    for (j = 0; j < (count); ++j) { \
+      (batch)->first[j] = &(vertices)[(indices)[j * 2]]; \
+      (batch)->second[j] = &(vertices)[(indices)[j * 2 + 1]]; \
+    } \
+    (batch)->count = (count); \
+  } while (0)
+
+/*! \brief Iterates through a range of lines a batch at a time.
+  Calls 'fnBatch' when set, 'fnWorker' otherwise.
+  \param mesh Pointer to mesh.
+  \param first First line of the range.
+  \param end End of the range, in lines.
+  \param worker Worker id passed to 'fnWorker'.
+  \param fnBatch Callback function for each batch, may be NULL.
+  \param fnWorker Callback function for each batch when 'fnBatch' is NULL.
+  \param user Pointer passed to every call.
+*/
+static void iterateRange(Mesh const * mesh, uint32_t first, uint32_t end, uint32_t worker, batchIterator fnBatch, workerIterator fnWorker, void * user) {
+  LineBatch batch;
+  uint32_t line;
+  for (line = first; line < end; line += LINE_BATCH) {
+    uint32_t count = end - line < LINE_BATCH ? end - line : LINE_BATCH;
+    if (mesh->indices.width == Index16) {
+      FILL_BATCH(mesh->vertices.vertices, mesh->indices.indices + (size_t)line * 2, count, &batch);
+    } else {
+      FILL_BATCH(mesh->vertices.vertices, mesh->indices.indices32 + (size_t)line * 2, count, &batch);
+    }
+    batch.offset = line;
+    if (fnBatch) {
+      fnBatch(&batch, user);
+    } else {
+      fnWorker(worker, &batch, user);
+    }
+  }
+}
+
+/*! \struct LineWorker
+  \brief State of one worker of 'iterateLinesParallel'.
+*/
+typedef struct LineWorker {
+  Mesh const * mesh;                              //!< Mesh to iterate.
+  uint32_t id;                                    //!< Worker id.
+  uint32_t first;                                 //!< First line of the worker.
+  uint32_t end;                                   //!< End of the lines of the worker.
+  workerIterator fnIterator;                      //!< Callback function.
+  void * user;                                    //!< Pointer passed to the callback function.
+} LineWorker;
+
+/*! \brief Thread running a worker of 'iterateLinesParallel'.
+  \param arg Pointer to LineWorker.
+  \return NULL.
+*/
+static void * runLineWorker(void * arg) {
+  LineWorker * worker = (LineWorker *)arg;
+  iterateRange(worker->mesh, worker->first, worker->end, worker->id, NULL, worker->fnIterator, worker->user);
+  return NULL;
+}
+
+enum codes iterateLineBatches(Mesh const * mesh, batchIterator fnIterator, void * user) {
+  // fail on NULL pointers
+  if (!mesh || !fnIterator) {
+    return NullPointer;
+  }
+  iterateRange(mesh, 0, mesh->indices.size / 2, 0, fnIterator, NULL, user);
+  return Success;
+}
+
+void getLineRange(uint32_t lines, uint32_t workers, uint32_t worker, uint32_t * first, uint32_t * count) {
+  // the first 'lines % workers' workers take one line more
+  uint32_t size = lines / workers;
+  uint32_t rest = lines % workers;
+  *first = worker * size + (worker < rest ? worker : rest);
+  *count = size + (worker < rest);
+}
+
+enum codes iterateLinesParallel(Mesh const * mesh, uint32_t workers, workerIterator fnIterator, void * user) {
+  // fail on NULL pointers
+  if (!mesh || !fnIterator) {
+    return NullPointer;
+  }
+  // fail on no workers
+  if (!workers) {
+    return InvalidParam;
   }
+  LineWorker * states = (LineWorker *)malloc(sizeof(LineWorker) * workers);
+  pthread_t * threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+  int8_t * started = (int8_t *)calloc(workers, sizeof(int8_t));
+  // fail on malloc failure
+  if (!states || !threads || !started) {
+    free(states);
+    free(threads);
+    free(started);
+    return MemAlloc;
+  }
+
+  uint32_t i, lines = mesh->indices.size / 2;
+  for (i = 0; i < workers; ++i) {
+    uint32_t count;
+    getLineRange(lines, workers, i, &states[i].first, &count);
+    states[i].mesh = mesh;
+    states[i].id = i;
+    states[i].end = states[i].first + count;
+    states[i].fnIterator = fnIterator;
+    states[i].user = user;
+  }
+  // workers without lines are not started
+  for (i = 1; i < workers; ++i) {
+    if (states[i].first < states[i].end) {
+      started[i] = !pthread_create(&threads[i], NULL, runLineWorker, &states[i]);
+    }
+  }
+  runLineWorker(&states[0]);
+  for (i = 1; i < workers; ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    } else {
+      runLineWorker(&states[i]);
+    }
+  }
+
+  free(states);
+  free(threads);
+  free(started);
   return Success;
 }
@@ -34,6 +34,28 @@
 typedef uint16_t Color;                           //!< Define 'color' type.
 
 
+// ----------------- Enums -------------------------------------------------------------------------
+
+/*! \enum Kernel
+  \brief Implementations of the vectorized kernels.
+*/
+enum Kernel {
+  KAuto,                                          //!< Fastest implementation supported by the processor.
+  KScalar,                                        //!< Plain C, the reference of the other implementations.
+  KSSE,                                           //!< SSE, 4 floats at a time.
+  KAVX,                                           //!< AVX, 8 floats at a time.
+};
+
+/*! \enum IndexWidth
+  \brief Storage width of indices in an index buffer.
+  16 bit indices address up to 65536 vertices at half the memory and bandwidth of 32 bit indices.
+*/
+enum IndexWidth {
+  Index16,                                        //!< Indices are stored as uint16_t in 'indices'.
+  Index32,                                        //!< Indices are stored as uint32_t in 'indices32'.
+};
+
+
 // ----------------- Structs -----------------------------------------------------------------------
 
 /*! \struct Vector
@@ -44,6 +66,14 @@ typedef struct Vector {
   float x, y, z;                                //!< Coordinate.
 } Vector;
 
+/*! \struct Matrix4
+  \brief Datatype of 4x4 matrix.
+  Elements are stored row by row, a vector is transformed as column vector: v' = M * v.
+*/
+typedef struct Matrix4 {
+  float m[16];                                    //!< Element (row, column) is at m[row * 4 + column].
+} Matrix4;
+
 /*! \struct Vertex
   \brief Vertex datatype.
   Vertex with components: coord, color.
@@ -59,19 +89,26 @@ typedef struct Vertex {
 */
 typedef struct VertexBuffer {
   Vertex * vertices;                              //!< Vertices in buffer.
-  uint16_t size;                                  //!< Amount of vertices in buffer.
+  uint32_t size;                                  //!< Amount of vertices in buffer.
 } VertexBuffer;
 
 /*! \struct IndexBuffer
   \brief Index buffer datastruct.
   Index buffer containing all indices of a mesh.
   Every line is determined by the indices at an even index and following odd index (2 indices per line).
+  Indices are stored in 16 or 32 bits, as given by 'width'; both pointers share the same storage.
 */
 typedef struct IndexBuffer {
-  uint16_t * indices;                             //!< Indices in buffer.
-  uint16_t size;                                  //!< Amount of indices in buffer. If this isn't an even number, something went horribly wrong and the buffer is corrupt.
+  union {
+    uint16_t * indices;                           //!< Indices in buffer, valid when width is Index16.
+    uint32_t * indices32;                         //!< Indices in buffer, valid when width is Index32.
+  };
+  uint32_t size;                                  //!< Amount of indices in buffer. If this isn't an even number, something went horribly wrong and the buffer is corrupt.
+  enum IndexWidth width;                          //!< Storage width of the indices.
 } IndexBuffer;
 
+typedef struct Topology Topology;                 //!< Faces and edge adjacency, see gtopo.h.
+
 /*! \struct Mesh
   \brief Mesh datatype.
   Mesh type combines a vertex and index buffer, providing a convenient way to keep the two buffers together.
@@ -79,17 +116,168 @@ typedef struct IndexBuffer {
 typedef struct Mesh {
   VertexBuffer vertices;
   IndexBuffer indices;
+  Topology * topology;                            //!< Faces of the mesh, NULL unless loaded with LFTopology.
 } Mesh;
 
 
+#define LINE_BATCH 256                                //!< Maximum amount of lines in a LineBatch.
+
+/*! \struct LineBatch
+  \brief Block of consecutive lines of a mesh.
+  Line i of the batch runs from 'first[i]' to 'second[i]'.
+*/
+typedef struct LineBatch {
+  Vertex const * first[LINE_BATCH];               //!< First vertex of every line.
+  Vertex const * second[LINE_BATCH];              //!< Second vertex of every line.
+  uint32_t count;                                 //!< Amount of lines in the batch.
+  uint32_t offset;                                //!< Position of the first line of the batch in the mesh, in lines.
+} LineBatch;
+
+
 typedef void (*meshIterator)(Vertex const *, Vertex const *); //!< Callback function to iterate through all lines in a mesh.
+typedef void (*batchIterator)(LineBatch const *, void *); //!< Callback function to iterate through all lines in a mesh a batch at a time.
+typedef void (*lineIterator)(Vertex const *, Vertex const *, void *); //!< Callback function of 'forEachLine'.
+typedef void (*workerIterator)(uint32_t, LineBatch const *, void *); //!< Callback function of 'iterateLinesParallel', receives the worker id first.
+
+
+// ----------------- Kernel Functions --------------------------------------------------------------
+
+/*! \brief Selects the kernel implementation.
+  Selects the implementation used by all vectorized functions, allows comparing implementations.
+  Until called the fastest supported implementation is used.
+  \param kernel Implementation to select.
+  \return 1 on success, 0 when the processor does not support the implementation (selection is unchanged).
+*/
+int8_t selectKernel(enum Kernel kernel);
+
+/*! \brief Gets the kernel implementation.
+  \return Implementation used by the vectorized functions, never KAuto.
+*/
+enum Kernel getKernel(void);
 
 
 // ----------------- Vector Functions --------------------------------------------------------------
 
+/*! \brief Adds two vectors.
+  \return a + b.
+*/
+Vector addVector(Vector a, Vector b);
+
+/*! \brief Subtracts two vectors.
+  \return a - b.
+*/
+Vector subtractVector(Vector a, Vector b);
+
+/*! \brief Scales a vector.
+  \return v * factor.
+*/
+Vector scaleVector(Vector v, float factor);
+
+/*! \brief Dot product.
+  \return a . b.
+*/
+float dotVector(Vector a, Vector b);
+
+/*! \brief Cross product.
+  \return a x b.
+*/
+Vector crossVector(Vector a, Vector b);
+
+/*! \brief Length of a vector.
+  \return |v|.
+*/
+float lengthVector(Vector v);
+
+/*! \brief Normalizes a vector.
+  \return v / |v|, or v when its length is 0.
+*/
+Vector normalizeVector(Vector v);
+
+/*! \brief Transforms a point.
+  Transforms (v, 1) by 'matrix' and divides by the resulting w (perspective divide).
+  This is the scalar reference of 'transformVertexBuffer'.
+  \param matrix Pointer to transformation.
+  \param v Point to transform.
+  \return Transformed point.
+*/
+Vector transformVector(Matrix4 const * matrix, Vector v);
+
+
+// ----------------- Matrix Functions --------------------------------------------------------------
+
+/*! \brief Identity matrix.
+  \param out Pointer to receive the matrix.
+*/
+void identityMatrix(Matrix4 * out);
+
+/*! \brief Multiplies matrices.
+  The result first applies 'b', then 'a'. 'out' may be 'a' or 'b'.
+  \param a Pointer to left matrix.
+  \param b Pointer to right matrix.
+  \param out Pointer to receive a * b.
+*/
+void multiplyMatrix(Matrix4 const * a, Matrix4 const * b, Matrix4 * out);
+
+/*! \brief Translation matrix.
+  \param offset Translation.
+  \param out Pointer to receive the matrix.
+*/
+void translationMatrix(Vector offset, Matrix4 * out);
+
+/*! \brief Scale matrix.
+  \param factors Scale along each axis.
+  \param out Pointer to receive the matrix.
+*/
+void scaleMatrix(Vector factors, Matrix4 * out);
+
+/*! \brief Rotation matrix.
+  Rotates counter clockwise around 'axis' when looking against the axis.
+  \param axis Axis of rotation, does not have to be normalized.
+  \param angle Angle in radians.
+  \param out Pointer to receive the matrix.
+*/
+void rotationMatrix(Vector axis, float angle, Matrix4 * out);
+
+/*! \brief View matrix.
+  Places the camera at 'eye' looking at 'target', the camera looks along its negative z axis.
+  \param eye Position of the camera.
+  \param target Point the camera looks at.
+  \param up Up direction of the camera.
+  \param out Pointer to receive the matrix.
+*/
+void lookAtMatrix(Vector eye, Vector target, Vector up, Matrix4 * out);
+
+/*! \brief Perspective projection matrix.
+  Maps the view frustum to normalized device coordinates, -1 to 1 on every axis after the perspective divide.
+  \param fovy Vertical field of view in radians.
+  \param aspect Width divided by height.
+  \param near Distance to the near plane, larger than 0.
+  \param far Distance to the far plane, larger than 'near'.
+  \param out Pointer to receive the matrix.
+*/
+void perspectiveMatrix(float fovy, float aspect, float near, float far, Matrix4 * out);
+
+/*! \brief Viewport matrix.
+  Maps normalized device coordinates to screen coordinates: x from 0 to 'width', y from 0 (top) to 'height' (bottom), z from 0 to 1.
+  Applied after a projection (viewport * projection * view * model) it commutes with the perspective divide,
+  so 'transformVertexBuffer' outputs screen coordinates directly.
+  \param width Width of the screen in pixels.
+  \param height Height of the screen in pixels.
+  \param out Pointer to receive the matrix.
+*/
+void viewportMatrix(float width, float height, Matrix4 * out);
+
 
 // ----------------- Vertex Functions --------------------------------------------------------------
 
+/*! \brief Transforms a vertex.
+  Transforms the coordinate like 'transformVector', the color is copied.
+  \param matrix Pointer to transformation.
+  \param in Pointer to vertex to transform.
+  \param out Pointer to receive the transformed vertex, may be 'in'.
+*/
+void transformVertex(Matrix4 const * matrix, Vertex const * in, Vertex * out);
+
 
 // ----------------- VertexBuffer Functions --------------------------------------------------------
 
@@ -100,7 +288,7 @@ typedef void (*meshIterator)(Vertex const *, Vertex const *); //!< Callback func
   \return Result code.
   \see codes
 */
-enum codes initVertexBuffer(uint16_t size, VertexBuffer * vb);
+enum codes initVertexBuffer(uint32_t size, VertexBuffer * vb);
 
 /*! \brief Gets a vertex.
   Returns a pointer to the vertex at given index.
@@ -108,7 +296,20 @@ enum codes initVertexBuffer(uint16_t size, VertexBuffer * vb);
   \param vb Pointer to vertex buffer.
   \return Pointer to vertex.
 */
-Vertex * getVertex(uint16_t index, VertexBuffer * vb);
+Vertex * getVertex(uint32_t index, VertexBuffer * vb);
+
+/*! \brief Transforms a vertex buffer.
+  Transforms every coordinate by 'matrix' followed by the perspective divide, colors are copied.
+  With a viewport * projection * view * model matrix the result is in screen coordinates, ready for line drawing.
+  Points with w <= 0 (at or behind the eye) do not have a meaningful result, they must be clipped before the divide.
+  Uses the kernel selected by 'selectKernel', every implementation gives the same result as 'transformVector'.
+  \param matrix Pointer to transformation.
+  \param in Pointer to vertex buffer to transform.
+  \param out Pointer to vertex buffer receiving the result, must hold at least 'in->size' vertices, may be 'in'.
+  \return Result code.
+  \see codes
+*/
+enum codes transformVertexBuffer(Matrix4 const * matrix, VertexBuffer const * in, VertexBuffer * out);
 
 
 // ----------------- IndexBuffer Functions --------------------------------------------------------
@@ -117,11 +318,44 @@ Vertex * getVertex(uint16_t index, VertexBuffer * vb);
   Initializes an index buffer for specified amount of lines.
   Be aware that every line requires 2 indices, resulting in a buffer that is twice the given size!
   \param lines Amount of lines that will fit in the buffer.
+  \param width Storage width of the indices.
   \param ib Pointer to index buffer to initialize.
   \return Result code.
   \see codes
 */
-enum codes initIndexBuffer(uint16_t lines, IndexBuffer * ib);
+enum codes initIndexBuffer(uint32_t lines, enum IndexWidth width, IndexBuffer * ib);
+
+/*! \brief Gets an index.
+  Returns the index at given position, regardless of the storage width.
+  Loops over many indices should branch on the width once instead, see 'iterateLines'.
+  \param position Zero based position in the buffer.
+  \param ib Pointer to index buffer.
+  \return Index.
+*/
+static inline uint32_t getIndex(uint32_t position, IndexBuffer const * ib) {
+  return ib->width == Index16 ? ib->indices[position] : ib->indices32[position];
+}
+
+/*! \brief Narrows an index buffer.
+  Converts a 32 bit buffer to 16 bit in place when all 'vertices' can be addressed by 16 bits, then shrinks the storage.
+  Buffers that are already 16 bit or address too many vertices are left unchanged.
+  Every index must be below 'vertices', which is asserted.
+  \param vertices Amount of vertices the indices refer to.
+  \param ib Pointer to index buffer.
+  \return Result code.
+  \see codes
+*/
+enum codes narrowIndexBuffer(uint32_t vertices, IndexBuffer * ib);
+
+/*! \brief Removes duplicate lines.
+  Lines are undirected, (a, b) and (b, a) are the same line. Only the first occurrence of every line is kept, the order of the kept lines is unchanged.
+  Duplicates are found with a hash set on the (min, max) index pair, so the cost is linear in the amount of lines.
+  The buffer is shrunk to the remaining lines.
+  \param ib Pointer to index buffer.
+  \return Result code.
+  \see codes
+*/
+enum codes dedupLines(IndexBuffer * ib);
 
 
 // ----------------- Mesh Functions ----------------------------------------------------------------
@@ -135,5 +369,66 @@ enum codes initIndexBuffer(uint16_t lines, IndexBuffer * ib);
 */
 enum codes iterateLines(Mesh const * mesh, meshIterator fnIterator);
 
+/*! \brief Iterates through all lines a batch at a time.
+  Calls 'fnIterator' for every LINE_BATCH lines found in the given mesh (the last batch can be smaller), in mesh order.
+  One call per batch instead of one per line, the consumer can loop over the batch without calls in between.
+  The batch is only valid during the call.
+  \param mesh Pointer to mesh.
+  \param fnIterator Callback function for each batch.
+  \param user Pointer passed to every call of 'fnIterator'.
+  \return Result code.
+  \see codes
+*/
+enum codes iterateLineBatches(Mesh const * mesh, batchIterator fnIterator, void * user);
+
+/*! \brief Gets the lines of a worker.
+  Splits 'lines' in 'workers' contiguous ranges of (nearly) equal size, in order of worker id.
+  The split only depends on the arguments, so results kept per worker can be merged in mesh order.
+  \param lines Amount of lines.
+  \param workers Amount of workers.
+  \param worker Id of the worker, less than 'workers'.
+  \param first Pointer to receive the first line of the worker.
+  \param count Pointer to receive the amount of lines of the worker, can be 0.
+*/
+void getLineRange(uint32_t lines, uint32_t workers, uint32_t worker, uint32_t * first, uint32_t * count);
+
+/*! \brief Iterates through all lines using multiple threads.
+  Splits the lines with 'getLineRange' and starts a worker per range, worker 0 runs on the calling thread.
+  Each worker calls 'fnIterator' with its id and a batch at a time like 'iterateLineBatches', in mesh order within its range.
+  Workers run concurrently, a consumer keeps output per worker id to avoid locking. 'LineBatch.offset' is the line position in the mesh.
+  When a thread can not be started its range is iterated by the calling thread, with the same worker id.
+  \param mesh Pointer to mesh.
+  \param workers Amount of workers, at least 1.
+  \param fnIterator Callback function for each batch.
+  \param user Pointer passed to every call of 'fnIterator'.
+  \return Result code.
+  \see codes
+*/
+enum codes iterateLinesParallel(Mesh const * mesh, uint32_t workers, workerIterator fnIterator, void * user);
+
+/*! \brief Iterates through all lines, inlined.
+  Same as 'iterateLines', but expanded at the call site. When 'fnIterator' is a function known at the call site the compiler can
+  inline it into the loop, removing the call per line altogether. Meant for hot consumers, others should use 'iterateLineBatches'.
+  \param mesh Pointer to mesh, must not be NULL.
+  \param fnIterator Callback function for each line.
+  \param user Pointer passed to every call of 'fnIterator'.
+*/
+__attribute__((always_inline))
+static inline void forEachLine(Mesh const * mesh, lineIterator fnIterator, void * user) {
+  Vertex const * vertices = mesh->vertices.vertices;
+  uint32_t i;
+  if (mesh->indices.width == Index16) {
+    uint16_t const * indices = mesh->indices.indices;
+    for (i = 0; (i + 1) < mesh->indices.size; i += 2) {
+      fnIterator(&vertices[indices[i]], &vertices[indices[i + 1]], user);
+    }
+  } else {
+    uint32_t const * indices = mesh->indices.indices32;
+    for (i = 0; (i + 1) < mesh->indices.size; i += 2) {
+      fnIterator(&vertices[indices[i]], &vertices[indices[i + 1]], user);
+    }
+  }
+}
+
 
 #endif // GTYPES_H
@@ -3,7 +3,7 @@
 int main(void) {
   Mesh mesh;
 
-  loadWavefront("cube.obj", &mesh);
+  loadWavefront("cube.obj", LFDedupLines, &mesh);
   destroyWavefront(&mesh);
   
   return 0;
@@ -0,0 +1,340 @@
+#include "meshfile.h"
+
+#include "cparser.h"
+#include "parser.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*! \file meshfile.c
+  \brief Binary mesh files.
+  \author cxnf
+  \version 0.1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+
+// ----------------- File format -------------------------------------------------------------------
+
+#define MESH_FILE_MAGIC "WMSH"                    //!< First bytes of every binary mesh.
+#define MESH_FILE_VERSION 1                       //!< Version of the layout below, files of other versions are regenerated.
+#define MESH_FILE_ORDER 0x01020304u               //!< Written in native byte order, files of another byte order are rejected.
+#define MESH_FILE_ALIGN 64                        //!< Alignment of every section, a cache line.
+#define HASH_BASIS 0xCBF29CE484222325ull          //!< FNV-1a 64 bit offset basis.
+#define HASH_PRIME 0x100000001B3ull               //!< FNV-1a 64 bit prime.
+
+/*! \struct MeshFileHeader
+  \brief Header at the start of a binary mesh.
+  Sections follow the header at the given offsets, the file is padded to a multiple of MESH_FILE_ALIGN.
+*/
+typedef struct MeshFileHeader {
+  char magic[4];                                  //!< MESH_FILE_MAGIC.
+  uint32_t version;                               //!< MESH_FILE_VERSION.
+  uint32_t order;                                 //!< MESH_FILE_ORDER.
+  uint32_t headerSize;                            //!< Size of this header.
+  uint32_t vertexStride;                          //!< Size of a vertex, must match sizeof(Vertex).
+  uint32_t vertexCount;                           //!< Amount of vertices.
+  uint32_t indexWidth;                            //!< IndexWidth of the indices.
+  uint32_t indexCount;                            //!< Amount of indices.
+  uint64_t vertexOffset;                          //!< Offset of the vertex section.
+  uint64_t indexOffset;                           //!< Offset of the index section.
+  uint64_t fileSize;                              //!< Size of the whole file.
+  uint64_t checksum;                              //!< Hash of the file, computed with this field set to 0.
+  MeshSource source;                              //!< Source the mesh was generated from.
+} MeshFileHeader;
+
+
+// ----------------- Helpers -----------------------------------------------------------------------
+
+/*! \brief Rounds an offset up to the section alignment.
+  \param offset Offset to align.
+  \return Aligned offset.
+*/
+static inline uint64_t alignOffset(uint64_t offset) {
+  return (offset + MESH_FILE_ALIGN - 1) & ~(uint64_t)(MESH_FILE_ALIGN - 1);
+}
+
+/*! \brief Hashes data.
+  FNV-1a on 64 bit words instead of bytes, the fold after every multiplication lets high bits reach the low bits of the hash.
+  Trailing bytes are hashed one at a time.
+  \param data Data to hash.
+  \param len Length of 'data' in bytes.
+  \param hash Hash of preceding data, HASH_BASIS to start.
+  \return Hash.
+*/
+static uint64_t hashData(void const * data, size_t len, uint64_t hash) {
+  unsigned char const * bytes = (unsigned char const *)data;
+  for (; len >= 8; bytes += 8, len -= 8) {
+    uint64_t word;
+    memcpy(&word, bytes, 8);
+    hash = (hash ^ word) * HASH_PRIME;
+    hash ^= hash >> 32;
+  }
+  for (; len; ++bytes, --len) {
+    hash = (hash ^ *bytes) * HASH_PRIME;
+  }
+  return hash;
+}
+
+/*! \brief Hashes a mapped binary mesh.
+  \param base Start of the file.
+  \param size Size of the file in bytes.
+  \return Hash of the file with the checksum field set to 0.
+*/
+static uint64_t hashMeshFile(void const * base, size_t size) {
+  MeshFileHeader header;
+  memcpy(&header, base, sizeof(header));
+  header.checksum = 0;
+  uint64_t hash = hashData(&header, sizeof(header), HASH_BASIS);
+  return hashData((char const *)base + sizeof(header), size - sizeof(header), hash);
+}
+
+/*! \brief Describes a wavefront file.
+  \param path Path to wavefront file.
+  \param flags LoadFlags the file will be loaded with.
+  \param bHash Set to also hash the contents.
+  \param source Pointer to receive the description.
+  \return Return code.
+*/
+static enum codes describeSource(char const * path, uint32_t flags, int8_t bHash, MeshSource * source) {
+  struct stat st;
+  if (stat(path, &st)) {
+    return Failed;
+  }
+  memset(source, 0, sizeof(MeshSource));
+  source->size = (uint64_t)st.st_size;
+  source->time = (int64_t)st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+  source->flags = flags;
+  if (bHash) {
+    size_t len;
+    char const * data = mapFile(path, &len);
+    if (!data) {
+      return Failed;
+    }
+    source->hash = hashData(data, len, HASH_BASIS);
+    unmapFile(data, len);
+  }
+  return Success;
+}
+
+/*! \brief Writes data followed by zeros up to an offset.
+  \param data Data to write, may be NULL when 'len' is 0.
+  \param len Length of 'data' in bytes.
+  \param offset Offset the file should be at after writing, not less than its current offset plus 'len'.
+  \param fp File to write to.
+  \param hash Pointer to running hash of the written bytes.
+  \return 1 on success, else 0.
+*/
+static int8_t writeSection(void const * data, size_t len, uint64_t offset, FILE * fp, uint64_t * hash) {
+  size_t whole = len & ~(size_t)7;
+  if (whole && fwrite(data, 1, whole, fp) != whole) {
+    return 0;
+  }
+  *hash = hashData(data, whole, *hash);
+  // trailing bytes are written together with the padding, so the hash sees the same words as a hash over the whole file
+  char tail[2 * MESH_FILE_ALIGN] = { 0 };
+  size_t rest = (size_t)(offset - (uint64_t)ftell(fp));
+  if (len > whole) {
+    memcpy(tail, (char const *)data + whole, len - whole);
+  }
+  if (rest && fwrite(tail, 1, rest, fp) != rest) {
+    return 0;
+  }
+  *hash = hashData(tail, rest, *hash);
+  return 1;
+}
+
+
+// ----------------- Functions ---------------------------------------------------------------------
+
+enum codes writeMeshFile(char const * path, Mesh const * mesh, MeshSource const * source) {
+  if (!path || !mesh || (!mesh->vertices.vertices && mesh->vertices.size) || (!mesh->indices.indices && mesh->indices.size)) {
+    return NullPointer;
+  }
+
+  size_t indexSize = mesh->indices.width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  MeshFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+  header.version = MESH_FILE_VERSION;
+  header.order = MESH_FILE_ORDER;
+  header.headerSize = sizeof(header);
+  header.vertexStride = sizeof(Vertex);
+  header.vertexCount = mesh->vertices.size;
+  header.indexWidth = mesh->indices.width;
+  header.indexCount = mesh->indices.size;
+  header.vertexOffset = alignOffset(sizeof(header));
+  header.indexOffset = alignOffset(header.vertexOffset + (uint64_t)sizeof(Vertex) * header.vertexCount);
+  header.fileSize = alignOffset(header.indexOffset + (uint64_t)indexSize * header.indexCount);
+  if (source) {
+    header.source = *source;
+  }
+
+  // written under a temporary name, a reader either sees the old file or the complete new one
+  size_t len = strlen(path);
+  char * temp = (char *)malloc(len + 5);
+  if (!temp) {
+    return MemAlloc;
+  }
+  memcpy(temp, path, len);
+  memcpy(temp + len, ".tmp", 5);
+  FILE * fp = fopen(temp, "wb");
+  if (!fp) {
+    free(temp);
+    return Failed;
+  }
+
+  // checksum is written last, so the header is written twice
+  uint64_t hash = HASH_BASIS;
+  int8_t ok = writeSection(&header, sizeof(header), header.vertexOffset, fp, &hash)
+    && writeSection(mesh->vertices.vertices, sizeof(Vertex) * header.vertexCount, header.indexOffset, fp, &hash)
+    && writeSection(mesh->indices.indices, indexSize * header.indexCount, header.fileSize, fp, &hash);
+  header.checksum = hash;
+  ok = ok && !fseek(fp, 0, SEEK_SET) && fwrite(&header, sizeof(header), 1, fp) == 1;
+  ok = !fclose(fp) && ok;
+  ok = ok && !rename(temp, path);
+  if (!ok) {
+    unlink(temp);
+  }
+  free(temp);
+  return ok ? Success : Failed;
+}
+
+enum codes loadMeshFile(char const * path, Mesh * mesh, MeshFile * file, MeshSource * source) {
+  if (!path || !mesh || !file) {
+    return NullPointer;
+  }
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return Failed;
+  }
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return Failed;
+  }
+  size_t size = (size_t)st.st_size;
+  if (size < sizeof(MeshFileHeader)) {
+    close(fd);
+    return InvalidBuffer;
+  }
+  // private and writable, the mesh can be modified like a loaded one without touching the file
+  void * base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return Failed;
+  }
+
+  MeshFileHeader header;
+  memcpy(&header, base, sizeof(header));
+  uint64_t indexSize = header.indexWidth == Index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  int8_t valid = !memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic))
+    && header.version == MESH_FILE_VERSION
+    && header.order == MESH_FILE_ORDER
+    && header.headerSize == sizeof(header)
+    && header.vertexStride == sizeof(Vertex)
+    && (header.indexWidth == Index16 || header.indexWidth == Index32)
+    && header.indexCount % 2 == 0
+    && header.fileSize == size
+    && header.vertexOffset == alignOffset(sizeof(header))
+    && header.indexOffset == alignOffset(header.vertexOffset + (uint64_t)sizeof(Vertex) * header.vertexCount)
+    && header.fileSize == alignOffset(header.indexOffset + indexSize * header.indexCount)
+    && header.checksum == hashMeshFile(base, size);
+  if (!valid) {
+    munmap(base, size);
+    return InvalidBuffer;
+  }
+
+  file->base = base;
+  file->size = size;
+  mesh->vertices.vertices = header.vertexCount ? (Vertex *)((char *)base + header.vertexOffset) : NULL;
+  mesh->vertices.size = header.vertexCount;
+  mesh->indices.indices = header.indexCount ? (uint16_t *)((char *)base + header.indexOffset) : NULL;
+  mesh->indices.size = header.indexCount;
+  mesh->indices.width = (enum IndexWidth)header.indexWidth;
+  mesh->topology = NULL;
+  if (source) {
+    *source = header.source;
+  }
+  return Success;
+}
+
+enum codes loadWavefrontCached(char const * path, char const * cachePath, uint32_t flags, Mesh * mesh, MeshFile * file) {
+  if (!path || !cachePath || !mesh || !file) {
+    return NullPointer;
+  }
+  // a mesh file holds no faces, a load that keeps them is never cached
+  if (flags & LFTopology) {
+    file->base = NULL;
+    file->size = 0;
+    return loadWavefront(path, flags, mesh);
+  }
+
+  MeshSource current;
+  enum codes result = describeSource(path, flags, 0, &current);
+  if (result != Success) {
+    return result;
+  }
+
+  MeshSource cached;
+  if (loadMeshFile(cachePath, mesh, file, &cached) == Success) {
+    if (cached.size == current.size && cached.flags == current.flags) {
+      // a touched but unchanged source (checkout, copy) only costs a hash instead of a parse
+      if (cached.time == current.time) {
+        return Success;
+      }
+      if (describeSource(path, flags, 1, &current) == Success && cached.hash == current.hash) {
+        // store the new time, so the next load does not hash again
+        writeMeshFile(cachePath, mesh, &current);
+        return Success;
+      }
+    }
+    closeMeshFile(file, mesh);
+  }
+
+  // stale or missing, the time is taken before loading so a change during the load is seen next time
+  result = describeSource(path, flags, 1, &current);
+  if (result != Success) {
+    return result;
+  }
+  result = loadWavefront(path, flags, mesh);
+  if (result != Success) {
+    return result;
+  }
+  file->base = NULL;
+  file->size = 0;
+  if (writeMeshFile(cachePath, mesh, &current) != Success) {
+    return Success;
+  }
+  // serve from the new file, so the mesh is released the same way whether the cache was hit or not
+  MeshFile written;
+  Mesh mapped;
+  if (loadMeshFile(cachePath, &mapped, &written, NULL) == Success) {
+    destroyWavefront(mesh);
+    *mesh = mapped;
+    *file = written;
+  }
+  return Success;
+}
+
+enum codes closeMeshFile(MeshFile * file, Mesh * mesh) {
+  if (!file || !mesh) {
+    return NullPointer;
+  }
+  if (!file->base) {
+    return destroyWavefront(mesh);
+  }
+  munmap(file->base, file->size);
+  file->base = NULL;
+  file->size = 0;
+  mesh->vertices.vertices = NULL;
+  mesh->vertices.size = 0;
+  mesh->indices.indices = NULL;
+  mesh->indices.size = 0;
+  return Success;
+}
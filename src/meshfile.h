@@ -0,0 +1,80 @@
+#pragma once
+
+/*! \file meshfile.h
+  \brief Binary mesh files.
+  \author cxnf
+  \version 0.1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include "gtypes.h"                               // Declarations of graphics types.
+#include "codes.h"                                // Definitions of all return codes.
+#include <stddef.h>
+#include <stdint.h>
+
+/*! \struct MeshSource
+  \brief Description of the text a binary mesh was generated from.
+  Stored in the binary mesh, the cache compares it with the current source to find out if the binary mesh is stale.
+*/
+typedef struct MeshSource {
+  uint64_t size;                                  //!< Size of the source in bytes.
+  int64_t time;                                   //!< Modification time of the source in nanoseconds since the epoch.
+  uint64_t hash;                                  //!< Hash of the source contents.
+  uint32_t flags;                                 //!< LoadFlags the source was loaded with.
+} MeshSource;
+
+/*! \struct MeshFile
+  \brief Mapping of a binary mesh.
+  A mesh loaded from a binary mesh points into the mapping, it stays valid until the mapping is released by 'closeMeshFile'.
+*/
+typedef struct MeshFile {
+  void * base;                                    //!< Start of the mapping, NULL when the mesh owns its buffers.
+  size_t size;                                    //!< Size of the mapping in bytes.
+} MeshFile;
+
+/*! \brief Writes a binary mesh.
+  Writes 'mesh' to 'path' in the binary mesh format: a versioned header followed by the vertex and index sections, each aligned to 64 bytes.
+  A checksum over header and sections is stored in the header.
+  The file is written next to 'path' and renamed over it when complete, so readers never see a partial file.
+  \param path Path of the binary mesh.
+  \param mesh Pointer to mesh to write.
+  \param source Description of the source of the mesh, may be NULL.
+  \return Return code.
+*/
+enum codes writeMeshFile(char const * path, Mesh const * mesh, MeshSource const * source);
+
+/*! \brief Loads a binary mesh.
+  Maps 'path' and points the buffers of 'mesh' straight into the mapping, no data is copied.
+  The mapping is private, changes made to the mesh are not written back to the file.
+  Header, section bounds and checksum are verified before the mesh is set.
+  \param path Path of the binary mesh.
+  \param mesh Pointer to resulting mesh, should be allocated, vertex and index buffer should not be allocated.
+  \param file Pointer to receive the mapping, release it with 'closeMeshFile'.
+  \param source Pointer to receive the description of the source of the mesh, may be NULL.
+  \return Return code, InvalidBuffer when the file is not a valid binary mesh.
+*/
+enum codes loadMeshFile(char const * path, Mesh * mesh, MeshFile * file, MeshSource * source);
+
+/*! \brief Loads a wavefront through a binary mesh cache.
+  Loads 'cachePath' when it was generated from the current contents of 'path' with the same 'flags'.
+  Otherwise 'path' is loaded by 'loadWavefront' and written to 'cachePath' first.
+  A cache with a different modification time is still used when size and hash of the source match.
+  When the cache can not be written the mesh is returned as loaded from text.
+  Binary meshes hold no faces, a load with LFTopology always loads from text and leaves the cache alone.
+  \param path Path to wavefront file.
+  \param cachePath Path of the binary mesh.
+  \param flags Combination of LoadFlags.
+  \param mesh Pointer to resulting mesh, should be allocated, vertex and index buffer should not be allocated.
+  \param file Pointer to receive the mapping, release mesh and mapping with 'closeMeshFile'.
+  \return Return code.
+*/
+enum codes loadWavefrontCached(char const * path, char const * cachePath, uint32_t flags, Mesh * mesh, MeshFile * file);
+
+/*! \brief Releases a mesh loaded by 'loadMeshFile' or 'loadWavefrontCached'.
+  Unmaps the binary mesh, or frees the buffers when the mesh was loaded from text.
+  \param file Pointer to mapping.
+  \param mesh Pointer to mesh.
+  \return Return code.
+*/
+enum codes closeMeshFile(MeshFile * file, Mesh * mesh);
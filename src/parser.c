@@ -1,12 +1,17 @@
 #include "parser.h"
 
+#include "carray.h"
 #include "clist.h"
+#include "cnumber.h"
 #include "cparser.h"
+#include "gtopo.h"
+#include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /*! \file parser.c
   \brief Wavefront obj parser.
@@ -29,106 +34,172 @@ enum Command {
 typedef struct Context {
   uint8_t counter;                                //!< Counts processed numbers after a command.
   enum Command state;                             //!< Current command state.
-  List * verts;                                   //!< List of parsed vertices.
-  List * inds;                                    //!< List of parsed faces.
-  void * data;                                    //!< Working object. Can be vertex or face.
+  int8_t failed;                                  //!< Set when memory could not be allocated.
+  int8_t invalid;                                 //!< Set when a face refers to a vertex that is not defined before it.
+  int8_t fixed;                                   //!< Set when vertices are parsed to VertexFixed instead of Vertex.
+  int8_t topology;                                //!< Set when faces are kept, see LFTopology.
+  uint32_t base;                                  //!< Vertices preceding the parsed text, relative indices are resolved against it.
+  Array verts;                                    //!< Parsed vertices, the last one is the working vertex while parsing a vertex.
+  VertexBufferSoA * soa;                          //!< Receives the vertices instead of 'verts' when set, see 'loadWavefrontSoA'.
+  Array inds;                                     //!< Parsed line indices, always 32 bit until the load finishes.
+  List * face;                                    //!< Indices plus one of the face being parsed, pooled so clearing it per face frees nothing.
+  Array faceStart;                                //!< Position in 'faceIndices' of every kept face.
+  Array faceIndices;                              //!< Indices of all kept faces.
 } Context;
 
-Context context;
+#define PARSED_VERTICES(context) ((context)->soa ? (context)->soa->size : (context)->verts.uiSize) //!< Vertices parsed so far.
+#define FACE_INDEX(iterator) ((uint32_t)((uintptr_t)getCurrent(iterator) - 1)) //!< Index held by an entry of 'Context.face'.
+
+// ----------------- Token helpers -----------------------------------------------------------------
+
+/*! \brief Compares a token with a string.
+  \param token Token to compare.
+  \param text Zero terminated string.
+  \return 1 if equal, else 0.
+*/
+static inline int8_t isToken(Token token, char const * text) {
+  return strlen(text) == token.length && !memcmp(token.text, text, token.length);
+}
 
 // ----------------- cparser callback --------------------------------------------------------------
 
-void parseLine(void) {
-  switch (context.state) {
-  case CmdFace:
-    if (context.counter < 2) {
-      free(context.data);
+void parseLine(Context * context) {
+  switch (context->state) {
+  case CmdFace: {
+    uint32_t size = getSize(context->face);
+    if (size < 2) {
       break;
     }
-    int i;
-    for (i = 1; i < context.counter; ++i) {
-      addEntry(context.inds, getEnd(context.inds), (void *)((uint16_t *)context.data)[i - 1]);
-      addEntry(context.inds, getEnd(context.inds), (void *)((uint16_t *)context.data)[i]);
+    // ARRAY_PUSH grows geometrically, reserving the exact size here would reallocate for every face
+    int8_t ok = 1;
+    Iterator * iterator = getBegin(context->face);
+    uint32_t first = FACE_INDEX(iterator);
+    uint32_t previous = first;
+    // 'moveNext' moves past the last entry to NULL
+    for (moveNext(&iterator); ok && iterator; moveNext(&iterator)) {
+      uint32_t index = FACE_INDEX(iterator);
+      ok = ARRAY_PUSH(&context->inds, uint32_t, previous) && ARRAY_PUSH(&context->inds, uint32_t, index);
+      previous = index;
+    }
+    // close polygon, a face of 2 indices is a single line
+    if (size > 2 && ok) {
+      ok = ARRAY_PUSH(&context->inds, uint32_t, previous) && ARRAY_PUSH(&context->inds, uint32_t, first);
+    }
+    // an edge shared by two faces is emitted by both, LFDedupLines removes the second one after loading
+    // polygons are kept as they are for the topology, a face of 2 indices has no side to cull by
+    if (size > 2 && ok && context->topology) {
+      ok = ARRAY_PUSH(&context->faceStart, uint32_t, context->faceIndices.uiSize);
+      for (iterator = getBegin(context->face); ok && iterator; moveNext(&iterator)) {
+        ok = ARRAY_PUSH(&context->faceIndices, uint32_t, FACE_INDEX(iterator));
+      }
+    }
+    if (!ok) {
+      context->failed = 1;
     }
-    addEntry(context.inds, getEnd(context.inds), (void *)((uint16_t *)context.data)[i]);
-    addEntry(context.inds, getEnd(context.inds), (void *)((uint16_t *)context.data)[0]);
-    //TODO: clean dubble lines, where each line is undirected
-    free(context.data);
+  }
     break;
     
   case CmdVertex:
-    if (context.counter != 3 && context.counter != 4) {
-      printf("Vertex has not enough components: %d\n", context.counter);
-      free(context.data);
-      break;
+    if (context->counter != 3 && context->counter != 4) {
+      printf("Vertex has not enough components: %d\n", context->counter);
+      if (context->soa) {
+	--context->soa->size;
+      } else {
+	popArray(&context->verts);
+      }
     }
-    addEntry(context.verts, getEnd(context.verts), context.data);
-    context.data = NULL;
     break;
     
   default: break;
   }
 
-  context.counter = 0;
-  context.state = CmdNone;
+  context->counter = 0;
+  context->state = CmdNone;
 }
 
-void parseText(Token token) {
-  if (!token) {
-    return;
-  }
-
-  if (strlen(token) > 0) {
-    switch (context.state) {
+void parseText(Context * context, Token token) {
+  if (token.length > 0) {
+    switch (context->state) {
     case CmdWait:
       return;
 
     case CmdNone:
-      if (!strcmp(token, "v")) {
-	context.state = CmdVertex;
-	context.data = (Vertex *)malloc(sizeof(Vertex));
-	memset(context.data, 0, sizeof(Vertex));
-      } else if (!strcmp(token, "f")) {
-	context.state = CmdFace;
-	context.data = (uint16_t *)malloc(sizeof(uint16_t) * 4);
-	memset(context.data, 0, sizeof(uint16_t) * 4);
+      if (isToken(token, "v")) {
+	// vertex is parsed in place, it is removed again when the line turns out to be invalid
+	context->state = CmdVertex;
+	if (context->soa) {
+	  // the arrays are sized by counting the vertex records, a record the count missed takes the convert after load path
+	  VertexBufferSoA * soa = context->soa;
+	  if (soa->size == soa->capacity) {
+	    context->invalid = 1;
+	    context->state = CmdWait;
+	    break;
+	  }
+	  soa->x[soa->size] = soa->y[soa->size] = soa->z[soa->size] = 0.0f;
+	  soa->color[soa->size++] = 0;
+	  break;
+	}
+	Vertex * vertex = (Vertex *)pushArray(&context->verts, NULL);
+	if (!vertex) {
+	  context->failed = 1;
+	  context->state = CmdWait;
+	  break;
+	}
+	memset(vertex, 0, context->verts.uiStride);
+      } else if (isToken(token, "f")) {
+	context->state = CmdFace;
+	clearList(context->face);
       } else {
-	printf("|%s|:skipped\n", token);
+	printf("|%.*s|:skipped\n", (int)token.length, token.text);
       }
       break;
 
     case CmdVertex:
     case CmdFace:
-      printf("|%s|:invalid\n", token);
+      printf("|%.*s|:invalid\n", (int)token.length, token.text);
       break;
 
     default:
-      printf("|%s|:ignored\n", token);
-      context.state = CmdWait;
+      printf("|%.*s|:ignored\n", (int)token.length, token.text);
+      context->state = CmdWait;
       break;
     }
   }
 }
 
-void parseNumber(Token token) {
-  if (!token) {
-    return;
-  }
-
-  if (strlen(token) > 0) {
-    switch (context.state) {
+void parseNumber(Context * context, Token token) {
+  if (token.length > 0) {
+    switch (context->state) {
     case CmdVertex: {
-      switch (context.counter) {
+      if (context->fixed) {
+	// converted straight from text, a fixed point load never touches a float
+	VertexFixed * vertex = &ARRAY_AT(&context->verts, VertexFixed, context->verts.uiSize - 1);
+	Fixed * component = context->counter == 0 ? &vertex->coord.x : context->counter == 1 ? &vertex->coord.y : context->counter == 2 ? &vertex->coord.z : NULL;
+	if (component && !readFixed(token.text, token.length, component)) {
+	  printf("|%.*s|:out of range\n", (int)token.length, token.text);
+	}
+	break;
+      }
+      if (context->soa) {
+	VertexBufferSoA * soa = context->soa;
+	float * component = context->counter == 0 ? &soa->x[soa->size - 1] : context->counter == 1 ? &soa->y[soa->size - 1] : context->counter == 2 ? &soa->z[soa->size - 1] : NULL;
+	if (component) {
+	  readFloat(token.text, token.length, component);
+	}
+	break;
+      }
+      Vertex * vertex = &ARRAY_AT(&context->verts, Vertex, context->verts.uiSize - 1);
+      switch (context->counter) {
       case 0:
-	((Vertex *)context.data)->coord.x = atof(token);
+	readFloat(token.text, token.length, &vertex->coord.x);
 	break;
 
       case 1:
-	((Vertex *)context.data)->coord.y = atof(token);
+	readFloat(token.text, token.length, &vertex->coord.y);
 	break;
 
       case 2:
-	((Vertex *)context.data)->coord.z = atof(token);
+	readFloat(token.text, token.length, &vertex->coord.z);
 	break;
 
       default: break;
@@ -137,83 +208,681 @@ void parseNumber(Token token) {
       break;
       
     case CmdFace: {
-      ((uint16_t *)context.data)[context.counter] = atoi(token);
+      // wavefront indices are 1 based, negative indices are relative to the last parsed vertex
+      int32_t index;
+      if (!readInteger(token.text, token.length, &index)) {
+	printf("|%.*s|:invalid\n", (int)token.length, token.text);
+	break;
+      }
+      // valid are 1 to the vertices defined so far and their negatives, anything else would index outside the mesh
+      int64_t defined = (int64_t)context->base + PARSED_VERTICES(context);
+      if (index == 0 || index > defined || index < -defined) {
+	printf("|%.*s|:out of range\n", (int)token.length, token.text);
+	context->invalid = 1;
+	break;
+      }
+      index = index > 0 ? index - 1 : (int32_t)(defined + index);
+      // stored plus one, a list does not take NULL items
+      if (!addEntry(context->face, getEnd(context->face), (void *)((uintptr_t)index + 1))) {
+	context->failed = 1;
+      }
     }
       break;
 
     default: break;
     }
 
-    ++context.counter;
+    ++context->counter;
   }
 }
 
 
-int8_t cparserCallback(enum TokenType type, Token token) {
+int8_t cparserCallback(enum TokenType type, Token token, void * user) {
+  Context * context = (Context *)user;
+
   switch (type) {
   case TTEndLine:
-    parseLine();
+    parseLine(context);
     return 2;
 
   case TTText:
-    parseText(token);
+    parseText(context, token);
     break;
 
   case TTNumber:
-    parseNumber(token);
+    parseNumber(context, token);
     break;
   }
 
-  if (context.state == CmdNone) {
-    context.state = CmdWait;
+  if (context->state == CmdNone) {
+    context->state = CmdWait;
   }
 
   return 1;
 }
 
+// ----------------- Load helpers ------------------------------------------------------------------
+
+#define MIN_CHUNK_SIZE (1024 * 1024)              //!< Smallest amount of text worth a thread.
+
+/*! \struct Chunk
+  \brief Part of a wavefront parsed by one thread.
+  Chunks always start at the beginning of a line and end after a line end (or at the end of the text).
+*/
+typedef struct Chunk {
+  char const * begin;                             //!< First character of the chunk.
+  char const * end;                               //!< End of the chunk.
+  uint32_t vertices;                              //!< Vertex records counted in the chunk.
+  uint32_t base;                                  //!< Vertex records in all preceding chunks.
+  uint32_t flags;                                 //!< Load flags.
+  Context context;                                //!< Parser state of the chunk.
+  enum codes result;                              //!< Result of parsing the chunk.
+} Chunk;
+
+/*! \brief Prepares a context for a new load.
+  \param ctx Context to prepare.
+  \param base Vertices preceding the text that will be parsed.
+  \param flags Combination of LoadFlags.
+*/
+static void beginLoad(Context * ctx, uint32_t base, uint32_t flags) {
+  ctx->counter = 0;
+  ctx->state = CmdNone;
+  ctx->failed = 0;
+  ctx->invalid = 0;
+  ctx->fixed = 0;
+  ctx->soa = NULL;
+  ctx->topology = (flags & LFTopology) != 0;
+  ctx->base = base;
+  initArray(&ctx->verts, sizeof(Vertex), 0);
+  initArray(&ctx->inds, sizeof(uint32_t), 0);
+  // faces are short and cleared every line, the pool recycles its chunks instead of allocating per index
+  ctx->face = createListWithPool(NULL, 0);
+  if (!ctx->face) {
+    ctx->failed = 1;
+  }
+  initArray(&ctx->faceStart, sizeof(uint32_t), 0);
+  initArray(&ctx->faceIndices, sizeof(uint32_t), 0);
+}
+
+/*! \brief Checks a load.
+  Frees the buffers of the context when the load failed.
+  \param parsed Result of the tokenizer.
+  \param ctx Context of the load.
+  \return Return code.
+*/
+static enum codes checkLoad(enum ParseResults parsed, Context * ctx) {
+  enum codes result = Success;
+  if (parsed) {
+    result = Failed;
+  } else if (ctx->failed) {
+    result = MemAlloc;
+  } else if (ctx->invalid) {
+    result = InvalidBuffer;
+  } else if (ctx->inds.uiSize % 2 != 0) {
+    result = Failed;
+  }
+  destroyList(ctx->face);
+  ctx->face = NULL;
+  if (result != Success) {
+    freeArray(&ctx->verts);
+    freeArray(&ctx->inds);
+    freeArray(&ctx->faceStart);
+    freeArray(&ctx->faceIndices);
+  }
+  return result;
+}
+
+/*! \brief Applies load flags to the indices of a loaded mesh.
+  Indices are narrowed to 16 bit afterwards when the vertices allow it.
+  \param flags Combination of LoadFlags.
+  \param vertices Amount of vertices of the mesh.
+  \param indices Pointer to index buffer of the mesh.
+  \return Return code, the caller destroys the mesh on failure so a failed load never leaves buffers behind.
+*/
+static enum codes applyFlags(uint32_t flags, uint32_t vertices, IndexBuffer * indices) {
+  enum codes result = Success;
+  if (flags & LFDedupLines) {
+    result = dedupLines(indices);
+  }
+  if (result == Success) {
+    result = narrowIndexBuffer(vertices, indices);
+  }
+  return result;
+}
+
+/*! \brief Builds the topology of a loaded mesh.
+  Hands the kept faces to 'initTopology', the arrays are empty afterwards.
+  \param faceStart Start of every kept face.
+  \param faceIndices Indices of all kept faces.
+  \param mesh Pointer to mesh with its vertices loaded.
+  \return Return code, the caller destroys the mesh on failure.
+*/
+static enum codes attachTopology(Array * faceStart, Array * faceIndices, Mesh * mesh) {
+  // close the last face, so every face ends where the next starts
+  if (!ARRAY_PUSH(faceStart, uint32_t, faceIndices->uiSize)) {
+    freeArray(faceStart);
+    freeArray(faceIndices);
+    return MemAlloc;
+  }
+  uint32_t faces = faceStart->uiSize - 1;
+  shrinkArray(faceIndices);
+  uint32_t * starts = (uint32_t *)detachArray(faceStart, NULL);
+  uint32_t * indices = (uint32_t *)detachArray(faceIndices, NULL);
+  return initTopology(&mesh->vertices, faces, starts, indices, &mesh->topology);
+}
+
+/*! \brief Parses a wavefront file.
+  Maps the file, files that can not be mapped (anything but regular files) are streamed instead.
+  \param path Path to wavefront file.
+  \param ctx Context of the load.
+  \return Result of the tokenizer.
+*/
+static enum ParseResults parseWavefront(char const * path, Context * ctx) {
+  enum ParseResults parsed = parseFileMapped(path, cparserCallback, ctx);
+  if (parsed == RErrIO) {
+    parsed = parseFile(path, cparserCallback, ctx);
+  }
+  return parsed;
+}
+
+/*! \brief Finishes a load.
+  Hands the parsed buffers to 'mesh' on success, frees them otherwise.
+  \param parsed Result of the tokenizer.
+  \param ctx Context of the load.
+  \param flags Combination of LoadFlags.
+  \param mesh Pointer to resulting mesh.
+  \return Return code.
+*/
+static enum codes endLoad(enum ParseResults parsed, Context * ctx, uint32_t flags, Mesh * mesh) {
+  enum codes result = checkLoad(parsed, ctx);
+  if (result != Success) {
+    return result;
+  }
+
+  // hand storage to the mesh, shrinking only trims the unused tail
+  uint32_t size;
+  shrinkArray(&ctx->verts);
+  shrinkArray(&ctx->inds);
+  mesh->vertices.vertices = (Vertex *)detachArray(&ctx->verts, &size);
+  mesh->vertices.size = size;
+  mesh->indices.indices32 = (uint32_t *)detachArray(&ctx->inds, &size);
+  mesh->indices.size = size;
+  mesh->indices.width = Index32;
+  mesh->topology = NULL;
+
+  if (ctx->topology) {
+    result = attachTopology(&ctx->faceStart, &ctx->faceIndices, mesh);
+  }
+  if (result == Success) {
+    result = applyFlags(flags, mesh->vertices.size, &mesh->indices);
+  }
+  if (result != Success) {
+    destroyWavefront(mesh);
+  }
+  return result;
+}
+
+/*! \brief Counts vertex records.
+  Counts lines of which the first token is 'v', this is what the parser will turn into vertices for a valid file.
+  \param begin First character, must be at the start of a line.
+  \param end End of text.
+  \return Amount of vertex records.
+*/
+static uint32_t countVertices(char const * begin, char const * end) {
+  uint32_t count = 0;
+  while (begin < end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+      ++begin;
+    }
+    if (begin + 1 < end && begin[0] == 'v' && (begin[1] == ' ' || begin[1] == '\t')) {
+      ++count;
+    }
+    begin = memchr(begin, '\n', end - begin);
+    if (!begin) {
+      break;
+    }
+    ++begin;
+  }
+  return count;
+}
+
+/*! \brief Worker counting the vertex records of a chunk.
+  \param arg Pointer to chunk.
+  \return NULL.
+*/
+static void * countChunk(void * arg) {
+  Chunk * chunk = (Chunk *)arg;
+  chunk->vertices = countVertices(chunk->begin, chunk->end);
+  return NULL;
+}
+
+/*! \brief Worker parsing a chunk.
+  \param arg Pointer to chunk.
+  \return NULL.
+*/
+static void * parseChunk(void * arg) {
+  Chunk * chunk = (Chunk *)arg;
+  beginLoad(&chunk->context, chunk->base, chunk->flags);
+  chunk->result = checkLoad(parseBuffer(chunk->begin, chunk->end - chunk->begin, cparserCallback, &chunk->context), &chunk->context);
+  return NULL;
+}
+
+/*! \brief Resolves a thread count.
+  \param threads Requested amount of threads, 0 selects one per online processor.
+  \return Amount of threads to use.
+*/
+static uint32_t resolveThreads(uint32_t threads) {
+  if (!threads) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? (uint32_t)online : 1;
+  }
+  return threads;
+}
+
+/*! \brief Runs a worker on every chunk.
+  The first chunk is handled by the calling thread, chunks are handled inline when no thread can be started.
+  \param chunks Chunks to process.
+  \param count Amount of chunks.
+  \param worker Worker to run.
+*/
+static void runChunks(Chunk * chunks, uint32_t count, void * (*worker)(void *)) {
+  pthread_t threads[count];
+  int8_t started[count];
+  uint32_t i;
+  for (i = 1; i < count; ++i) {
+    started[i] = !pthread_create(&threads[i], NULL, worker, &chunks[i]);
+    if (!started[i]) {
+      worker(&chunks[i]);
+    }
+  }
+  worker(&chunks[0]);
+  for (i = 1; i < count; ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+}
+
+/*! \struct Batch
+  \brief Shared state of a batch load.
+*/
+typedef struct Batch {
+  char const * const * paths;                     //!< Paths to load.
+  Mesh * meshes;                                  //!< Resulting meshes.
+  enum codes * results;                           //!< Result per path, may be NULL.
+  uint32_t flags;                                 //!< Load flags of every path.
+  uint32_t count;                                 //!< Amount of paths.
+  uint32_t next;                                  //!< Next path to be taken by a worker.
+  uint32_t failed;                                //!< Amount of failed loads.
+} Batch;
+
+/*! \brief Worker loading wavefronts of a batch until none are left.
+  \param arg Pointer to batch.
+  \return NULL.
+*/
+static void * loadBatch(void * arg) {
+  Batch * batch = (Batch *)arg;
+  uint32_t i;
+  while ((i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) < batch->count) {
+    enum codes result = loadWavefront(batch->paths[i], batch->flags, &batch->meshes[i]);
+    if (result != Success) {
+      // leave nothing behind that could be mistaken for a loaded mesh
+      batch->meshes[i].vertices.vertices = NULL;
+      batch->meshes[i].vertices.size = 0;
+      batch->meshes[i].indices.indices = NULL;
+      batch->meshes[i].indices.size = 0;
+      batch->meshes[i].indices.width = Index16;
+      batch->meshes[i].topology = NULL;
+      __atomic_fetch_add(&batch->failed, 1, __ATOMIC_RELAXED);
+    }
+    if (batch->results) {
+      batch->results[i] = result;
+    }
+  }
+  return NULL;
+}
+
+/*! \brief Builds the topology of a mesh stitched from chunks.
+  Face indices are already absolute, only the face starts move by the indices of the preceding chunks.
+  \param chunks Parsed chunks.
+  \param count Amount of chunks.
+  \param mesh Pointer to stitched mesh.
+  \return Return code, the caller destroys the mesh on failure.
+*/
+static enum codes stitchTopology(Chunk * chunks, uint32_t count, Mesh * mesh) {
+  uint64_t faces = 0, indices = 0;
+  uint32_t i, j;
+  for (i = 0; i < count; ++i) {
+    faces += chunks[i].context.faceStart.uiSize;
+    indices += chunks[i].context.faceIndices.uiSize;
+  }
+  // fail on sizes that do not fit
+  if (faces >= UINT32_MAX || indices > UINT32_MAX) {
+    return InvalidParam;
+  }
+  Array faceStart, faceIndices;
+  initArray(&faceStart, sizeof(uint32_t), 0);
+  initArray(&faceIndices, sizeof(uint32_t), 0);
+  if (!reserveArray(&faceStart, (uint32_t)faces + 1) || (indices && !reserveArray(&faceIndices, (uint32_t)indices))) {
+    freeArray(&faceStart);
+    freeArray(&faceIndices);
+    return MemAlloc;
+  }
+  for (i = 0; i < count; ++i) {
+    Context * ctx = &chunks[i].context;
+    for (j = 0; j < ctx->faceStart.uiSize; ++j) {
+      ARRAY_AT(&faceStart, uint32_t, faceStart.uiSize++) = ARRAY_AT(&ctx->faceStart, uint32_t, j) + faceIndices.uiSize;
+    }
+    if (ctx->faceIndices.uiSize) {
+      memcpy(&ARRAY_AT(&faceIndices, uint32_t, faceIndices.uiSize), ctx->faceIndices.pData, sizeof(uint32_t) * ctx->faceIndices.uiSize);
+      faceIndices.uiSize += ctx->faceIndices.uiSize;
+    }
+  }
+  return attachTopology(&faceStart, &faceIndices, mesh);
+}
+
+/*! \brief Loads a wavefront from memory using multiple threads.
+  \param data Wavefront text.
+  \param len Length of 'data' in bytes.
+  \param threads Maximum amount of threads.
+  \param flags Combination of LoadFlags.
+  \param mesh Pointer to resulting mesh.
+  \return Return code.
+*/
+static enum codes loadChunked(char const * data, size_t len, uint32_t threads, uint32_t flags, Mesh * mesh) {
+  if (len / MIN_CHUNK_SIZE < threads) {
+    threads = len / MIN_CHUNK_SIZE;
+  }
+  if (threads < 2) {
+    return loadWavefrontFromMemory(data, len, flags, mesh);
+  }
+
+  Chunk * chunks = (Chunk *)malloc(sizeof(Chunk) * threads);
+  if (!chunks) {
+    return MemAlloc;
+  }
+  // split evenly, then move every split behind the next line end
+  uint32_t count = 0;
+  char const * begin = data;
+  char const * end = data + len;
+  uint32_t i;
+  for (i = 1; i <= threads && begin < end; ++i) {
+    char const * split = i == threads ? end : data + len / threads * i;
+    if (split < begin) {
+      split = begin;
+    }
+    if (split < end) {
+      split = memchr(split, '\n', end - split);
+      split = split ? split + 1 : end;
+    }
+    chunks[count].begin = begin;
+    chunks[count].end = split;
+    chunks[count].flags = flags;
+    ++count;
+    begin = split;
+  }
+
+  // vertex numbering continues over chunks, so every chunk needs the amount of vertices before it
+  runChunks(chunks, count, countChunk);
+  uint32_t vertices = 0;
+  for (i = 0; i < count; ++i) {
+    chunks[i].base = vertices;
+    vertices += chunks[i].vertices;
+  }
+  runChunks(chunks, count, parseChunk);
+
+  enum codes result = Success;
+  uint32_t indices = 0;
+  int8_t counted = 1;
+  for (i = 0; i < count; ++i) {
+    if (chunks[i].result != Success && result == Success) {
+      result = chunks[i].result;
+    }
+    counted &= chunks[i].result != Success || chunks[i].context.verts.uiSize == chunks[i].vertices;
+    indices += chunks[i].context.inds.uiSize;
+  }
+
+  // stitch chunks together, only possible when every chunk parsed and the bases were right
+  if (result == Success && counted) {
+    Vertex * stitchedVertices = vertices ? (Vertex *)malloc(sizeof(Vertex) * vertices) : NULL;
+    uint32_t * stitchedIndices = indices ? (uint32_t *)malloc(sizeof(uint32_t) * indices) : NULL;
+    if ((vertices && !stitchedVertices) || (indices && !stitchedIndices)) {
+      free(stitchedVertices);
+      free(stitchedIndices);
+      result = MemAlloc;
+    } else {
+      for (i = 0, indices = 0; i < count; ++i) {
+        if (chunks[i].context.verts.uiSize) {
+          memcpy(&stitchedVertices[chunks[i].base], chunks[i].context.verts.pData, sizeof(Vertex) * chunks[i].context.verts.uiSize);
+        }
+        if (chunks[i].context.inds.uiSize) {
+          memcpy(&stitchedIndices[indices], chunks[i].context.inds.pData, sizeof(uint32_t) * chunks[i].context.inds.uiSize);
+        }
+        indices += chunks[i].context.inds.uiSize;
+      }
+      mesh->vertices.vertices = stitchedVertices;
+      mesh->vertices.size = vertices;
+      mesh->indices.indices32 = stitchedIndices;
+      mesh->indices.size = indices;
+      mesh->indices.width = Index32;
+      mesh->topology = NULL;
+      if (flags & LFTopology) {
+        result = stitchTopology(chunks, count, mesh);
+      }
+      // duplicates can span chunks, so flags apply to the stitched mesh
+      if (result == Success) {
+        result = applyFlags(flags, mesh->vertices.size, &mesh->indices);
+      }
+      if (result != Success) {
+        destroyWavefront(mesh);
+      }
+    }
+  }
+  for (i = 0; i < count; ++i) {
+    freeArray(&chunks[i].context.verts);
+    freeArray(&chunks[i].context.inds);
+    freeArray(&chunks[i].context.faceStart);
+    freeArray(&chunks[i].context.faceIndices);
+  }
+  free(chunks);
+
+  // a vertex record the counter missed or the parser rejected shifts relative indices and the range of valid ones,
+  // only a serial load gets those right
+  if ((result == Success && !counted) || result == InvalidBuffer) {
+    return loadWavefrontFromMemory(data, len, flags, mesh);
+  }
+  return result;
+}
+
+/*! \brief Loads a wavefront as structure of arrays by converting a loaded mesh.
+  \param path Path to wavefront file.
+  \param flags Combination of LoadFlags, without LFTopology.
+  \param mesh Pointer to resulting mesh.
+  \return Return code.
+*/
+static enum codes convertWavefrontSoA(char const * path, uint32_t flags, MeshSoA * mesh) {
+  Mesh loaded;
+  enum codes result = loadWavefront(path, flags, &loaded);
+  if (result != Success) {
+    return result;
+  }
+  result = initVertexBufferSoA(loaded.vertices.size, &mesh->vertices);
+  if (result == Success) {
+    // the parsed vertices are only freed once converted, peak memory holds both layouts
+    convertToSoA(&loaded.vertices, &mesh->vertices);
+    // indices are handed over as they are
+    mesh->indices = loaded.indices;
+    loaded.indices.indices = NULL;
+    loaded.indices.size = 0;
+  }
+  destroyWavefront(&loaded);
+  return result;
+}
+
 // ----------------- Functions ---------------------------------------------------------------------
 
-enum codes loadWavefront(char const * path, Mesh * mesh) {
+enum codes loadWavefront(char const * path, uint32_t flags, Mesh * mesh) {
   if (!mesh || !path) {
     return NullPointer;
   }
 
-  context.counter = 0;
-  context.state = CmdNone;
-  context.inds = createList(NULL);
-  context.verts = createList(free);
-  context.data = NULL;
+  Context ctx;
+  beginLoad(&ctx, 0, flags);
+  return endLoad(parseWavefront(path, &ctx), &ctx, flags, mesh);
+}
 
-  if (parseFile(path, cparserCallback)) {
-    destroyList(context.verts);
-    destroyList(context.inds);
-    return Failed;
+enum codes loadWavefrontFromMemory(char const * data, size_t len, uint32_t flags, Mesh * mesh) {
+  if (!mesh || (!data && len)) {
+    return NullPointer;
   }
-  
-  mesh->vertices.size = getSize(context.verts);
-  mesh->indices.size = getSize(context.inds);
-  if (mesh->indices.size % 2 != 0) {
-    destroyList(context.verts);
-    destroyList(context.inds);
-    return Failed;
+
+  Context ctx;
+  beginLoad(&ctx, 0, flags);
+  return endLoad(parseBuffer(data, len, cparserCallback, &ctx), &ctx, flags, mesh);
+}
+
+enum codes loadWavefrontParallel(char const * path, uint32_t threads, uint32_t flags, Mesh * mesh) {
+  if (!mesh || !path) {
+    return NullPointer;
+  }
+  threads = resolveThreads(threads);
+
+  size_t len;
+  char const * data = mapFile(path, &len);
+  // anything that can not be mapped can not be split either
+  if (!data) {
+    return loadWavefront(path, flags, mesh);
   }
+  enum codes result = loadChunked(data, len, threads, flags, mesh);
+  unmapFile(data, len);
+  return result;
+}
 
-  mesh->vertices.vertices = (Vertex *)malloc(sizeof(Vertex) * mesh->vertices.size);
-  mesh->indices.indices = (uint16_t *)malloc(sizeof(uint16_t) * mesh->indices.size);
+enum codes loadWavefrontBatch(char const * const * paths, uint32_t count, uint32_t threads, uint32_t flags, Mesh * meshes, enum codes * results) {
+  if (!paths || !meshes) {
+    return NullPointer;
+  }
+  threads = resolveThreads(threads);
+  if (threads > count) {
+    threads = count;
+  }
 
-  int i;
-  Iterator * iter;
-  for (i = 0, iter = getBegin(context.verts); iter; ++i, moveNext(&iter)) {
-    memcpy(&mesh->vertices.vertices[i], getCurrent(iter), sizeof(Vertex));
+  Batch batch = { paths, meshes, results, flags, count, 0, 0 };
+  pthread_t workers[threads ? threads : 1];
+  uint32_t started;
+  // calling thread works as well, it takes whatever is left when threads could not be started
+  for (started = 0; started + 1 < threads; ++started) {
+    if (pthread_create(&workers[started], NULL, loadBatch, &batch)) {
+      break;
+    }
   }
-  for (i = 0, iter = getBegin(context.inds); iter; ++i, moveNext(&iter)) {
-    void * ptr = getCurrent(iter);
-    memcpy(&mesh->indices.indices[i], (void *)&ptr, sizeof(uint16_t));
+  loadBatch(&batch);
+  while (started) {
+    pthread_join(workers[--started], NULL);
   }
-  
-  destroyList(context.verts);
-  destroyList(context.inds);
+  return batch.failed ? Failed : Success;
+}
+
+enum codes loadWavefrontSoA(char const * path, uint32_t flags, MeshSoA * mesh) {
+  if (!mesh || !path) {
+    return NullPointer;
+  }
+  // a structure of arrays mesh has no topology
+  if (flags & LFTopology) {
+    return InvalidParam;
+  }
+
+  size_t len;
+  char const * data = mapFile(path, &len);
+  // anything that can not be mapped can not be counted up front either
+  if (!data) {
+    return convertWavefrontSoA(path, flags, mesh);
+  }
+  mesh->indices.indices = NULL;
+  mesh->indices.size = 0;
+  mesh->indices.width = Index32;
+  enum codes result = initVertexBufferSoA(countVertices(data, data + len), &mesh->vertices);
+  if (result == Success) {
+    Context ctx;
+    beginLoad(&ctx, 0, flags);
+    mesh->vertices.size = 0;
+    ctx.soa = &mesh->vertices;
+    result = checkLoad(parseBuffer(data, len, cparserCallback, &ctx), &ctx);
+    if (result == Success) {
+      uint32_t size;
+      shrinkArray(&ctx.inds);
+      freeArray(&ctx.verts);
+      mesh->indices.indices32 = (uint32_t *)detachArray(&ctx.inds, &size);
+      mesh->indices.size = size;
+      result = applyFlags(flags, mesh->vertices.size, &mesh->indices);
+    }
+    if (result != Success) {
+      destroyWavefrontSoA(mesh);
+    }
+  }
+  unmapFile(data, len);
+
+  // a vertex record the counter missed does not fit the arrays, as with a chunked load only the serial load gets it right
+  if (result == InvalidBuffer) {
+    return convertWavefrontSoA(path, flags, mesh);
+  }
+  return result;
+}
 
+enum codes destroyWavefrontSoA(MeshSoA * mesh) {
+  if (!mesh) {
+    return NullPointer;
+  }
+  freeVertexBufferSoA(&mesh->vertices);
+  if (mesh->indices.indices) {
+    free(mesh->indices.indices);
+    mesh->indices.indices = NULL;
+    mesh->indices.size = 0;
+  }
+  return Success;
+}
+
+enum codes loadWavefrontFixed(char const * path, uint32_t flags, MeshFixed * mesh) {
+  if (!mesh || !path) {
+    return NullPointer;
+  }
+
+  Context ctx;
+  // a fixed point mesh has no topology
+  beginLoad(&ctx, 0, flags & ~LFTopology);
+  ctx.fixed = 1;
+  initArray(&ctx.verts, sizeof(VertexFixed), 0);
+  enum codes result = checkLoad(parseWavefront(path, &ctx), &ctx);
+  if (result != Success) {
+    return result;
+  }
+
+  uint32_t size;
+  shrinkArray(&ctx.verts);
+  shrinkArray(&ctx.inds);
+  mesh->vertices.vertices = (VertexFixed *)detachArray(&ctx.verts, &size);
+  mesh->vertices.size = size;
+  mesh->indices.indices32 = (uint32_t *)detachArray(&ctx.inds, &size);
+  mesh->indices.size = size;
+  mesh->indices.width = Index32;
+
+  result = applyFlags(flags, mesh->vertices.size, &mesh->indices);
+  if (result != Success) {
+    destroyWavefrontFixed(mesh);
+  }
+  return result;
+}
+
+enum codes destroyWavefrontFixed(MeshFixed * mesh) {
+  if (!mesh) {
+    return NullPointer;
+  }
+  free(mesh->vertices.vertices);
+  mesh->vertices.vertices = NULL;
+  mesh->vertices.size = 0;
+  free(mesh->indices.indices);
+  mesh->indices.indices = NULL;
+  mesh->indices.size = 0;
   return Success;
 }
 
@@ -231,6 +900,8 @@ enum codes destroyWavefront(Mesh * mesh) {
     mesh->indices.indices = NULL;
     mesh->indices.size = 0;
   }
+  freeTopology(mesh->topology);
+  mesh->topology = NULL;
   
   return Success;
 }
@@ -9,17 +9,109 @@
 */
 
 #include "gtypes.h"                               // Declarations of graphics types.
+#include "gsoa.h"                                 // Declarations of structure of arrays graphics types.
+#include "gfixed.h"                               // Declarations of fixed point graphics types.
 #include "codes.h"                                // Definitions of all return codes.
+#include <stddef.h>
+
+/*! \enum LoadFlags
+  \brief Options of the wavefront loaders.
+  Flags can be combined with '|'.
+*/
+enum LoadFlags {
+  LFNone            = 0,                          //!< Load the mesh as described by the file.
+  LFDedupLines      = 1 << 0,                     //!< Remove duplicate lines, an edge shared by two faces is kept once. See 'dedupLines'.
+  LFTopology        = 1 << 1,                     //!< Keep the faces and their edge adjacency in 'Mesh.topology' for culling. Ignored by 'loadWavefrontFixed'.
+};
 
 /*! \brief Loads a wavefront into memory.
   Reads contents of 'path' and stores the parsed result in 'mesh'.
+  Indices are stored in 16 bit when the mesh has at most 65536 vertices, in 32 bit otherwise (see 'IndexBuffer.width').
+  The mesh pointed to by 'mesh' should be allocated, vertex and index buffer should not be allocated.
+  \param path Path to wavefront file.
+  \param flags Combination of LoadFlags.
+  \param mesh Pointer to resulting mesh.
+  \return Return code, InvalidBuffer when a face refers to index 0 or to a vertex not defined before it.
+*/
+enum codes loadWavefront(char const * path, uint32_t flags, Mesh * mesh);
+
+/*! \brief Loads a wavefront from memory.
+  Parses the wavefront text held in 'data' and stores the parsed result in 'mesh'.
+  The text does not have to be zero terminated and is not modified.
+  The mesh pointed to by 'mesh' should be allocated, vertex and index buffer should not be allocated.
+  \param data Wavefront text.
+  \param len Length of 'data' in bytes.
+  \param flags Combination of LoadFlags.
+  \param mesh Pointer to resulting mesh.
+  \return Return code.
+*/
+enum codes loadWavefrontFromMemory(char const * data, size_t len, uint32_t flags, Mesh * mesh);
+
+/*! \brief Loads a wavefront into memory using multiple threads.
+  Maps 'path', splits it at line ends into one chunk per thread and parses the chunks concurrently.
+  Vertex numbering continues over chunks, the resulting mesh is identical to the one 'loadWavefront' produces.
+  Small files and files that can not be mapped are loaded by a single thread.
   The mesh pointed to by 'mesh' should be allocated, vertex and index buffer should not be allocated.
   \param path Path to wavefront file.
+  \param threads Maximum amount of threads, 0 uses one thread per online processor.
+  \param flags Combination of LoadFlags.
   \param mesh Pointer to resulting mesh.
   \return Return code.
 */
-enum codes loadWavefront(char const * path, Mesh * mesh);
+enum codes loadWavefrontParallel(char const * path, uint32_t threads, uint32_t flags, Mesh * mesh);
 
+/*! \brief Loads a batch of wavefronts.
+  Loads every path in 'paths' like 'loadWavefront', a pool of threads takes paths from the batch until all are loaded.
+  Each mesh must be destroyed by 'destroyWavefront', meshes that failed to load are left empty.
+  \param paths Paths to wavefront files.
+  \param count Amount of paths.
+  \param threads Maximum amount of threads, 0 uses one thread per online processor.
+  \param flags Combination of LoadFlags, applied to every mesh.
+  \param meshes Array of 'count' meshes receiving the results.
+  \param results Array of 'count' return codes, one per path, may be NULL.
+  \return Success when all paths loaded, Failed otherwise.
+*/
+enum codes loadWavefrontBatch(char const * const * paths, uint32_t count, uint32_t threads, uint32_t flags, Mesh * meshes, enum codes * results);
+
+
+/*! \brief Loads a wavefront into memory as structure of arrays.
+  Same as 'loadWavefront', the vertices are stored in a VertexBufferSoA.
+  The file is mapped and its vertex records are counted first, coordinates are then parsed straight into arrays of that size,
+  so peak memory is the vertices once plus the indices.
+  Files that can not be mapped, and files with vertex records the count misses, are loaded by 'loadWavefront' and converted
+  by 'convertToSoA' instead. Both layouts exist until that conversion ends, peak memory is then the vertices twice.
+  The mesh must be destroyed by 'destroyWavefrontSoA'.
+  \param path Path to wavefront file.
+  \param flags Combination of LoadFlags, LFTopology is not supported as a MeshSoA has no topology.
+  \param mesh Pointer to resulting mesh.
+  \return Return code, InvalidParam when 'flags' holds LFTopology.
+*/
+enum codes loadWavefrontSoA(char const * path, uint32_t flags, MeshSoA * mesh);
+
+/*! \brief Destroys a structure of arrays mesh.
+  Frees memory allocated by 'loadWavefrontSoA'.
+  \param mesh Pointer to mesh to free.
+  \return Return code.
+*/
+enum codes destroyWavefrontSoA(MeshSoA * mesh);
+
+/*! \brief Loads a wavefront into memory as fixed point.
+  Same as 'loadWavefront', coordinates are converted from text straight to Q16.16 by 'readFixed' without going through float.
+  Coordinates outside the Q16.16 range are reported and left 0.
+  The mesh must be destroyed by 'destroyWavefrontFixed'.
+  \param path Path to wavefront file.
+  \param flags Combination of LoadFlags.
+  \param mesh Pointer to resulting mesh.
+  \return Return code.
+*/
+enum codes loadWavefrontFixed(char const * path, uint32_t flags, MeshFixed * mesh);
+
+/*! \brief Destroys a fixed point mesh.
+  Frees memory allocated by 'loadWavefrontFixed'.
+  \param mesh Pointer to mesh to free.
+  \return Return code.
+*/
+enum codes destroyWavefrontFixed(MeshFixed * mesh);
 
 /*! \brief Destroys a mesh.
   Frees memory allocated by 'loadWavefront'.
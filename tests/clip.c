@@ -0,0 +1,279 @@
+#include "gclip.h"
+
+/*! \file clip.c
+  \brief Test of the batched line clipping.
+  Clips random meshes with 'clipLines' and compares every line with a scalar Liang-Barsky clip of that line alone against
+  all six planes. Lines must survive in input order with the same end points and colors. Unclipped ends must share one
+  vertex through the remap table, and vertices of rejected lines must stay unmapped. Meshes completely inside and
+  completely outside the frustum are checked as well, all with one clip output so the table is reused.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/27
+  \copyright GNU Public License.
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define MESHES 60                                 //!< Random meshes.
+#define MAX_LINES 2000                            //!< Most lines of a random mesh.
+#define TOLERANCE 1e-4f                           //!< Largest difference of a coordinate in normalized device coordinates.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Random float in a range.
+  \param min Minimum.
+  \param max Maximum.
+  \return Random value in [min, max].
+*/
+static float randomRange(float min, float max) {
+  return (float)(min + ((double)max - min) * rand() / RAND_MAX);
+}
+
+/*! \brief Clips a single line against all planes.
+  \param a Start of the line.
+  \param b End of the line.
+  \param t0 Pointer to receive the start of the visible part.
+  \param t1 Pointer to receive the end of the visible part.
+  \return 1 if part of the line is visible, else 0.
+*/
+static int8_t clipLine(Vector4 a, Vector4 b, float * t0, float * t1) {
+  float da[6] = {a.w + a.x, a.w + a.y, a.w + a.z, a.w - a.x, a.w - a.y, a.w - a.z};
+  float db[6] = {b.w + b.x, b.w + b.y, b.w + b.z, b.w - b.x, b.w - b.y, b.w - b.z};
+  *t0 = 0.0f;
+  *t1 = 1.0f;
+  int plane;
+  for (plane = 0; plane < 6; ++plane) {
+    if (da[plane] < 0.0f && db[plane] < 0.0f) {
+      return 0;
+    }
+    float t = da[plane] / (da[plane] - db[plane]);
+    if (da[plane] < 0.0f) {
+      *t0 = fmaxf(*t0, t);
+    } else if (db[plane] < 0.0f) {
+      *t1 = fminf(*t1, t);
+    }
+  }
+  return *t0 <= *t1;
+}
+
+/*! \brief Interpolates a color per channel, rounding to the nearest.
+  \param a Color at 0.
+  \param b Color at 1.
+  \param t Position.
+  \param channel Shift of the channel.
+  \param bits Width of the channel.
+  \return Interpolated channel.
+*/
+static int lerpChannel(Color a, Color b, float t, int channel, int bits) {
+  int ca = (a >> channel) & ((1 << bits) - 1), cb = (b >> channel) & ((1 << bits) - 1);
+  return (int)floorf(ca + (cb - ca) * t + 0.5f);
+}
+
+/*! \brief Compares an output vertex with a point of a line.
+  \param out Pointer to vertex written by 'clipLines'.
+  \param a Start of the line.
+  \param b End of the line.
+  \param ca Color at the start.
+  \param cb Color at the end.
+  \param t Position of the point on the line.
+  \return 1 when the coordinate is within TOLERANCE and every channel within 1, else 0.
+*/
+static int8_t samePoint(Vertex const * out, Vector4 a, Vector4 b, Color ca, Color cb, float t) {
+  Vector4 v = {a.x + t * (b.x - a.x), a.y + t * (b.y - a.y), a.z + t * (b.z - a.z), a.w + t * (b.w - a.w)};
+  Color c = out->color;
+  return fabsf(out->coord.x - v.x / v.w) <= TOLERANCE && fabsf(out->coord.y - v.y / v.w) <= TOLERANCE
+    && fabsf(out->coord.z - v.z / v.w) <= TOLERANCE && abs((c >> 11) - lerpChannel(ca, cb, t, 11, 5)) <= 1
+    && abs(((c >> 5) & 0x3F) - lerpChannel(ca, cb, t, 5, 6)) <= 1 && abs((c & 0x1F) - lerpChannel(ca, cb, t, 0, 5)) <= 1;
+}
+
+/*! \brief Clips a mesh and compares with the scalar clip of every line.
+  \param name Name of the mesh.
+  \param clip Pointer to clip space vertices.
+  \param lines Pointer to index buffer with the lines.
+  \param out Pointer to clip output.
+  \param expected Pointer to the line counts the mesh must give, NULL to only compare with the scalar clip.
+  \return 1 when output, remap table and counts match, else 0.
+*/
+static int8_t checkClip(char const * name, ClipBuffer const * clip, IndexBuffer const * lines, ClipOutput * out, ClipStats const * expected) {
+  ClipStats stats;
+  if (clipLines(clip, lines, NULL, out, &stats) != Success) {
+    printf("%s: clipLines failed\n", name);
+    return 0;
+  }
+  // per vertex 1 + index of the output vertex of its unclipped ends, 0 when no surviving line ends unclipped in it
+  uint32_t * shared = (uint32_t *)calloc(clip->size ? clip->size : 1, sizeof(uint32_t));
+  if (!shared) {
+    printf("%s: out of memory\n", name);
+    return 0;
+  }
+  Vertex const * vertices = out->mesh.vertices.vertices;
+  uint32_t const * indices = out->mesh.indices.indices32;
+  ClipStats counted = {0, 0, 0};
+  uint32_t written = 0, clippedEnds = 0;
+  int8_t ok = 1;
+  uint32_t i;
+  for (i = 0; i < lines->size / 2 && ok; ++i) {
+    uint32_t a = getIndex(i * 2, lines), b = getIndex(i * 2 + 1, lines);
+    Vector4 va = {clip->x[a], clip->y[a], clip->z[a], clip->w[a]};
+    Vector4 vb = {clip->x[b], clip->y[b], clip->z[b], clip->w[b]};
+    float t0, t1;
+    if (!clipLine(va, vb, &t0, &t1)) {
+      ++counted.rejected;
+      continue;
+    }
+    int8_t inside = !(clip->outcode[a] | clip->outcode[b]);
+    counted.accepted += inside;
+    counted.clipped += !inside;
+    if (written + 2 > out->mesh.indices.size) {
+      printf("%s: line %u missing\n", name, i);
+      ok = 0;
+      break;
+    }
+    uint32_t ia = indices[written++], ib = indices[written++];
+    uint32_t ends[2] = { a, b }, outs[2] = { ia, ib };
+    float ts[2] = { t0, t1 };
+    uint32_t e;
+    for (e = 0; e < 2 && ok; ++e) {
+      if (outs[e] >= out->mesh.vertices.size || !samePoint(&vertices[outs[e]], va, vb, clip->color[a], clip->color[b], ts[e])) {
+        printf("%s: line %u end %u differs\n", name, i, e);
+        ok = 0;
+      } else if (ts[e] == (float)e) {
+        // an unclipped end is the one vertex of its input vertex
+        ok = (!shared[ends[e]] || shared[ends[e]] == outs[e] + 1) && out->remap[ends[e]] == outs[e] + 1;
+        shared[ends[e]] = outs[e] + 1;
+        if (!ok) {
+          printf("%s: line %u end %u not shared through the remap table\n", name, i, e);
+        }
+      } else {
+        ++clippedEnds;
+      }
+    }
+  }
+  // rejected lines map nothing, every output vertex is a shared or a clipped end
+  uint32_t mapped = 0;
+  for (i = 0; i < clip->size && ok; ++i) {
+    ok = out->remap[i] == shared[i];
+    mapped += !!shared[i];
+    if (!ok) {
+      printf("%s: vertex %u mapped to %u, expected %u\n", name, i, out->remap[i], shared[i]);
+    }
+  }
+  if (ok && (written != out->mesh.indices.size || out->mesh.vertices.size != mapped + clippedEnds)) {
+    printf("%s: %u indices %u vertices, expected %u %u\n", name, out->mesh.indices.size, out->mesh.vertices.size, written, mapped + clippedEnds);
+    ok = 0;
+  }
+  if (ok && (memcmp(&stats, &counted, sizeof(ClipStats)) || (expected && memcmp(&stats, expected, sizeof(ClipStats))))) {
+    printf("%s: %u accepted %u clipped %u rejected, expected %u %u %u\n", name, stats.accepted, stats.clipped, stats.rejected,
+	   counted.accepted, counted.clipped, counted.rejected);
+    ok = 0;
+  }
+  free(shared);
+  return ok;
+}
+
+/*! \brief Builds a random mesh and transforms it to clip space.
+  \param matrix Pointer to transformation to clip space.
+  \param vertices Amount of vertices.
+  \param lines Amount of lines.
+  \param width Index width.
+  \param min Smallest coordinate of a vertex.
+  \param max Largest coordinate of a vertex.
+  \param clip Pointer to clip buffer to initialize.
+  \param ib Pointer to index buffer to initialize.
+  \return 1 on success, else 0.
+*/
+static int8_t buildClip(Matrix4 const * matrix, uint32_t vertices, uint32_t lines, enum IndexWidth width, Vector min, Vector max,
+			ClipBuffer * clip, IndexBuffer * ib) {
+  VertexBuffer vb;
+  if (initVertexBuffer(vertices, &vb) != Success) {
+    return 0;
+  }
+  if (initClipBuffer(vertices, clip) != Success) {
+    free(vb.vertices);
+    return 0;
+  }
+  if (initIndexBuffer(lines, width, ib) != Success) {
+    free(vb.vertices);
+    freeClipBuffer(clip);
+    return 0;
+  }
+  uint32_t i;
+  for (i = 0; i < vertices; ++i) {
+    vb.vertices[i].coord.x = randomRange(min.x, max.x);
+    vb.vertices[i].coord.y = randomRange(min.y, max.y);
+    vb.vertices[i].coord.z = randomRange(min.z, max.z);
+    vb.vertices[i].color = (Color)rand();
+  }
+  for (i = 0; i < ib->size; ++i) {
+    uint32_t index = (uint32_t)rand() % vertices;
+    if (width == Index16) {
+      ib->indices[i] = (uint16_t)index;
+    } else {
+      ib->indices32[i] = index;
+    }
+  }
+  clipTransform(matrix, &vb, clip);
+  free(vb.vertices);
+  return 1;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  // camera at the origin looking down -z, vertices all around it and behind it
+  Matrix4 matrix;
+  perspectiveMatrix(1.0f, 4.0f / 3.0f, 1.0f, 50.0f, &matrix);
+  Vector around[2] = { { -40.0f, -30.0f, -60.0f }, { 40.0f, 30.0f, 10.0f } };
+  // well inside the frustum, and completely left of it
+  Vector inside[2] = { { -0.5f, -0.5f, -4.0f }, { 0.5f, 0.5f, -2.0f } };
+  Vector left[2] = { { -40.0f, -1.0f, -4.0f }, { -20.0f, 1.0f, -2.0f } };
+  ClipOutput out;
+  initClipOutput(&out);
+  srand(19);
+  int failed = 0;
+  uint32_t m;
+  for (m = 0; m < MESHES; ++m) {
+    ClipBuffer clip;
+    IndexBuffer ib;
+    uint32_t lines = 1 + (uint32_t)rand() % MAX_LINES;
+    uint32_t vertices = 1 + (uint32_t)rand() % 800;
+    enum IndexWidth width = m % 2 ? Index16 : Index32;
+    char name[32];
+    snprintf(name, sizeof(name), "mesh %u", m);
+    if (m % 3 == 0) {
+      // a mesh in front of the camera, all lines accepted and every vertex used is shared
+      ClipStats expected = { lines, 0, 0 };
+      if (!buildClip(&matrix, vertices, lines, width, inside[0], inside[1], &clip, &ib)) {
+	printf("clip: out of memory\n");
+	return 1;
+      }
+      failed |= !checkClip(name, &clip, &ib, &out, &expected);
+    } else if (m % 3 == 1) {
+      // a mesh left of the frustum, all lines rejected and the remap table stays empty
+      ClipStats expected = { 0, 0, lines };
+      if (!buildClip(&matrix, vertices, lines, width, left[0], left[1], &clip, &ib)) {
+	printf("clip: out of memory\n");
+	return 1;
+      }
+      failed |= !checkClip(name, &clip, &ib, &out, &expected);
+    } else {
+      if (!buildClip(&matrix, vertices, lines, width, around[0], around[1], &clip, &ib)) {
+	printf("clip: out of memory\n");
+	return 1;
+      }
+      failed |= !checkClip(name, &clip, &ib, &out, NULL);
+    }
+    freeClipBuffer(&clip);
+    free(ib.indices);
+  }
+  freeClipOutput(&out);
+  printf("clip: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
@@ -0,0 +1,190 @@
+#include "gcmd.h"
+
+/*! \file cmd.c
+  \brief Test of the line command buffers.
+  Builds frames of random meshes with the identity matrix, so vertices are screen coordinates, and compares the blocks with
+  the records expected per line: lines with an end point outside 16 bits are dropped and the rest are back to back in mesh
+  order. With both blocks busy the next build must fail until one is released.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define MESHES 40                                 //!< Random meshes.
+#define MAX_LINES 2000                            //!< Most lines of a random mesh.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Random float in a range.
+  \param min Minimum.
+  \param max Maximum.
+  \return Random value in [min, max].
+*/
+static float randomRange(float min, float max) {
+  return (float)(min + ((double)max - min) * rand() / RAND_MAX);
+}
+
+/*! \brief Fills a mesh with random lines.
+  Most vertices are in 16 bits, some just outside, far outside or not a number.
+  \param mesh Pointer to mesh with its buffers allocated.
+*/
+static void fillMesh(Mesh * mesh) {
+  uint32_t i;
+  for (i = 0; i < mesh->vertices.size; ++i) {
+    Vector * coord = &mesh->vertices.vertices[i].coord;
+    int pick = rand() % 100;
+    if (pick < 80) {
+      coord->x = randomRange(-2000.0f, 2000.0f);
+      coord->y = randomRange(-2000.0f, 2000.0f);
+    } else if (pick < 90) {
+      coord->x = randomRange(INT16_MIN, INT16_MAX);
+      coord->y = pick % 2 ? INT16_MAX + 1.0f : INT16_MIN - 1.0f;
+    } else if (pick < 98) {
+      coord->x = randomRange(-1e6f, 1e6f);
+      coord->y = randomRange(-1e6f, 1e6f);
+    } else {
+      coord->x = 1.0f;
+      coord->y = NAN;
+    }
+    coord->z = 0.0f;
+    mesh->vertices.vertices[i].color = (Color)rand();
+  }
+  for (i = 0; i < mesh->indices.size; ++i) {
+    uint32_t index = (uint32_t)rand() % mesh->vertices.size;
+    if (mesh->indices.width == Index16) {
+      mesh->indices.indices[i] = (uint16_t)index;
+    } else {
+      mesh->indices.indices32[i] = index;
+    }
+  }
+}
+
+/*! \brief Snaps a vertex like a command does.
+  \param v Pointer to vertex.
+  \param point Pointer to receive the pixel.
+  \return 1 when the vertex fits 16 bits, else 0.
+*/
+static int8_t snapVertex(Vertex const * v, CommandPoint * point) {
+  double x = floor(v->coord.x), y = floor(v->coord.y);
+  if (!(x >= INT16_MIN && x <= INT16_MAX && y >= INT16_MIN && y <= INT16_MAX)) {
+    return 0;
+  }
+  point->x = (int16_t)x;
+  point->y = (int16_t)y;
+  return 1;
+}
+
+/*! \brief Compares a block with the records expected for a mesh.
+  \param mesh Pointer to mesh.
+  \param buffer Pointer to block built from the mesh.
+  \param stats Pointer to counts of the build.
+  \return 1 when records and counts match, else 0.
+*/
+static int8_t checkFrame(Mesh const * mesh, CommandBuffer const * buffer, FrameStats const * stats) {
+  uint32_t lines = mesh->indices.size / 2;
+  uint32_t count = 0;
+  uint32_t i;
+  for (i = 0; i < lines; ++i) {
+    Vertex const * a = &mesh->vertices.vertices[getIndex(i * 2, &mesh->indices)];
+    Vertex const * b = &mesh->vertices.vertices[getIndex(i * 2 + 1, &mesh->indices)];
+    CommandPoint pa, pb;
+    if (!snapVertex(a, &pa) | !snapVertex(b, &pb)) {
+      continue;
+    }
+    LineCommand const * c = &buffer->commands[count];
+    if (count >= buffer->count || c->x0 != pa.x || c->y0 != pa.y || c->x1 != pb.x || c->y1 != pb.y || c->color != a->color || c->flags) {
+      printf("line %u: record %u differs\n", i, count);
+      return 0;
+    }
+    ++count;
+  }
+  if (buffer->count != count || stats->records != count || stats->lines != lines || stats->dropped != lines - count
+      || stats->bytes != sizeof(LineCommand) * (uint64_t)count) {
+    printf("%u lines: %u records %u dropped, expected %u %u\n", lines, stats->records, stats->dropped, count, lines - count);
+    return 0;
+  }
+  return 1;
+}
+
+/*! \brief Builds frames until both blocks are busy.
+  \param frames Pointer to command frames of the mesh.
+  \param mesh Pointer to mesh.
+  \param matrix Pointer to transformation.
+  \return 1 when the third build fails, leaves the blocks as they are and succeeds after a release, else 0.
+*/
+static int8_t checkExhaustion(CommandFrames * frames, Mesh const * mesh, Matrix4 const * matrix) {
+  CommandBuffer * first = NULL, * second = NULL, * third = NULL;
+  if (buildCommandFrame(frames, mesh, matrix, &first, NULL) != Success || buildCommandFrame(frames, mesh, matrix, &second, NULL) != Success) {
+    printf("exhaustion: build failed\n");
+    return 0;
+  }
+  uint64_t built = frames->frames;
+  int8_t ok = first != second && first->busy && second->busy;
+  // both blocks busy, the build fails and changes nothing
+  ok &= buildCommandFrame(frames, mesh, matrix, &third, NULL) == Failed && !third && frames->frames == built;
+  ok &= first->frame == built - 1 && second->frame == built;
+  // the device is done with the older block, it is built again
+  releaseCommandFrame(first);
+  ok &= buildCommandFrame(frames, mesh, matrix, &third, NULL) == Success && third == first && third->frame == built + 1;
+  releaseCommandFrame(second);
+  releaseCommandFrame(third);
+  if (!ok) {
+    printf("exhaustion: busy blocks not kept\n");
+  }
+  return ok;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  Matrix4 identity;
+  identityMatrix(&identity);
+  srand(24);
+  int failed = 0;
+  uint32_t m;
+  for (m = 0; m < MESHES; ++m) {
+    Mesh mesh;
+    CommandFrames frames;
+    uint32_t lines = 1 + (uint32_t)rand() % MAX_LINES;
+    if (initVertexBuffer(1 + (uint32_t)rand() % 500, &mesh.vertices) != Success
+	|| initIndexBuffer(lines, m % 2 ? Index16 : Index32, &mesh.indices) != Success) {
+      printf("cmd: out of memory\n");
+      return 1;
+    }
+    mesh.topology = NULL;
+    fillMesh(&mesh);
+    if (initCommandFrames(&mesh, &frames) != Success) {
+      printf("cmd: out of memory\n");
+      return 1;
+    }
+    // every frame goes to the next block, each must hold its own records
+    uint32_t f;
+    for (f = 0; f < COMMAND_BUFFERS + 1; ++f) {
+      CommandBuffer * buffer;
+      FrameStats stats;
+      if (buildCommandFrame(&frames, &mesh, &identity, &buffer, &stats) != Success) {
+	printf("cmd: build failed\n");
+	failed = 1;
+	break;
+      }
+      failed |= !checkFrame(&mesh, buffer, &stats);
+      releaseCommandFrame(buffer);
+      fillMesh(&mesh);
+    }
+    failed |= !checkExhaustion(&frames, &mesh, &identity);
+    freeCommandFrames(&frames);
+    free(mesh.vertices.vertices);
+    free(mesh.indices.indices);
+  }
+  printf("cmd: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
@@ -0,0 +1,136 @@
+#include "gfixed.h"
+
+/*! \file fixed.c
+  \brief Test of the fixed point sums.
+  Multiplies matrices and transforms points with elements at and around the ends of the Q16.16 range, where the sum of
+  four 64 bit products no longer fits 64 bits, and compares with the same arithmetic in 128 bits.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/26
+  \copyright GNU Public License.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define ROUNDS 20000                              //!< Random matrices and points.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Random fixed point value, mostly at the ends of the range.
+  \return Random value.
+*/
+static Fixed randomFixed(void) {
+  static const Fixed edges[] = { FIXED_MIN, FIXED_MIN + 1, -FIXED_ONE, 0, FIXED_ONE, FIXED_MAX - 1, FIXED_MAX };
+  int pick = rand() % 4;
+  if (pick == 0) {
+    return edges[rand() % (sizeof(edges) / sizeof(edges[0]))];
+  }
+  uint32_t bits = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+  // small values keep the sums in range, so both sides of saturation are hit
+  return pick == 1 ? (Fixed)bits >> (rand() % 24) : (Fixed)bits;
+}
+
+/*! \brief Rounds a 128 bit Q32.32 sum to Q16.16.
+  \param sum Sum to round.
+  \return Rounded sum, not saturated.
+*/
+static __int128 roundWide(__int128 sum) {
+  return (sum + (1 << (FIXED_SHIFT - 1))) >> FIXED_SHIFT;
+}
+
+/*! \brief Saturates a 128 bit value to the fixed point range.
+  \param value Value to saturate.
+  \return Saturated value.
+*/
+static Fixed saturateWide(__int128 value) {
+  return value > FIXED_MAX ? FIXED_MAX : value < FIXED_MIN ? FIXED_MIN : (Fixed)value;
+}
+
+/*! \brief Checks 'multiplyMatrixFixed' against 128 bit sums.
+  \param a Pointer to left matrix.
+  \param b Pointer to right matrix.
+  \return 1 when every element matches, else 0.
+*/
+static int8_t checkMultiply(Matrix4Fixed const * a, Matrix4Fixed const * b) {
+  Matrix4Fixed out;
+  multiplyMatrixFixed(a, b, &out);
+  int row, column, k;
+  for (row = 0; row < 4; ++row) {
+    for (column = 0; column < 4; ++column) {
+      __int128 sum = 0;
+      for (k = 0; k < 4; ++k) {
+	sum += (__int128)a->m[row * 4 + k] * b->m[k * 4 + column];
+      }
+      Fixed expected = saturateWide(roundWide(sum));
+      if (out.m[row * 4 + column] != expected) {
+	printf("multiplyMatrixFixed: element %d is %d, expected %d\n", row * 4 + column, out.m[row * 4 + column], expected);
+	return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+/*! \brief Checks 'transformVectorFixed' against 128 bit sums.
+  \param m Pointer to matrix.
+  \param v Point to transform.
+  \return 1 when the point matches, else 0.
+*/
+static int8_t checkTransform(Matrix4Fixed const * m, VectorFixed v) {
+  VectorFixed out = transformVectorFixed(m, v);
+  __int128 row[4];
+  int i;
+  for (i = 0; i < 4; ++i) {
+    row[i] = roundWide((__int128)m->m[i * 4] * v.x + (__int128)m->m[i * 4 + 1] * v.y + (__int128)m->m[i * 4 + 2] * v.z
+		       + (__int128)m->m[i * 4 + 3] * FIXED_ONE);
+  }
+  // the divide as documented: one rounded Q32 reciprocal of w
+  __int128 w = row[3] ? row[3] : 1;
+  __int128 magnitude = w < 0 ? -w : w;
+  __int128 inverse = (((__int128)1 << 48) + magnitude / 2) / magnitude;
+  inverse = w < 0 ? -inverse : inverse;
+  Fixed expected[3];
+  for (i = 0; i < 3; ++i) {
+    expected[i] = saturateWide((row[i] * inverse + ((__int128)1 << 31)) >> 32);
+  }
+  if (out.x != expected[0] || out.y != expected[1] || out.z != expected[2]) {
+    printf("transformVectorFixed: (%d, %d, %d), expected (%d, %d, %d)\n", out.x, out.y, out.z, expected[0], expected[1], expected[2]);
+    return 0;
+  }
+  return 1;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  srand(17);
+  int failed = 0;
+  Matrix4Fixed a, b;
+  int i, k;
+  // four products of -32768 * -32768 sum to 2^64, which wraps to 0 in 64 bits
+  for (k = 0; k < 16; ++k) {
+    a.m[k] = FIXED_MIN;
+    b.m[k] = FIXED_MIN;
+  }
+  failed |= !checkMultiply(&a, &b);
+  VectorFixed corner = { FIXED_MIN, FIXED_MIN, FIXED_MIN };
+  a.m[12] = a.m[13] = a.m[14] = 0;
+  a.m[15] = FIXED_ONE;
+  failed |= !checkTransform(&a, corner);
+  for (i = 0; i < ROUNDS && !failed; ++i) {
+    for (k = 0; k < 16; ++k) {
+      a.m[k] = randomFixed();
+      b.m[k] = randomFixed();
+    }
+    VectorFixed v = { randomFixed(), randomFixed(), randomFixed() };
+    failed |= !checkMultiply(&a, &b);
+    failed |= !checkTransform(&a, v);
+  }
+  printf("fixed: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
@@ -0,0 +1,224 @@
+#include "meshfile.h"
+
+/*! \file meshfile.c
+  \brief Test of the binary mesh files.
+  Writes a mesh with 'writeMeshFile' and loads it back with 'loadMeshFile', then flips every byte of the file in turn,
+  each flip must be rejected. The cache of 'loadWavefrontCached' must regenerate after a change that keeps the size of the
+  source, and must be hit after the source is only touched.
+  \author cxnf
+  \version 0.1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include "parser.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Writes a text file.
+  \param path Path of the file.
+  \param text Contents of the file.
+  \param time Modification time in seconds since the epoch.
+  \return 1 on success, else 0.
+*/
+static int8_t writeText(char const * path, char const * text, time_t time) {
+  FILE * file = fopen(path, "wb");
+  if (!file) {
+    return 0;
+  }
+  int8_t ok = fputs(text, file) >= 0;
+  ok = !fclose(file) && ok;
+  struct timespec times[2] = { { time, 0 }, { time, 0 } };
+  return ok && !utimensat(AT_FDCWD, path, times, 0);
+}
+
+/*! \brief Compares two meshes.
+  \param a Pointer to mesh.
+  \param b Pointer to mesh.
+  \return 1 when the vertex and index buffers are identical, else 0.
+*/
+static int8_t sameMesh(Mesh const * a, Mesh const * b) {
+  size_t indexSize = a->indices.width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  return a->vertices.size == b->vertices.size && a->indices.size == b->indices.size && a->indices.width == b->indices.width
+    && (!a->vertices.size || !memcmp(a->vertices.vertices, b->vertices.vertices, sizeof(Vertex) * a->vertices.size))
+    && (!a->indices.size || !memcmp(a->indices.indices, b->indices.indices, indexSize * a->indices.size));
+}
+
+/*! \brief Writes a mesh, loads it back and compares.
+  \param path Path of the binary mesh.
+  \param mesh Pointer to mesh.
+  \param source Pointer to description of the source.
+  \return 1 when the loaded mesh and description equal the written ones, else 0.
+*/
+static int8_t roundTrip(char const * path, Mesh const * mesh, MeshSource const * source) {
+  Mesh loaded;
+  MeshFile file;
+  MeshSource read;
+  if (writeMeshFile(path, mesh, source) != Success || loadMeshFile(path, &loaded, &file, &read) != Success) {
+    printf("round trip: write or load failed\n");
+    return 0;
+  }
+  int8_t ok = sameMesh(mesh, &loaded) && file.base && !memcmp(source, &read, sizeof(MeshSource));
+  if (!ok) {
+    printf("round trip: mesh or source differs\n");
+  }
+  closeMeshFile(&file, &loaded);
+  return ok;
+}
+
+/*! \brief Flips every byte of a binary mesh in turn.
+  \param path Path of the binary mesh.
+  \return 1 when every flip is rejected with InvalidBuffer and the restored file loads again, else 0.
+*/
+static int8_t flipBytes(char const * path) {
+  FILE * file = fopen(path, "r+b");
+  if (!file) {
+    return 0;
+  }
+  int8_t ok = 1;
+  long size = fseek(file, 0, SEEK_END) ? -1 : ftell(file);
+  long at;
+  for (at = 0; at < size && ok; ++at) {
+    int c;
+    fseek(file, at, SEEK_SET);
+    c = fgetc(file);
+    fseek(file, at, SEEK_SET);
+    fputc(c ^ 0x10, file);
+    fflush(file);
+    Mesh mesh;
+    MeshFile mapping;
+    enum codes result = loadMeshFile(path, &mesh, &mapping, NULL);
+    if (result != InvalidBuffer) {
+      printf("flipped byte %ld: load returned %d\n", at, result);
+      if (result == Success) {
+	closeMeshFile(&mapping, &mesh);
+      }
+      ok = 0;
+    }
+    fseek(file, at, SEEK_SET);
+    fputc(c, file);
+    fflush(file);
+  }
+  fclose(file);
+  Mesh mesh;
+  MeshFile mapping;
+  if (size <= 0 || loadMeshFile(path, &mesh, &mapping, NULL) != Success) {
+    printf("restored file does not load\n");
+    return 0;
+  }
+  closeMeshFile(&mapping, &mesh);
+  return ok;
+}
+
+/*! \brief Loads through the cache and compares with a mesh.
+  \param name Name of the step.
+  \param path Path to wavefront file.
+  \param cachePath Path of the binary mesh.
+  \param expected Pointer to mesh the load must give.
+  \return 1 when the cached load gives 'expected' from the mapped cache, else 0.
+*/
+static int8_t checkCached(char const * name, char const * path, char const * cachePath, Mesh const * expected) {
+  Mesh mesh;
+  MeshFile file;
+  if (loadWavefrontCached(path, cachePath, LFNone, &mesh, &file) != Success) {
+    printf("%s: cached load failed\n", name);
+    return 0;
+  }
+  int8_t ok = sameMesh(expected, &mesh) && file.base;
+  if (!ok) {
+    printf("%s: wrong mesh\n", name);
+  }
+  closeMeshFile(&file, &mesh);
+  return ok;
+}
+
+/*! \brief Reads the source description stored in a binary mesh.
+  \param cachePath Path of the binary mesh.
+  \param source Pointer to receive the description.
+  \return 1 on success, else 0.
+*/
+static int8_t readSource(char const * cachePath, MeshSource * source) {
+  Mesh mesh;
+  MeshFile file;
+  if (loadMeshFile(cachePath, &mesh, &file, source) != Success) {
+    return 0;
+  }
+  closeMeshFile(&file, &mesh);
+  return 1;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  static char const text[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n";
+  // same size, one coordinate differs
+  static char const changed[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 5\nf 1 2 3 4\n";
+  char path[] = "/tmp/meshfileXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    printf("meshfile: can not create a file\n");
+    return 1;
+  }
+  close(fd);
+  char cachePath[sizeof(path) + 4];
+  snprintf(cachePath, sizeof(cachePath), "%s.bin", path);
+
+  int failed = 0;
+  Mesh original, modified, sentinel;
+  if (!writeText(path, changed, 1000000000) || loadWavefront(path, LFNone, &modified) != Success
+      || !writeText(path, text, 1000000000) || loadWavefront(path, LFNone, &original) != Success
+      || loadWavefront(path, LFNone, &sentinel) != Success) {
+    printf("meshfile: can not load the wavefront\n");
+    unlink(path);
+    return 1;
+  }
+  // a mesh the text can not give, it can only come from the cache
+  sentinel.vertices.vertices[0].coord.x = 42.0f;
+
+  MeshSource source = { sizeof(text) - 1, 1000000000ll * 1000000000ll, 0x0123456789ABCDEFull, LFNone };
+  failed |= !roundTrip(cachePath, &original, &source);
+  failed |= !flipBytes(cachePath);
+  Mesh empty = { { NULL, 0 }, { { NULL }, 0, Index16 }, NULL };
+  failed |= !roundTrip(cachePath, &empty, &source);
+
+  // the first cached load generates the cache, the description of the source holds its hash
+  unlink(cachePath);
+  MeshSource described;
+  failed |= !checkCached("generate", path, cachePath, &original);
+  if (!readSource(cachePath, &described) || described.size != sizeof(text) - 1 || described.time != source.time) {
+    printf("generate: source not described\n");
+    failed = 1;
+  }
+
+  // touched: size and hash match, the cache is used and takes the new time
+  described.time -= 1000000000;
+  writeMeshFile(cachePath, &sentinel, &described);
+  failed |= !writeText(path, text, 1000000001);
+  failed |= !checkCached("touch", path, cachePath, &sentinel);
+  if (!readSource(cachePath, &described) || described.time != 1000000001ll * 1000000000ll) {
+    printf("touch: new time not stored\n");
+    failed = 1;
+  }
+  failed |= !checkCached("touch again", path, cachePath, &sentinel);
+
+  // changed with the same size: the hash differs, the cache is regenerated from the text
+  failed |= !writeText(path, changed, 1000000002);
+  failed |= !checkCached("same size change", path, cachePath, &modified);
+  failed |= !checkCached("regenerated", path, cachePath, &modified);
+
+  destroyWavefront(&original);
+  destroyWavefront(&modified);
+  destroyWavefront(&sentinel);
+  unlink(cachePath);
+  unlink(path);
+  printf("meshfile: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
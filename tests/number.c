@@ -0,0 +1,49 @@
+#include "cnumber.h"
+
+/*! \file number.c
+  \brief Test of the number conversions.
+  Converts texts at the edges of the Q16.16 range with 'readFixed', values that do not fit must be rejected instead of wrapping.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+
+// ----------------- Test -------------------------------------------------
+
+int main(void) {
+  static const struct { const char * text; int8_t ok; int32_t value; } cases[] = {
+    { "0", 1, 0 },
+    { "1.5", 1, 0x18000 },
+    { "-0.5", 1, -0x8000 },
+    { "32767", 1, 0x7FFF0000 },
+    { "32767.99999", 1, 0x7FFFFFFF },
+    { "32768", 0, 0 },
+    { "-32768", 1, INT32_MIN },
+    { "-32769", 0, 0 },
+    { "3.2768e4", 0, 0 },
+    { "-3.2768e4", 1, INT32_MIN },
+    // 2^48, 2^64 - 1 and beyond, the mantissa would wrap in the shift to Q16.16
+    { "281474976710656", 0, 0 },
+    { "-281474976710656", 0, 0 },
+    { "18446744073709551615", 0, 0 },
+    { "184467440737095516150000", 0, 0 },
+    { "1e30", 0, 0 },
+  };
+  int failed = 0;
+  uint32_t i;
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    int32_t value = 0;
+    int8_t ok = readFixed(cases[i].text, strlen(cases[i].text), &value);
+    if (ok != cases[i].ok || (ok && value != cases[i].value)) {
+      printf("readFixed(%s): %d 0x%08X, expected %d 0x%08X\n", cases[i].text, ok, (unsigned)value, cases[i].ok, (unsigned)cases[i].value);
+      failed = 1;
+    }
+  }
+  printf("number: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
@@ -0,0 +1,164 @@
+#include "gpack.h"
+
+/*! \file pack.c
+  \brief Test of the quantization error.
+  Quantizes random and edge case vertex buffers and checks 'measurePackError' against the bound documented by
+  'packVertexBuffer': half a step on every axis plus the float rounding of the restored coordinate.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/27
+  \copyright GNU Public License.
+*/
+
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define RANDOM_BUFFERS 200                        //!< Random vertex buffers.
+#define MAX_VERTICES 5000                         //!< Largest vertex buffer.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Random float in a range.
+  \param min Minimum.
+  \param max Maximum.
+  \return Random value in [min, max].
+*/
+static float randomRange(float min, float max) {
+  return (float)(min + ((double)max - min) * rand() / RAND_MAX);
+}
+
+/*! \brief Checks the error on one axis.
+  \param name Name of the buffer.
+  \param axis Name of the axis.
+  \param error Measured error.
+  \param min Minimum of the axis.
+  \param max Maximum of the axis.
+  \param scale Step of the axis.
+  \return 1 when the error is within the bound, else 0.
+*/
+static int8_t checkAxis(char const * name, char axis, float error, float min, float max, float scale) {
+  double extent = (double)max - min;
+  // restoring rounds the step, the product and the sum to float
+  double rounding = FLT_EPSILON * (extent + fmax(fabs(min), fabs(max)));
+  double bound = extent / (2.0 * PACK_STEPS) + rounding;
+  // a flat axis has no steps, its coordinates are stored exactly
+  if (extent == 0.0 && (scale != 0.0f || error != 0.0f)) {
+    printf("%s: flat %c axis has step %g error %g\n", name, axis, scale, error);
+    return 0;
+  }
+  if (!(error <= bound)) {
+    printf("%s: %c error %g exceeds bound %g\n", name, axis, error, bound);
+    return 0;
+  }
+  return 1;
+}
+
+/*! \brief Quantizes a vertex buffer and checks the error against the bound.
+  \param name Name of the buffer.
+  \param vb Pointer to vertex buffer.
+  \return 1 when within the bound, else 0.
+*/
+static int8_t checkBuffer(char const * name, VertexBuffer const * vb) {
+  VertexBufferPacked packed;
+  Vector error;
+  if (initVertexBufferPacked(vb->size, &packed) != Success) {
+    printf("%s: out of memory\n", name);
+    return 0;
+  }
+  if (packVertexBuffer(vb, &packed) != Success || measurePackError(vb, &packed, &error) != Success) {
+    printf("%s: pack failed\n", name);
+    freeVertexBufferPacked(&packed);
+    return 0;
+  }
+  Vector min = {0.0f, 0.0f, 0.0f};
+  Vector max = {0.0f, 0.0f, 0.0f};
+  uint32_t i;
+  for (i = 0; i < vb->size; ++i) {
+    Vector v = vb->vertices[i].coord;
+    min.x = i == 0 || v.x < min.x ? v.x : min.x;
+    min.y = i == 0 || v.y < min.y ? v.y : min.y;
+    min.z = i == 0 || v.z < min.z ? v.z : min.z;
+    max.x = i == 0 || v.x > max.x ? v.x : max.x;
+    max.y = i == 0 || v.y > max.y ? v.y : max.y;
+    max.z = i == 0 || v.z > max.z ? v.z : max.z;
+  }
+  Vector scale = packed.quantization.scale;
+  int8_t ok = checkAxis(name, 'x', error.x, min.x, max.x, scale.x)
+    && checkAxis(name, 'y', error.y, min.y, max.y, scale.y)
+    && checkAxis(name, 'z', error.z, min.z, max.z, scale.z);
+  freeVertexBufferPacked(&packed);
+  return ok;
+}
+
+/*! \brief Fills a vertex buffer with random coordinates.
+  \param vb Pointer to vertex buffer.
+  \param min Minimum of every axis.
+  \param max Maximum of every axis.
+*/
+static void fillRandom(VertexBuffer * vb, Vector min, Vector max) {
+  uint32_t i;
+  for (i = 0; i < vb->size; ++i) {
+    vb->vertices[i].coord.x = randomRange(min.x, max.x);
+    vb->vertices[i].coord.y = randomRange(min.y, max.y);
+    vb->vertices[i].coord.z = randomRange(min.z, max.z);
+    vb->vertices[i].color = (Color)rand();
+  }
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  // zero extent axes, a single point, extents far below and far above the magnitude of the coordinates
+  static const struct { char const * name; uint32_t size; Vector min, max; } edges[] = {
+    { "empty", 0, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f} },
+    { "single vertex", 1, {3.5f, -2.0f, 7.25f}, {3.5f, -2.0f, 7.25f} },
+    { "flat x", 100, {4.0f, -1.0f, -1.0f}, {4.0f, 1.0f, 1.0f} },
+    { "flat y", 100, {-1.0f, 0.0f, -1.0f}, {1.0f, 0.0f, 1.0f} },
+    { "flat z", 100, {-1.0f, -1.0f, -9.0f}, {1.0f, 1.0f, -9.0f} },
+    { "flat xz", 100, {2.0f, -1.0f, 0.5f}, {2.0f, 1.0f, 0.5f} },
+    { "all flat", 100, {-6.0f, 6.0f, 1e20f}, {-6.0f, 6.0f, 1e20f} },
+    { "far offset", 1000, {1e6f, -1e6f, 1e6f}, {1e6f + 1.0f, -1e6f + 1.0f, 1e6f + 1.0f} },
+    { "tiny extent", 1000, {-1e-20f, -1e-20f, 1e-30f}, {1e-20f, 1e-20f, 2e-30f} },
+    { "huge extent", 1000, {-1e30f, -1e30f, 0.0f}, {1e30f, 1e30f, 1e30f} },
+  };
+  VertexBuffer vb;
+  if (initVertexBuffer(MAX_VERTICES, &vb) != Success) {
+    printf("pack: out of memory\n");
+    return 1;
+  }
+  uint32_t capacity = vb.size;
+  srand(18);
+
+  int failed = 0;
+  uint32_t i;
+  for (i = 0; i < sizeof(edges) / sizeof(edges[0]); ++i) {
+    vb.size = edges[i].size;
+    fillRandom(&vb, edges[i].min, edges[i].max);
+    // the corners of the bounding box land on the first and the last step
+    if (vb.size >= 2) {
+      vb.vertices[0].coord = edges[i].min;
+      vb.vertices[1].coord = edges[i].max;
+    }
+    failed |= !checkBuffer(edges[i].name, &vb);
+  }
+  for (i = 0; i < RANDOM_BUFFERS; ++i) {
+    float magnitude = powf(10.0f, (float)(rand() % 13 - 6));
+    Vector center = {randomRange(-magnitude, magnitude), randomRange(-magnitude, magnitude), randomRange(-magnitude, magnitude)};
+    Vector half = {randomRange(0.0f, magnitude), randomRange(0.0f, magnitude), randomRange(0.0f, magnitude)};
+    Vector min = {center.x - half.x, center.y - half.y, center.z - half.z};
+    Vector max = {center.x + half.x, center.y + half.y, center.z + half.z};
+    vb.size = 1 + rand() % capacity;
+    fillRandom(&vb, min, max);
+    failed |= !checkBuffer("random", &vb);
+  }
+  vb.size = capacity;
+  free(vb.vertices);
+  printf("pack: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
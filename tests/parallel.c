@@ -0,0 +1,162 @@
+#include "parser.h"
+
+/*! \file parallel.c
+  \brief Test of the parallel loader.
+  Loads wavefronts with 'loadWavefront' and with 'loadWavefrontParallel' at several thread counts, the vertex and index
+  buffers must be identical. The wavefronts are large enough to be split, and hold CRLF line ends, comments, relative
+  indices, a missing final line end and faces referring to vertices not defined before them.
+  \author cxnf
+  \version 0.1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define ROWS 540                                  //!< Rows of the grid, about 4.4 MB of text so up to 4 threads get a chunk.
+#define COLUMNS 200                               //!< Vertices per row of the grid.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Writes a grid as wavefront.
+  Every row of vertices is followed by the quads to the row before it, alternately with absolute and relative indices.
+  \param path Path of the file.
+  \param crlf 1 for CRLF line ends.
+  \param finalNewline 0 to leave out the line end of the last line.
+  \param forward Row after which a face refers to a vertex that is not defined yet, 0 for none.
+  \return 1 on success, else 0.
+*/
+static int8_t writeGrid(char const * path, int8_t crlf, int8_t finalNewline, uint32_t forward) {
+  FILE * file = fopen(path, "wb");
+  if (!file) {
+    return 0;
+  }
+  char const * eol = crlf ? "\r\n" : "\n";
+  uint32_t row, column;
+  fprintf(file, "# grid of %u by %u%s", ROWS, COLUMNS, eol);
+  for (row = 0; row < ROWS; ++row) {
+    for (column = 0; column < COLUMNS; ++column) {
+      fprintf(file, "v %u.%03u %u -%u.5%s", column, row % 1000, row, column % 7, eol);
+    }
+    if (row % 10 == 0) {
+      fprintf(file, "# row %u%s#v 1 2 3%s", row, eol, eol);
+    }
+    for (column = 0; row && column + 1 < COLUMNS; ++column) {
+      uint32_t a = (row - 1) * COLUMNS + column + 1;
+      if (column % 2) {
+	fprintf(file, "f %u %u %u %u%s", a, a + 1, a + COLUMNS + 1, a + COLUMNS, eol);
+      } else {
+	// relative to the last vertex of the row
+	int32_t last = (int32_t)((row + 1) * COLUMNS);
+	fprintf(file, "f %d %d %d%s", (int32_t)a - last - 1, (int32_t)a - last, (int32_t)(a + COLUMNS) - last - 1, eol);
+      }
+    }
+    if (forward && row == forward) {
+      fprintf(file, "f 1 %u%s", (row + 2) * COLUMNS, eol);
+    }
+  }
+  fprintf(file, "f 1 2 3%s", finalNewline ? eol : "");
+  return fclose(file) == 0;
+}
+
+/*! \brief Compares the meshes of two loads.
+  \param a Pointer to mesh.
+  \param b Pointer to mesh.
+  \return 1 when the vertex and index buffers are identical, else 0.
+*/
+static int8_t sameMesh(Mesh const * a, Mesh const * b) {
+  size_t indexSize = a->indices.width == Index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  return a->vertices.size == b->vertices.size && a->indices.size == b->indices.size && a->indices.width == b->indices.width
+    && (!a->vertices.size || !memcmp(a->vertices.vertices, b->vertices.vertices, sizeof(Vertex) * a->vertices.size))
+    && (!a->indices.size || !memcmp(a->indices.indices, b->indices.indices, indexSize * a->indices.size));
+}
+
+/*! \brief Loads a wavefront serially and in parallel and compares the results.
+  \param name Name of the wavefront.
+  \param path Path of the wavefront.
+  \param flags Combination of LoadFlags.
+  \param expected Expected result of the serial load.
+  \return 1 when every thread count gives the result of the serial load, else 0.
+*/
+static int8_t compareLoads(char const * name, char const * path, uint32_t flags, enum codes expected) {
+  static const uint32_t threads[] = { 1, 2, 3, 4, 7, 0 };
+  Mesh serial;
+  enum codes result = loadWavefront(path, flags, &serial);
+  if (result != expected) {
+    fprintf(stderr, "%s: serial load returned %d, expected %d\n", name, result, expected);
+    if (result == Success) {
+      destroyWavefront(&serial);
+    }
+    return 0;
+  }
+  int8_t ok = 1;
+  uint32_t i;
+  for (i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+    Mesh parallel;
+    result = loadWavefrontParallel(path, threads[i], flags, &parallel);
+    if (result != expected) {
+      fprintf(stderr, "%s: %u threads returned %d, expected %d\n", name, threads[i], result, expected);
+      ok = 0;
+    } else if (result == Success && !sameMesh(&serial, &parallel)) {
+      fprintf(stderr, "%s: %u threads differ from the serial load\n", name, threads[i]);
+      ok = 0;
+    }
+    if (result == Success) {
+      destroyWavefront(&parallel);
+    }
+  }
+  if (expected == Success) {
+    destroyWavefront(&serial);
+  }
+  return ok;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  static const struct { char const * name; int8_t crlf, finalNewline; uint32_t forward; enum codes expected; } inputs[] = {
+    { "LF", 0, 1, 0, Success },
+    { "CRLF", 1, 1, 0, Success },
+    { "no final line end", 0, 0, 0, Success },
+    { "CRLF without final line end", 1, 0, 0, Success },
+    { "forward reference", 0, 1, ROWS * 3 / 4, InvalidBuffer },
+    { "forward reference CRLF", 1, 0, ROWS / 5, InvalidBuffer },
+  };
+  char path[] = "/tmp/parallelXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    printf("parallel: can not create a file\n");
+    return 1;
+  }
+  close(fd);
+
+  // the parser reports the invalid faces on stdout
+  fflush(stdout);
+  int out = dup(1), null = open("/dev/null", O_WRONLY);
+  dup2(null, 1);
+  int failed = 0;
+  uint32_t i;
+  for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    if (!writeGrid(path, inputs[i].crlf, inputs[i].finalNewline, inputs[i].forward)) {
+      fprintf(stderr, "%s: can not write the grid\n", inputs[i].name);
+      failed = 1;
+      continue;
+    }
+    failed |= !compareLoads(inputs[i].name, path, LFNone, inputs[i].expected);
+    failed |= !compareLoads(inputs[i].name, path, LFDedupLines, inputs[i].expected);
+  }
+  fflush(stdout);
+  dup2(out, 1);
+  close(out);
+  close(null);
+  unlink(path);
+  printf("parallel: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
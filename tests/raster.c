@@ -0,0 +1,140 @@
+#include "graster.h"
+
+/*! \file raster.c
+  \brief Test of the clipped line drawing.
+  Draws random lines with 'drawLine' and compares them with a reference that walks every pixel of the unclipped line by
+  the formula of graster.h and keeps the pixels inside the framebuffer. Lines run from inside to far off screen, up to
+  the 16 bit extremes and to RASTER_LIMIT, on framebuffers from 1 x 1 pixel up.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define GUARD 64                                  //!< Pixels before and after the framebuffer that must stay untouched.
+#define NEAR_LINES 20000                          //!< Lines with end points around the framebuffer, per framebuffer.
+#define FAR_LINES 300                             //!< Lines with end points up to the 16 bit extremes, per framebuffer.
+#define LIMIT_LINES 1                             //!< Lines with end points at RASTER_LIMIT, per framebuffer.
+#define COLOR 0xFFFF                              //!< Color of the lines, the framebuffer is cleared to 0.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Random integer in a range.
+  \param min Minimum.
+  \param max Maximum.
+  \return Random value in [min, max].
+*/
+static int32_t randomRange(int32_t min, int32_t max) {
+  uint64_t r = ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+  return (int32_t)(min + (int64_t)(r % ((uint64_t)((int64_t)max - min) + 1)));
+}
+
+/*! \brief Floor of a division by a positive divisor.
+  \param a Dividend.
+  \param b Divisor, greater than 0.
+  \return Floor of a / b.
+*/
+static int64_t floorDivide(int64_t a, int64_t b) {
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/*! \brief Draws a line and compares it with the reference.
+  The reference walks all pixels of the unclipped line, pixel i being (x0 + i * sign(dx), y0 + sign(dy) * floor((2 * i * |dy| + |dx|) / (2 * |dx|)))
+  for an x major line. Those inside the framebuffer must be exactly the pixels written.
+  \param fb Pointer to framebuffer, cleared to 0, with GUARD pixels of 0 before and after.
+  \param x0 X of the first end point.
+  \param y0 Y of the first end point.
+  \param x1 X of the second end point.
+  \param y1 Y of the second end point.
+  \return 1 when the line matches the reference, else 0. The framebuffer is cleared again either way.
+*/
+static int8_t checkLine(Framebuffer * fb, int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+  uint32_t drawn = drawLine(fb, x0, y0, x1, y1, COLOR);
+  int64_t ax = x1 > x0 ? (int64_t)x1 - x0 : (int64_t)x0 - x1;
+  int64_t ay = y1 > y0 ? (int64_t)y1 - y0 : (int64_t)y0 - y1;
+  int64_t sx = x1 < x0 ? -1 : 1, sy = y1 < y0 ? -1 : 1;
+  int8_t xMajor = ax >= ay;
+  int64_t am = xMajor ? ax : ay, an = xMajor ? ay : ax;
+  uint32_t inside = 0;
+  int8_t ok = 1;
+  int64_t i;
+  for (i = 0; i <= am; ++i) {
+    int64_t q = am ? floorDivide(2 * i * an + am, 2 * am) : 0;
+    int64_t x = xMajor ? x0 + sx * i : x0 + sx * q;
+    int64_t y = xMajor ? y0 + sy * q : y0 + sy * i;
+    if (x < 0 || x >= fb->width || y < 0 || y >= fb->height) {
+      continue;
+    }
+    // every pixel of the reference is written, with as many pixels written as in the reference none else is
+    Color * p = &fb->pixels[y * fb->width + x];
+    ok &= *p == COLOR;
+    *p = 0;
+    ++inside;
+  }
+  ok &= drawn == inside;
+  uint32_t j;
+  for (j = 0; j < GUARD; ++j) {
+    ok &= fb->pixels[-1 - (int32_t)j] == 0 && fb->pixels[(uint32_t)fb->width * fb->height + j] == 0;
+  }
+  if (!ok) {
+    printf("%u x %u: line (%d, %d) - (%d, %d) draws %u pixels, the reference %u\n", fb->width, fb->height, x0, y0, x1, y1, drawn, inside);
+    memset(fb->pixels - GUARD, 0, sizeof(Color) * ((size_t)fb->width * fb->height + 2 * GUARD));
+  }
+  return ok;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  static const uint16_t sizes[][2] = { { 1, 1 }, { 1, 9 }, { 9, 1 }, { 7, 3 }, { 64, 32 }, { 100, 61 }, { 257, 129 } };
+  static const int32_t extremes[] = { INT16_MIN, INT16_MIN + 1, -1, 0, 1, INT16_MAX - 1, INT16_MAX };
+  srand(21);
+  int failed = 0;
+  uint32_t s, i, j;
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    Color * memory = (Color *)calloc((size_t)sizes[s][0] * sizes[s][1] + 2 * GUARD, sizeof(Color));
+    if (!memory) {
+      printf("raster: out of memory\n");
+      return 1;
+    }
+    Framebuffer fb = { memory + GUARD, sizes[s][0], sizes[s][1] };
+    int32_t w = fb.width, h = fb.height;
+    for (i = 0; i < NEAR_LINES; ++i) {
+      // end points on screen, just off it and a few screens away
+      int32_t reach = i % 3 == 0 ? 2 : i % 3 == 1 ? 8 : 64;
+      failed |= !checkLine(&fb, randomRange(-reach, w + reach), randomRange(-reach, h + reach),
+			   randomRange(-reach * w - reach, (reach + 1) * w + reach), randomRange(-reach * h - reach, (reach + 1) * h + reach));
+    }
+    for (i = 0; i < FAR_LINES; ++i) {
+      failed |= !checkLine(&fb, randomRange(INT16_MIN, INT16_MAX), randomRange(INT16_MIN, INT16_MAX),
+			   randomRange(INT16_MIN, INT16_MAX), randomRange(INT16_MIN, INT16_MAX));
+    }
+    // every pair of extremes and the corners of the screen
+    for (i = 0; i < sizeof(extremes) / sizeof(extremes[0]); ++i) {
+      for (j = 0; j < sizeof(extremes) / sizeof(extremes[0]); ++j) {
+	failed |= !checkLine(&fb, extremes[i], extremes[j], extremes[j], extremes[i]);
+	failed |= !checkLine(&fb, extremes[i], extremes[j], w - 1, h - 1);
+	failed |= !checkLine(&fb, 0, h - 1, extremes[i], extremes[j]);
+      }
+    }
+    for (i = 0; i < LIMIT_LINES; ++i) {
+      failed |= !checkLine(&fb, -RASTER_LIMIT, randomRange(-h, 2 * h), RASTER_LIMIT, randomRange(-RASTER_LIMIT, RASTER_LIMIT));
+    }
+    // beyond the limit nothing is drawn
+    if (drawLine(&fb, 0, 0, RASTER_LIMIT + 1, 0, COLOR) || drawLine(&fb, 0, -RASTER_LIMIT - 1, 0, 0, COLOR)) {
+      printf("%u x %u: line beyond RASTER_LIMIT drawn\n", w, h);
+      failed = 1;
+    }
+    free(memory);
+  }
+  printf("raster: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
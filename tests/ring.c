@@ -0,0 +1,174 @@
+#include "gring.h"
+
+/*! \file ring.c
+  \brief Test of the line command ring.
+  Submits random meshes with 'submitMesh' through a ring of 4 slots to a line unit started with 'startLineUnit', so the
+  positions wrap around many times and the producer stalls. The line unit must draw every submitted command and its
+  framebuffer must hash the same as 'rasterizeMesh' on the same mesh.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+#define CAPACITY 4                                //!< Command slots of the ring, far less than a batch.
+#define SCREEN_WIDTH 320                          //!< Width of the framebuffer in pixels.
+#define SCREEN_HEIGHT 200                         //!< Height of the framebuffer in pixels.
+#define MAX_LINES 3000                            //!< Most lines of a random mesh.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Random float in a range.
+  \param min Minimum.
+  \param max Maximum.
+  \return Random value in [min, max].
+*/
+static float randomRange(float min, float max) {
+  return (float)(min + ((double)max - min) * rand() / RAND_MAX);
+}
+
+/*! \brief Builds a mesh of random lines in screen coordinates.
+  Vertices are on or around the screen, with 'outside' some are beyond the coordinates of a command.
+  \param lines Amount of lines.
+  \param width Index width.
+  \param outside 1 to place some vertices outside 16 bits.
+  \param mesh Pointer to resulting mesh.
+  \return 1 on success, else 0.
+*/
+static int8_t buildMesh(uint32_t lines, enum IndexWidth width, int8_t outside, Mesh * mesh) {
+  uint32_t vertices = 1 + (uint32_t)rand() % 500;
+  if (initVertexBuffer(vertices, &mesh->vertices) != Success) {
+    return 0;
+  }
+  if (initIndexBuffer(lines, width, &mesh->indices) != Success) {
+    free(mesh->vertices.vertices);
+    return 0;
+  }
+  mesh->topology = NULL;
+  uint32_t i;
+  for (i = 0; i < vertices; ++i) {
+    Vector * coord = &mesh->vertices.vertices[i].coord;
+    coord->x = randomRange(-0.5f * SCREEN_WIDTH, 1.5f * SCREEN_WIDTH);
+    coord->y = randomRange(-0.5f * SCREEN_HEIGHT, 1.5f * SCREEN_HEIGHT);
+    coord->z = 0.0f;
+    if (outside && rand() % 10 == 0) {
+      coord->x = rand() % 2 ? 40000.0f : -40000.0f;
+    }
+    mesh->vertices.vertices[i].color = (Color)rand();
+  }
+  for (i = 0; i < mesh->indices.size; ++i) {
+    uint32_t index = (uint32_t)rand() % vertices;
+    if (width == Index16) {
+      mesh->indices.indices[i] = (uint16_t)index;
+    } else {
+      mesh->indices.indices32[i] = index;
+    }
+  }
+  return 1;
+}
+
+/*! \brief Submits a mesh to a line unit in a child process.
+  \param name Name of the ring.
+  \param mesh Pointer to mesh.
+  \param submitted Pointer to receive the counts of the producer.
+  \param drawn Pointer to receive the counts of the line unit.
+  \return 1 when the ring and the line unit ran, else 0.
+*/
+static int8_t runRing(char const * name, Mesh const * mesh, SubmitStats * submitted, LineUnitStats * drawn) {
+  CommandRing ring;
+  pid_t pid;
+  if (createCommandRing(name, CAPACITY, SCREEN_WIDTH, SCREEN_HEIGHT, &ring) != Success) {
+    printf("%s: can not create the ring\n", name);
+    return 0;
+  }
+  int8_t ok = startLineUnit(name, &pid) == Success;
+  if (ok) {
+    ok = submitMesh(&ring, mesh, submitted) == Success;
+    closeCommands(&ring);
+    ok = waitLineUnit(&ring, pid, drawn) == Success && ok;
+  }
+  if (!ok) {
+    printf("%s: line unit failed\n", name);
+  }
+  closeCommandRing(&ring);
+  removeCommandRing(name);
+  return ok;
+}
+
+/*! \brief Submits a mesh and compares the line unit with 'rasterizeMesh'.
+  \param name Name of the ring.
+  \param mesh Pointer to mesh.
+  \param fb Pointer to framebuffer of the screen.
+  \param outside 1 when the mesh has vertices outside 16 bits, only the counts are compared then.
+  \return 1 when every submitted command is drawn and the frames match, else 0.
+*/
+static int8_t checkRing(char const * name, Mesh const * mesh, Framebuffer * fb, int8_t outside) {
+  SubmitStats submitted;
+  LineUnitStats drawn;
+  if (!runRing(name, mesh, &submitted, &drawn)) {
+    return 0;
+  }
+  uint32_t lines = mesh->indices.size / 2;
+  if (drawn.commands != submitted.submitted || submitted.lines != lines || submitted.submitted + submitted.dropped != lines
+      || (!outside && submitted.dropped)) {
+    printf("%u lines: %u submitted %u dropped, %lu drawn\n", lines, submitted.submitted, submitted.dropped, (unsigned long)drawn.commands);
+    return 0;
+  }
+  // more commands than slots, the ring wraps and the producer has to wait
+  if (submitted.submitted > CAPACITY && (!submitted.stalls || drawn.pickups < submitted.submitted / CAPACITY)) {
+    printf("%u commands: %u stalls, %lu pickups\n", submitted.submitted, submitted.stalls, (unsigned long)drawn.pickups);
+    return 0;
+  }
+  // 'rasterizeMesh' draws the lines the ring drops, only meshes inside 16 bits give the same frame
+  if (outside) {
+    return 1;
+  }
+  clearFramebuffer(fb, 0);
+  if (rasterizeMesh(fb, mesh, NULL) != Success) {
+    printf("%u lines: rasterizeMesh failed\n", lines);
+    return 0;
+  }
+  if (drawn.hash != hashFramebuffer(fb)) {
+    printf("%u lines: frame of the line unit differs\n", lines);
+    return 0;
+  }
+  return 1;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  static const uint32_t sizes[] = { 1, CAPACITY - 1, CAPACITY, CAPACITY + 1, 2 * LINE_BATCH + 3, MAX_LINES };
+  char name[32];
+  snprintf(name, sizeof(name), "/gring-test-%ld", (long)getpid());
+  Framebuffer fb;
+  if (initFramebuffer(SCREEN_WIDTH, SCREEN_HEIGHT, &fb) != Success) {
+    printf("ring: out of memory\n");
+    return 1;
+  }
+  srand(23);
+  int failed = 0;
+  uint32_t i;
+  for (i = 0; i < 2 * sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    Mesh mesh;
+    int8_t outside = i % 2;
+    if (!buildMesh(sizes[i / 2], i % 4 < 2 ? Index16 : Index32, outside, &mesh)) {
+      printf("ring: out of memory\n");
+      return 1;
+    }
+    failed |= !checkRing(name, &mesh, &fb, outside);
+    free(mesh.vertices.vertices);
+    free(mesh.indices.indices);
+  }
+  freeFramebuffer(&fb);
+  printf("ring: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
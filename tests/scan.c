@@ -0,0 +1,163 @@
+#include "cscan.h"
+
+/*! \file scan.c
+  \brief Test of the vector scanners.
+  Runs every scan function of the SSE2 and AVX2 scanners on random buffers and compares the result with the scalar scanner.
+  Every length and alignment around the 16 and 32 byte vectors is covered, so the vector tails are hit at every offset.
+  The token streams of 'parseBuffer' are compared as well.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include "cparser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+#define MAX_LENGTH 100                            //!< Longest scanned run, three 32 byte vectors and a tail.
+#define ALIGNMENTS 64                             //!< Alignments of the first character, every offset in two 32 byte vectors.
+#define ROUNDS 8                                  //!< Random buffers per length and alignment.
+#define STREAMS 2000                              //!< Random texts of the token stream comparison.
+#define STREAM_LENGTH 4000                        //!< Longest text of the token stream comparison.
+
+
+// ----------------- Local Function definitions ---------------------------
+
+/*! \brief Fills a buffer with random characters.
+  The density of the characters ending a run differs per call, so runs of every length occur.
+  \param buffer Buffer to fill.
+  \param len Length of 'buffer'.
+*/
+static void fillRandom(char * buffer, size_t len) {
+  // space, line end and digit, the characters the scanners look for or skip
+  static const char special[] = " \t\n\v\f\r0123456789";
+  static const char filler[] = "0123456789abcxyz.-+#/";
+  int density = rand() % 4 == 0 ? 0 : 1 << (rand() % 7);
+  size_t i;
+  for (i = 0; i < len; ++i) {
+    int pick = rand();
+    if (density && pick % 64 < density) {
+      buffer[i] = special[(pick >> 8) % (sizeof(special) - 1)];
+    } else if (pick % 5 == 0) {
+      // every byte value, bytes above 0x7F must not be taken for spaces or digits
+      buffer[i] = (char)(pick >> 8);
+    } else {
+      buffer[i] = filler[(pick >> 8) % (sizeof(filler) - 1)];
+    }
+  }
+}
+
+/*! \brief Compares the scan functions of a scanner with the scalar ones on one run.
+  \param scanner Scanner to test.
+  \param reference Scalar scanner.
+  \param begin First character of the run.
+  \param end End of the run.
+  \return 1 when all functions agree, else 0.
+*/
+static int8_t compareRun(const Scanner * scanner, const Scanner * reference, const char * begin, const char * end) {
+  if (scanner->findSpace(begin, end) != reference->findSpace(begin, end)
+      || scanner->findNewline(begin, end) != reference->findNewline(begin, end)
+      || scanner->skipDigits(begin, end) != reference->skipDigits(begin, end)) {
+    printf("mode %d differs on %d characters at alignment %d\n", scanner->mode, (int)(end - begin), (int)((size_t)begin % ALIGNMENTS));
+    return 0;
+  }
+  return 1;
+}
+
+/*! \brief Hashes a token into a stream hash.
+  \param type Type of the token.
+  \param token The token.
+  \param user Pointer to the FNV-1a hash of the stream.
+  \return 1 to continue parsing.
+*/
+static int8_t hashToken(enum TokenType type, Token token, void * user) {
+  uint64_t * hash = (uint64_t *)user;
+  uint32_t i;
+  *hash = (*hash ^ (uint64_t)type) * 1099511628211ull;
+  *hash = (*hash ^ token.length) * 1099511628211ull;
+  for (i = 0; i < token.length; ++i) {
+    *hash = (*hash ^ (uint8_t)token.text[i]) * 1099511628211ull;
+  }
+  return 1;
+}
+
+/*! \brief Hashes the token stream of a text.
+  \param mode Scanner to tokenize with.
+  \param text Text to tokenize.
+  \param len Length of 'text'.
+  \return Hash of the token stream and the parse result.
+*/
+static uint64_t hashStream(enum ScanMode mode, const char * text, size_t len) {
+  uint64_t hash = 14695981039346656037ull;
+  selectScanner(mode);
+  enum ParseResults result = parseBuffer(text, len, hashToken, &hash);
+  return (hash ^ (uint64_t)result) * 1099511628211ull;
+}
+
+
+// ----------------- Test -------------------------------------------------
+
+int main(void) {
+  static const enum ScanMode modes[] = { SMSSE2, SMAVX2 };
+  // aligned, so an offset into the buffer is the alignment of the run
+  static char buffer[ALIGNMENTS + MAX_LENGTH + 64] __attribute__((aligned(ALIGNMENTS)));
+  static char text[STREAM_LENGTH];
+  srand(9);
+
+  selectScanner(SMScalar);
+  Scanner reference = *getScanner();
+  int failed = 0;
+  uint32_t m;
+  for (m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+    if (!selectScanner(modes[m])) {
+      printf("mode %d not supported, skipped\n", modes[m]);
+      continue;
+    }
+    Scanner scanner = *getScanner();
+    uint32_t runs = 0;
+    uint32_t length, alignment, round;
+    for (length = 0; length <= MAX_LENGTH; ++length) {
+      for (alignment = 0; alignment < ALIGNMENTS; ++alignment) {
+	for (round = 0; round < ROUNDS; ++round) {
+	  // a line end behind the run ends every run, a scanner reading past 'end' returns a wrong position
+	  fillRandom(buffer, sizeof(buffer));
+	  memset(buffer + alignment + length, '\n', sizeof(buffer) - alignment - length);
+	  failed |= !compareRun(&scanner, &reference, buffer + alignment, buffer + alignment + length);
+	  // a run without the character looked for, the scan reaches the end
+	  memset(buffer + alignment, 'a', length);
+	  failed |= !compareRun(&scanner, &reference, buffer + alignment, buffer + alignment + length);
+	  memset(buffer + alignment, '7', length);
+	  failed |= !compareRun(&scanner, &reference, buffer + alignment, buffer + alignment + length);
+	  runs += 3;
+	}
+      }
+    }
+
+    // the tokenizer reports invalid tokens of the random texts on stdout
+    fflush(stdout);
+    int out = dup(1), null = open("/dev/null", O_WRONLY);
+    dup2(null, 1);
+    uint32_t streams;
+    for (streams = 0; streams < STREAMS; ++streams) {
+      size_t len = (size_t)(rand() % (streams % 10 ? 300 : STREAM_LENGTH));
+      fillRandom(text, len);
+      if (hashStream(modes[m], text, len) != hashStream(SMScalar, text, len)) {
+	fprintf(stderr, "mode %d token stream differs on %d characters\n", modes[m], (int)len);
+	failed = 1;
+      }
+    }
+    fflush(stdout);
+    dup2(out, 1);
+    close(out);
+    close(null);
+    printf("mode %d: %u runs, %u token streams compared\n", modes[m], runs, streams);
+  }
+  selectScanner(SMAuto);
+  printf("scan: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
@@ -0,0 +1,302 @@
+#include "gstrip.h"
+
+/*! \file strip.c
+  \brief Test of the line strips.
+  Builds strips of random and degenerate line lists with 'buildStrips' and reads them back with 'iterateStripBatches'.
+  Every line must come back exactly once, in its own direction with StripKeepDirection, and the amount of strips must be
+  the minimum 'buildStrips' documents: one per virtual line plus one per component without unbalanced vertices.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define RANDOM_GRAPHS 300                         //!< Random line lists per mode.
+#define MAX_LINES 2000                            //!< Most lines of a random line list.
+#define MAX_VERTICES 70000                        //!< Largest vertex buffer, beyond the 16 bit strips.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \struct Collected
+  \brief Lines read back by 'collectBatch'.
+*/
+typedef struct Collected {
+  Vertex const * base;                            //!< First vertex of the buffer, turns vertex pointers back into indices.
+  uint64_t * lines;                               //!< Lines as first index times 2^32 plus second index.
+  uint32_t count;                                 //!< Amount of lines read back.
+  uint32_t capacity;                              //!< Amount of lines 'lines' holds.
+  int8_t offsets;                                 //!< Cleared when a batch offset does not continue the previous batch.
+} Collected;
+
+/*! \brief Collects the lines of a batch.
+  \param batch Batch of lines.
+  \param user Pointer to Collected.
+*/
+static void collectBatch(LineBatch const * batch, void * user) {
+  Collected * collected = (Collected *)user;
+  uint32_t i;
+  if (batch->offset != collected->count) {
+    collected->offsets = 0;
+  }
+  for (i = 0; i < batch->count && collected->count < collected->capacity; ++i) {
+    uint64_t first = (uint64_t)(batch->first[i] - collected->base);
+    uint64_t second = (uint64_t)(batch->second[i] - collected->base);
+    collected->lines[collected->count++] = first << 32 | second;
+  }
+}
+
+/*! \brief Orders lines for 'qsort'.
+  \param a Pointer to line.
+  \param b Pointer to line.
+  \return Order of the lines.
+*/
+static int compareLines(void const * a, void const * b) {
+  uint64_t x = *(uint64_t const *)a, y = *(uint64_t const *)b;
+  return x < y ? -1 : x > y;
+}
+
+/*! \brief Finds the root of a vertex in a union find forest.
+  \param parent Parent of every vertex.
+  \param v Vertex.
+  \return Root of 'v'.
+*/
+static uint32_t findRoot(uint32_t * parent, uint32_t v) {
+  while (parent[v] != v) {
+    parent[v] = parent[parent[v]];
+    v = parent[v];
+  }
+  return v;
+}
+
+/*! \brief Amount of strips a minimal cover needs.
+  One strip per virtual line, which is the surplus of lines leaving over lines arriving summed over all vertices
+  (half the odd degree vertices without directions), plus one per component of which every vertex is balanced.
+  \param lines Lines, 2 indices each.
+  \param count Amount of lines.
+  \param vertices Amount of vertices.
+  \param mode Lines that may be chained.
+  \return Amount of strips.
+*/
+static uint64_t expectedStrips(uint32_t const * lines, uint32_t count, uint32_t vertices, enum StripMode mode) {
+  int32_t * surplus = (int32_t *)calloc(vertices + 1, sizeof(int32_t));
+  uint32_t * parent = (uint32_t *)malloc(sizeof(uint32_t) * (vertices + 1));
+  uint8_t * touched = (uint8_t *)calloc(vertices + 1, 1);
+  uint8_t * unbalanced = (uint8_t *)calloc(vertices + 1, 1);
+  uint32_t i, v;
+  for (v = 0; v < vertices; ++v) {
+    parent[v] = v;
+  }
+  for (i = 0; i < count; ++i) {
+    uint32_t a = lines[i * 2], b = lines[i * 2 + 1];
+    ++surplus[a];
+    --surplus[b];
+    if (mode == StripAnyDirection) {
+      // only the parity of the degree counts, this keeps it in surplus[a] + surplus[b]
+      surplus[b] += 2;
+    }
+    touched[a] = touched[b] = 1;
+    parent[findRoot(parent, a)] = findRoot(parent, b);
+  }
+  uint64_t strips = 0;
+  for (v = 0; v < vertices; ++v) {
+    int32_t s = mode == StripAnyDirection ? surplus[v] & 1 : surplus[v];
+    if (s) {
+      unbalanced[findRoot(parent, v)] = 1;
+    }
+    strips += s > 0 ? (uint32_t)s : 0;
+  }
+  if (mode == StripAnyDirection) {
+    strips /= 2;
+  }
+  for (v = 0; v < vertices; ++v) {
+    strips += touched[v] && findRoot(parent, v) == v && !unbalanced[v];
+  }
+  free(surplus);
+  free(parent);
+  free(touched);
+  free(unbalanced);
+  return strips;
+}
+
+/*! \brief Builds strips of a line list and checks them.
+  \param name Name of the line list.
+  \param lines Lines, 2 indices each.
+  \param count Amount of lines.
+  \param vb Pointer to vertex buffer, its size is the amount of vertices.
+  \param mode Lines that may be chained.
+  \return 1 when the strips hold every line once and are as few as expected, else 0.
+*/
+static int8_t checkStrips(char const * name, uint32_t const * lines, uint32_t count, VertexBuffer const * vb, enum StripMode mode) {
+  IndexBuffer list = { { (uint16_t *)lines }, count * 2, Index32 };
+  StripBuffer strips;
+  StripStats stats;
+  if (buildStrips(&list, vb->size, mode, &strips, &stats) != Success) {
+    printf("%s (mode %d): buildStrips failed\n", name, mode);
+    return 0;
+  }
+  uint64_t * expected = (uint64_t *)malloc(sizeof(uint64_t) * (count + 1));
+  Collected collected = { vb->vertices, (uint64_t *)malloc(sizeof(uint64_t) * (count + 1)), 0, count + 1, 1 };
+  int8_t ok = expected && collected.lines && iterateStripBatches(vb, &strips, collectBatch, &collected) == Success;
+  if (!ok) {
+    printf("%s (mode %d): iterateStripBatches failed\n", name, mode);
+  }
+
+  uint32_t i;
+  // without directions a line may come back reversed, so both sides compare their lines with the smaller index first
+  for (i = 0; i < count && ok; ++i) {
+    uint64_t a = lines[i * 2], b = lines[i * 2 + 1];
+    expected[i] = mode == StripAnyDirection && b < a ? b << 32 | a : a << 32 | b;
+  }
+  for (i = 0; i < collected.count && ok && mode == StripAnyDirection; ++i) {
+    uint64_t a = collected.lines[i] >> 32, b = collected.lines[i] & UINT32_MAX;
+    collected.lines[i] = b < a ? b << 32 | a : a << 32 | b;
+  }
+  if (ok && collected.count != count) {
+    printf("%s (mode %d): %u lines back of %u\n", name, mode, collected.count, count);
+    ok = 0;
+  }
+  if (ok) {
+    qsort(expected, count, sizeof(uint64_t), compareLines);
+    qsort(collected.lines, count, sizeof(uint64_t), compareLines);
+    for (i = 0; i < count && ok; ++i) {
+      if (expected[i] != collected.lines[i]) {
+        printf("%s (mode %d): line %u-%u missing or repeated\n", name, mode, (uint32_t)(expected[i] >> 32), (uint32_t)expected[i]);
+        ok = 0;
+      }
+    }
+  }
+  if (ok && !collected.offsets) {
+    printf("%s (mode %d): batch offsets do not count lines\n", name, mode);
+    ok = 0;
+  }
+  uint64_t minimum = expectedStrips(lines, count, vb->size, mode);
+  if (ok && strips.strips != minimum) {
+    printf("%s (mode %d): %u strips, expected %lu\n", name, mode, strips.strips, (unsigned long)minimum);
+    ok = 0;
+  }
+  if (ok && (strips.lines != count || stats.lines != count || stats.strips != strips.strips || stats.indices != strips.indices.size
+	     || strips.indices.size != (count ? count + strips.strips * 2 - 1 : 0))) {
+    printf("%s (mode %d): counts do not add up\n", name, mode);
+    ok = 0;
+  }
+  enum IndexWidth width = vb->size < STRIP_RESTART16 ? Index16 : Index32;
+  if (ok && strips.indices.width != width) {
+    printf("%s (mode %d): %d bit strips for %u vertices\n", name, mode, strips.indices.width == Index16 ? 16 : 32, vb->size);
+    ok = 0;
+  }
+  free(expected);
+  free(collected.lines);
+  freeStripBuffer(&strips);
+  return ok;
+}
+
+/*! \brief Checks a line list in both modes.
+  \param name Name of the line list.
+  \param lines Lines, 2 indices each.
+  \param count Amount of lines.
+  \param vb Pointer to vertex buffer, its size is the amount of vertices.
+  \return 1 when both modes pass, else 0.
+*/
+static int8_t checkBoth(char const * name, uint32_t const * lines, uint32_t count, VertexBuffer const * vb) {
+  int8_t keep = checkStrips(name, lines, count, vb, StripKeepDirection);
+  int8_t any = checkStrips(name, lines, count, vb, StripAnyDirection);
+  return keep && any;
+}
+
+/*! \brief Counts the batches handed out.
+  \param batch Batch of lines.
+  \param user Pointer to the counter.
+*/
+static void countBatch(LineBatch const * batch, void * user) {
+  ++*(uint32_t *)user;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  static uint32_t lines[MAX_LINES * 2];
+  VertexBuffer vb;
+  if (initVertexBuffer(MAX_VERTICES, &vb) != Success) {
+    printf("strip: out of memory\n");
+    return 1;
+  }
+  srand(25);
+  int failed = 0;
+  uint32_t i, n;
+
+  // degenerate line lists
+  vb.size = 0;
+  failed |= !checkBoth("empty", lines, 0, &vb);
+  vb.size = 10;
+  failed |= !checkBoth("isolated vertices", lines, 0, &vb);
+  lines[0] = lines[1] = 3;
+  failed |= !checkBoth("self loop", lines, 1, &vb);
+  for (i = 0; i < 6; ++i) {
+    lines[i * 2] = 2;
+    lines[i * 2 + 1] = i % 3 ? 5 : 2;
+  }
+  failed |= !checkBoth("self loops and parallel lines", lines, 6, &vb);
+  for (i = 0; i < 7; ++i) {
+    lines[i * 2] = i % 2 ? 4 : 7;
+    lines[i * 2 + 1] = i % 2 ? 7 : 4;
+  }
+  failed |= !checkBoth("parallel lines both ways", lines, 7, &vb);
+  for (i = 0; i < 9; ++i) {
+    lines[i * 2] = 0;
+    lines[i * 2 + 1] = i + 1;
+  }
+  failed |= !checkBoth("star", lines, 9, &vb);
+
+  // the last vertex 16 bit strips can hold, and the first that needs 32 bit ones as it is the 16 bit marker
+  for (n = STRIP_RESTART16 - 1; n <= STRIP_RESTART16 + 1; ++n) {
+    vb.size = n;
+    for (i = 0; i < 40; ++i) {
+      lines[i * 2] = i % 4 == 0 ? n - 1 : (uint32_t)rand() % n;
+      lines[i * 2 + 1] = i % 4 == 1 ? n - 1 : (uint32_t)rand() % n;
+    }
+    failed |= !checkBoth(n < STRIP_RESTART16 ? "16 bit limit" : "32 bit limit", lines, 40, &vb);
+  }
+  vb.size = MAX_VERTICES;
+  for (i = 0; i < MAX_LINES; ++i) {
+    lines[i * 2] = MAX_VERTICES - 1 - i;
+    lines[i * 2 + 1] = i % 50 ? MAX_VERTICES - 2 - i : (uint32_t)rand() % MAX_VERTICES;
+  }
+  failed |= !checkBoth("large", lines, MAX_LINES, &vb);
+
+  // random line lists, few vertices give dense components with parallel lines and loops, many give sparse ones
+  for (i = 0; i < RANDOM_GRAPHS; ++i) {
+    vb.size = 1 + (uint32_t)rand() % (i % 3 ? 40 : 2000);
+    uint32_t count = (uint32_t)rand() % (i % 5 ? 300 : MAX_LINES + 1);
+    for (n = 0; n < count * 2; ++n) {
+      lines[n] = (uint32_t)rand() % vb.size;
+    }
+    failed |= !checkBoth("random", lines, count, &vb);
+  }
+
+  // an index outside the vertices is rejected before any batch
+  vb.size = 10;
+  uint32_t bad[] = { 1, 2, 3, STRIP_RESTART32, 4, 10 };
+  StripBuffer strips = { { { (uint16_t *)bad }, 6, Index32 }, 3, 4 };
+  uint32_t batches = 0;
+  if (iterateStripBatches(&vb, &strips, countBatch, &batches) != InvalidBuffer || batches) {
+    printf("index outside the vertices accepted\n");
+    failed = 1;
+  }
+  bad[5] = 9;
+  if (iterateStripBatches(&vb, &strips, countBatch, &batches) != Success || batches != 1) {
+    printf("valid strips rejected\n");
+    failed = 1;
+  }
+
+  vb.size = MAX_VERTICES;
+  free(vb.vertices);
+  printf("strip: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
@@ -0,0 +1,145 @@
+#include "graster.h"
+
+/*! \file tiles.c
+  \brief Test of the tiled rasterizer.
+  Draws random meshes with 'rasterizeMesh' and with 'binLines' and 'rasterizeTiles' at several worker counts, the
+  framebuffers must hash the same and the counts must be equal. Lines overlap in different colors, so drawing out of mesh
+  order shows, and screens are cut off in the middle of a tile.
+  \author cxnf
+  \version 0.1
+  \date 2013/09/28
+  \copyright GNU Public License.
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define MESHES 40                                 //!< Random meshes per screen.
+#define MAX_LINES 3000                            //!< Most lines of a random mesh.
+
+
+// ----------------- Local Function definitions ----------------------------------------------------
+
+/*! \brief Random float in a range.
+  \param min Minimum.
+  \param max Maximum.
+  \return Random value in [min, max].
+*/
+static float randomRange(float min, float max) {
+  return (float)(min + ((double)max - min) * rand() / RAND_MAX);
+}
+
+/*! \brief Fills a mesh with random lines.
+  Most vertices are on or around the screen, some far away, beyond RASTER_LIMIT or not a number.
+  \param mesh Pointer to mesh with its buffers allocated.
+  \param width Width of the screen.
+  \param height Height of the screen.
+*/
+static void fillMesh(Mesh * mesh, uint16_t width, uint16_t height) {
+  uint32_t i;
+  for (i = 0; i < mesh->vertices.size; ++i) {
+    Vector * coord = &mesh->vertices.vertices[i].coord;
+    int pick = rand() % 100;
+    if (pick < 80) {
+      coord->x = randomRange(-0.25f * width, 1.25f * width);
+      coord->y = randomRange(-0.25f * height, 1.25f * height);
+    } else if (pick < 97) {
+      coord->x = randomRange(-40000.0f, 40000.0f);
+      coord->y = randomRange(-40000.0f, 40000.0f);
+    } else if (pick < 99) {
+      coord->x = 2.0f * RASTER_LIMIT;
+      coord->y = 0.0f;
+    } else {
+      coord->x = NAN;
+      coord->y = 1.0f;
+    }
+    coord->z = 0.0f;
+    mesh->vertices.vertices[i].color = (Color)rand();
+  }
+  for (i = 0; i < mesh->indices.size; ++i) {
+    uint32_t index = (uint32_t)rand() % mesh->vertices.size;
+    if (mesh->indices.width == Index16) {
+      mesh->indices.indices[i] = (uint16_t)index;
+    } else {
+      mesh->indices.indices32[i] = index;
+    }
+  }
+}
+
+/*! \brief Draws a mesh untiled and tiled and compares.
+  \param mesh Pointer to mesh.
+  \param reference Pointer to framebuffer for the untiled drawing.
+  \param tiled Pointer to framebuffer of the same size for the tiled drawing.
+  \param bins Pointer to tile bins of the screen.
+  \return 1 when every worker count gives the untiled frame and counts, else 0.
+*/
+static int8_t compareTiled(Mesh const * mesh, Framebuffer * reference, Framebuffer * tiled, TileBins * bins) {
+  static const uint32_t workers[] = { 1, 2, 3, 8 };
+  RasterStats expected, stats;
+  clearFramebuffer(reference, 0);
+  if (rasterizeMesh(reference, mesh, &expected) != Success) {
+    printf("%u x %u: rasterizeMesh failed\n", reference->width, reference->height);
+    return 0;
+  }
+  uint64_t hash = hashFramebuffer(reference);
+  uint32_t i;
+  for (i = 0; i < sizeof(workers) / sizeof(workers[0]); ++i) {
+    clearFramebuffer(tiled, 0);
+    if (binLines(mesh, workers[i], bins) != Success || rasterizeTiles(tiled, mesh, bins, workers[i], &stats) != Success) {
+      printf("%u x %u, %u workers: tiled drawing failed\n", tiled->width, tiled->height, workers[i]);
+      return 0;
+    }
+    if (hashFramebuffer(tiled) != hash) {
+      printf("%u x %u, %u workers: frame differs\n", tiled->width, tiled->height, workers[i]);
+      return 0;
+    }
+    if (stats.lines != expected.lines || stats.drawn != expected.drawn || stats.pixels != expected.pixels) {
+      printf("%u x %u, %u workers: %u lines %u drawn %lu pixels, expected %u %u %lu\n", tiled->width, tiled->height, workers[i],
+	     stats.lines, stats.drawn, (unsigned long)stats.pixels, expected.lines, expected.drawn, (unsigned long)expected.pixels);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+// ----------------- Test --------------------------------------------------------------------------
+
+int main(void) {
+  // a single pixel, exactly one tile, a pixel more than a tile, tiles cut off in both directions
+  static const uint16_t screens[][2] = { { 1, 1 }, { TILE_WIDTH, TILE_HEIGHT }, { TILE_WIDTH + 1, TILE_HEIGHT + 1 }, { 100, 61 }, { 640, 480 } };
+  srand(22);
+  int failed = 0;
+  uint32_t s, m;
+  for (s = 0; s < sizeof(screens) / sizeof(screens[0]); ++s) {
+    Framebuffer reference, tiled;
+    TileBins bins;
+    if (initFramebuffer(screens[s][0], screens[s][1], &reference) != Success || initFramebuffer(screens[s][0], screens[s][1], &tiled) != Success
+	|| initTileBins(screens[s][0], screens[s][1], &bins) != Success) {
+      printf("tiles: out of memory\n");
+      return 1;
+    }
+    for (m = 0; m < MESHES; ++m) {
+      Mesh mesh;
+      uint32_t lines = 1 + (uint32_t)rand() % MAX_LINES;
+      if (initVertexBuffer(1 + (uint32_t)rand() % 500, &mesh.vertices) != Success
+	  || initIndexBuffer(lines, m % 2 ? Index16 : Index32, &mesh.indices) != Success) {
+	printf("tiles: out of memory\n");
+	return 1;
+      }
+      mesh.topology = NULL;
+      fillMesh(&mesh, screens[s][0], screens[s][1]);
+      failed |= !compareTiled(&mesh, &reference, &tiled, &bins);
+      free(mesh.vertices.vertices);
+      free(mesh.indices.indices);
+    }
+    freeFramebuffer(&reference);
+    freeFramebuffer(&tiled);
+    freeTileBins(&bins);
+  }
+  printf("tiles: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}
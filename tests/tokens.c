@@ -0,0 +1,213 @@
+#include "cparser.h"
+
+/*! \file tokens.c
+  \brief Test of the tokenizer allocations.
+  Linked with '-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc', so every allocation of the tokenizer is counted.
+  Parses the same text at two sizes through every entry point, the amount of allocations may not grow with the tokens.
+  Short texts check how signs and exponents are split into tokens.
+  \author cxnf
+  \version 1
+  \date 2013-10-21
+  \copyright GNU Public License
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define SMALL_LINES 1000                          //!< Lines of the small text.
+#define LARGE_LINES 100000                        //!< Lines of the large text.
+#define LISTING_SIZE 256                          //!< Size of the listing of a short text.
+
+
+// ----------------- Counting allocator -----------------------------------
+
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * pData, size_t size);
+
+static uint64_t uiAllocations = 0;                //!< Allocations since the start of the test.
+
+void * __wrap_malloc(size_t size) {
+  ++uiAllocations;
+  return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t count, size_t size) {
+  ++uiAllocations;
+  return __real_calloc(count, size);
+}
+
+void * __wrap_realloc(void * pData, size_t size) {
+  ++uiAllocations;
+  return __real_realloc(pData, size);
+}
+
+
+// ----------------- Local Function definitions ---------------------------
+
+/*! \brief Counts tokens.
+  \param type Type of the token.
+  \param token The token.
+  \param user Pointer to the token counter.
+  \return 1 to continue parsing.
+*/
+static int8_t countToken(enum TokenType type, Token token, void * user) {
+  ++*(uint64_t *)user;
+  return 1;
+}
+
+/*! \brief Lists tokens.
+  Appends every token as 'N:' or 'T:' and its text, or 'E', followed by a space.
+  \param type Type of the token.
+  \param token The token.
+  \param user Pointer to the listing, LISTING_SIZE characters.
+  \return 1 to continue parsing.
+*/
+static int8_t listToken(enum TokenType type, Token token, void * user) {
+  char * listing = (char *)user;
+  size_t len = strlen(listing);
+  if (type == TTEndLine) {
+    snprintf(listing + len, LISTING_SIZE - len, "E ");
+  } else {
+    snprintf(listing + len, LISTING_SIZE - len, "%s:%.*s ", type == TTNumber ? "N" : "T", (int)token.length, token.text);
+  }
+  return 1;
+}
+
+/*! \brief Parses a short text and compares its tokens.
+  \param text Text to parse.
+  \param expected Listing of the tokens as 'listToken' writes it, NULL when the text is invalid.
+  \return 1 when the text gives the expected tokens, or is rejected when invalid, else 0.
+*/
+static int8_t checkTokens(const char * text, const char * expected) {
+  char listing[LISTING_SIZE] = "";
+  // the tokenizer reports invalid tokens on stdout
+  fflush(stdout);
+  int out = dup(1), null = open("/dev/null", O_WRONLY);
+  dup2(null, 1);
+  enum ParseResults result = parseBuffer(text, strlen(text), listToken, listing);
+  fflush(stdout);
+  dup2(out, 1);
+  close(out);
+  close(null);
+  int8_t ok = expected ? result == ROk && !strcmp(listing, expected) : result == RErrInvalidToken;
+  if (!ok) {
+    printf("\"%s\": result %d, tokens %s\n", text, result, listing);
+  }
+  return ok;
+}
+
+/*! \brief Builds a wavefront text.
+  \param lines Amount of lines.
+  \param pLen Pointer to receive the length of the text.
+  \return Text, free it with 'free'.
+*/
+static char * buildText(uint32_t lines, size_t * pLen) {
+  static const char * const records[] = { "v 1.5 -2.25 3e2\n", "f 1 2 3 4\n", "# comment line\n", "vn 0.0 1.0 0.0\n", "  \tf -1 -2\r\n" };
+  char * text = (char *)malloc((size_t)lines * 32);
+  size_t len = 0;
+  uint32_t i;
+  for (i = 0; text && i < lines; ++i) {
+    const char * record = records[i % (sizeof(records) / sizeof(records[0]))];
+    memcpy(text + len, record, strlen(record));
+    len += strlen(record);
+  }
+  *pLen = len;
+  return text;
+}
+
+/*! \brief Writes a text to a temporary file.
+  \param text Text to write.
+  \param len Length of 'text'.
+  \param path Buffer to receive the path, at least 32 characters.
+  \return 1 on success, else 0.
+*/
+static int8_t writeText(const char * text, size_t len, char * path) {
+  strcpy(path, "/tmp/tokensXXXXXX");
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return 0;
+  }
+  int8_t ok = write(fd, text, len) == (ssize_t)len;
+  close(fd);
+  return ok;
+}
+
+/*! \brief Parses a text through every entry point.
+  \param lines Amount of lines of the text.
+  \param allocations Allocations of 'parseBuffer', 'parseFileMapped' and 'parseFile' in that order.
+  \param tokens Tokens of every entry point, in the same order.
+  \return 1 on success, else 0.
+*/
+static int8_t parseAll(uint32_t lines, uint64_t * allocations, uint64_t * tokens) {
+  size_t len;
+  char path[32];
+  char * text = buildText(lines, &len);
+  if (!text || !writeText(text, len, path)) {
+    free(text);
+    return 0;
+  }
+  memset(tokens, 0, sizeof(uint64_t) * 3);
+  uint64_t start = uiAllocations;
+  int8_t ok = parseBuffer(text, len, countToken, &tokens[0]) == ROk;
+  allocations[0] = uiAllocations - start;
+  start = uiAllocations;
+  ok &= parseFileMapped(path, countToken, &tokens[1]) == ROk;
+  allocations[1] = uiAllocations - start;
+  start = uiAllocations;
+  ok &= parseFile(path, countToken, &tokens[2]) == ROk;
+  allocations[2] = uiAllocations - start;
+  unlink(path);
+  free(text);
+  return ok;
+}
+
+
+// ----------------- Test -------------------------------------------------
+
+int main(void) {
+  static const char * const names[] = { "parseBuffer", "parseFileMapped", "parseFile" };
+  uint64_t smallAllocations[3], smallTokens[3];
+  uint64_t largeAllocations[3], largeTokens[3];
+  if (!parseAll(SMALL_LINES, smallAllocations, smallTokens) || !parseAll(LARGE_LINES, largeAllocations, largeTokens)) {
+    printf("tokens: parse failed\n");
+    return 1;
+  }
+
+  int failed = 0;
+  uint32_t i;
+  for (i = 0; i < 3; ++i) {
+    printf("%s: %lu tokens %lu allocations, %lu tokens %lu allocations\n", names[i], (unsigned long)smallTokens[i], (unsigned long)smallAllocations[i],
+	   (unsigned long)largeTokens[i], (unsigned long)largeAllocations[i]);
+    // every entry point sees the same tokens, allocations are per parse and never per token
+    if (smallTokens[i] != smallTokens[0] || largeTokens[i] != largeTokens[0] || largeTokens[i] <= smallTokens[i]) {
+      printf("%s: token count differs\n", names[i]);
+      failed = 1;
+    }
+    if (largeAllocations[i] != smallAllocations[i]) {
+      printf("%s: allocations grow with the tokens\n", names[i]);
+      failed = 1;
+    }
+  }
+  // tokens of a text in memory are views on the text itself
+  if (smallAllocations[0] || largeAllocations[0]) {
+    printf("parseBuffer: allocates\n");
+    failed = 1;
+  }
+
+  // exponents belong to the number, a sign without digits is a number of its own and the e starts a text
+  // (the end of the text adds a line end of its own)
+  failed |= !checkTokens("v -1.5e+3 2E-2 7e0 1.25e10\n", "T:v N:-1.5e+3 N:2E-2 N:7e0 N:1.25e10 E E ");
+  failed |= !checkTokens("-e12 -exp -E\n", "N:- T:e12 N:- T:exp N:- T:E E E ");
+  // digits followed by an e must complete the exponent
+  failed |= !checkTokens("1e\n", NULL);
+  failed |= !checkTokens("1e+ 2\n", NULL);
+  failed |= !checkTokens("2ex\n", NULL);
+  failed |= !checkTokens("3.5E-\n", NULL);
+  printf("tokens: %s\n", failed ? "FAILED" : "ok");
+  return failed;
+}